@@ -0,0 +1,17 @@
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stddef.h>
+
+#define POOL_THREAD_MAX 32
+
+// the cores available, at most POOL_THREAD_MAX
+size_t pool_thread_count(void);
+// runs task(ctx, i) for every i in [0, task_count) on the process-wide worker set and returns once all of them have
+// the workers are started on the first call and kept until the process exits, the calling thread takes part too
+// so everything still runs (serially) if no worker could be started
+// jobs from several threads are queued and share the same workers
+// a task calling pool_run runs its own tasks serially, so nesting never multiplies the threads
+void pool_run(size_t task_count, void (*task)(void*, size_t), void* ctx);
+
+#endif /* __POOL_H__ */
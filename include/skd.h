@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include "util/mjd.h"
 #include "util/hashmap.h"
+#include "util/arena.h"
 
 // represents both station's and sources
 // the x-component is an untagged union
@@ -12,32 +13,160 @@ typedef struct {
     union { float lam; float alf; };
     float phi;
 } NamedPoint;
-// Representation of a single scan entry
-// NOTE: It isn't safe to dereference this due to the flexible array member
-typedef struct {
-    Datetime timestamp;
-    uint16_t cal_duration, obs_duration;
-    char source[9];
-    uint16_t* scan_offsets;
-    char ids[];
-} ScanFAM;
+// station interned from an antenna (A) line, scans refer to it by its index into Schedule.stations
+// key is the one or two characters used in $SKED, pos.name is empty until a position (P) line is found
+typedef struct {
+    char key[3], id[3];
+    NamedPoint pos;
+} Station;
+// source interned from a $SOURCES line, scans refer to it by its index into Schedule.sources
+// point.name holds the common name, which is empty if the source doesn't have one
+typedef struct {
+    char iau[9];
+    NamedPoint point;
+} Source;
+// placeholders for a scan's references which couldn't be resolved, these fail validation
+#define STATION_NONE UINT16_MAX
+#define SOURCE_NONE UINT32_MAX
+// stations past this many are dropped, which bounds station sets and per-scan scratch buffers
+#define STATION_COUNT_MAX 1024
+// stations are also kept as a bitset per scan, one bit per index into Schedule.stations
+// a schedule's sets are all set_words wide, just enough to hold every station
+#define STATION_SET_WORD_BITS 64
+#define STATION_SET_WORDS(station_count) (((station_count) + STATION_SET_WORD_BITS - 1) / STATION_SET_WORD_BITS)
+#define STATION_SET_WORDS_MAX STATION_SET_WORDS(STATION_COUNT_MAX)
+// scans are stored column by column, every column is indexed by scan
+// scan i's stations and their offsets are [station_beg[i], station_beg[i + 1]) of the shared stations/offsets pools
+// its station set is [i * set_words, (i + 1) * set_words) of station_sets
+// timestamp holds each scan's start, converted once as it's parsed
+typedef struct {
+    TimeMs* timestamp;
+    uint32_t* cal_duration;
+    uint32_t* obs_duration;
+    uint32_t* source;
+    uint32_t* station_beg; // scan_count + 1 entries
+    uint16_t* stations;
+    uint32_t* offsets;
+    uint64_t* station_sets;
+    size_t set_words;
+} ScanTable;
+// scans grouped by station and by source, so either can be walked without visiting every scan
+// station s takes part in [station_beg[s], station_beg[s + 1]) of station_scans, station_offsets holds its offset into each
+// source s is observed by [source_beg[s], source_beg[s + 1]) of source_scans
+// both lists are in schedule order and leave out unresolved references, the tables are NULL until every scan is known
+typedef struct {
+    uint32_t* station_beg; // station_count + 1 entries
+    uint32_t* station_scans;
+    uint32_t* station_offsets;
+    uint32_t* source_beg; // source_count + 1 entries
+    uint32_t* source_scans;
+} ScanIndex;
+// byte range of a single $-section in the schedule's source text
+// head points at the header line, [beg, end) spans the section's body
+// data holds what a section parsed on demand was turned into, it's allocated from the Schedule's arena
+typedef struct {
+    char name[16];
+    size_t head, beg, end;
+    unsigned int parsed;
+    void* data;
+} Section;
+// windows in which stations can't observe, parsed from $DOWNTIME when it's first asked for
+// sked writes a line per window: <station id or key> <yyyy-ddd-hh:mm:ss> <yyyy-ddd-hh:mm:ss>
+// station s is down during [beg[s], beg[s + 1]) of from/until, sorted and without overlaps
+typedef struct {
+    uint32_t* beg; // station_count + 1 entries
+    TimeMs* from;
+    TimeMs* until;
+} StationDowntime;
+// read-only mapping of a compiled schedule (.skdb), see skd_cache.h
+// addr is NULL when the Schedule was parsed from text
+typedef struct {
+    void* addr;
+    size_t len;
+} ScheduleImage;
+// state of a $SKED section being parsed in the background
+typedef struct __SKD_H__ScheduleStream ScheduleStream;
 // Schedule data gets further parsed in the SchedulePass
+// the HashMaps resolve names to indices into stations and sources
+// arena owns every table, so freeing a Schedule releases it with src and the mapped image
+// the name tables of a typical schedule fit in its first block
+#define SCHEDULE_ARENA_BYTES (1 << 16)
 typedef struct {
-    HashMap stations_ant;
-    HashMap stations_pos;
-    // HashMap sources_sat;
-    HashMap sources;
-    HashMap sources_alias;
+    Arena* arena;
+    size_t station_count;
+    Station* stations;
+    size_t source_count;
+    Source* sources;
+    HashMap stations_ant; // key -> station
+    HashMap stations_pos; // 2-char id -> station, only once it has a position
+    HashMap sources_iau; // IAU name -> source
+    HashMap sources_alias; // common name -> source
     size_t scan_count;
-    ScanFAM* scans;
+    ScanTable scans;
+    ScanIndex scan_index;
+    char* src;
+    size_t src_len;
+    size_t section_count;
+    Section* sections;
+    ScheduleImage image;
+    // non-NULL while scans are still being streamed in
+    ScheduleStream* stream;
+    // sorted indices of the $SKED lines which didn't produce a scan
+    // skipped_count is SIZE_MAX if they couldn't be recorded
+    size_t* skipped_lines;
+    size_t skipped_count;
 } Schedule;
-// checks for inconsistencies across Schedule's various HashMaps
+// describes how Schedule_reload changed the scan list
+// scans [first, first + removed) were replaced by [first, first + added), later scans were shifted
+// stations/sources are set when the corresponding section was re-parsed
+typedef struct {
+    size_t first, removed, added;
+    unsigned int stations, sources;
+} ScheduleDiff;
+// checks that every scan refers to a known source and to stations with known positions
 unsigned int Schedule_debug_and_validate(Schedule skd, unsigned int display);
-// required because of the flexible array member
-ScanFAM* Schedule_get_scan(Schedule skd, size_t i);
+// only validate the scans in [beg, end)
+unsigned int Schedule_debug_and_validate_range(Schedule skd, size_t beg, size_t end, unsigned int display);
+// read when a single $SKED line starts and ends without parsing the rest of it
+unsigned int Schedule_scan_span(const char* line, const char* end, Datetime* start, Datetime* stop);
+// look up a station by its key or 2-char id, keys are tried first, NULL if it isn't defined
+const Station* Schedule_find_station(Schedule skd, const char* name);
+// look up a source by its IAU or common name, NULL if it isn't defined
+const Source* Schedule_find_source(Schedule skd, const char* name);
+// build the name lookups from stations and sources, the HashMaps must be empty
+unsigned int Schedule_index_names(Schedule* skd);
+// build scan_index from the scans, its tables are allocated from the Schedule's arena
+unsigned int Schedule_index_scans(Schedule* skd);
+// rebuild only the by-station or the by-source half of scan_index, the other half is left as it is
+unsigned int Schedule_index_station_scans(Schedule* skd);
+unsigned int Schedule_index_source_scans(Schedule* skd);
 // free Schedule
 void Schedule_free(Schedule skd);
+// look up a section by its header (e.g. "$FLUX"), NULL if it isn't present
+const Section* Schedule_get_section(Schedule skd, const char* name);
+// parse a section the first time it is requested, subsequent calls are no-ops
+unsigned int Schedule_parse_section(Schedule* skd, const char* name);
+// what a section parsed on demand holds, its parser runs on the first call
+// NULL if the section isn't present or couldn't be parsed
+const void* Schedule_get_section_data(Schedule skd, const char* name);
+// the schedule's $DOWNTIME, NULL if it has none
+const StationDowntime* Schedule_get_downtime(Schedule skd);
 // initialize from a skd file
+// only $STATIONS, $SOURCES and $SKED are parsed up front, $DOWNTIME is parsed when it's first asked for
+// a compiled image (<path>.skdb) is used instead of parsing when it matches the file
 unsigned int Schedule_build_from_source(Schedule* skd, const char* path);
+// same as Schedule_build_from_source, but the (uncompressed) file at path was already read into src
+// the Schedule takes ownership of src, it's freed if the build fails
+unsigned int Schedule_build_from_memory(Schedule* skd, const char* path, char* src);
+// same as Schedule_build_from_source, but returns as soon as $STATIONS and $SOURCES are parsed
+// $SKED is parsed on a background thread, scans are published in order by Schedule_poll
+unsigned int Schedule_build_streaming(Schedule* skd, const char* path);
+// update scan_count with the scans parsed since the last call
+// returns 1 while the background parse is still running
+unsigned int Schedule_poll(Schedule* skd);
+// re-read the schedule at path, only re-parsing the lines which differ from the current source
+// the new scans are validated before anything is replaced, so the Schedule is unchanged on failure
+// can't be called while the Schedule is still streaming
+unsigned int Schedule_reload(Schedule* skd, const char* path, ScheduleDiff* diff);
 
 #endif /* __SKD_H__ */
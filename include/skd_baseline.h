@@ -0,0 +1,28 @@
+#ifndef __SKD_BASELINE_H__
+#define __SKD_BASELINE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "skd.h"
+
+// pairs of stations (a, b) with a < b are numbered row by row, there are n * (n - 1) / 2 of them
+#define BASELINE_PAIR(a, b, n) ((a) * (2 * (n) - (a) - 1) / 2 + (b) - (a) - 1)
+// scans of every baseline (unordered pair of stations), built on demand from a Schedule's scans
+// pair p is observed by [pair_beg[p], pair_beg[p + 1]) of scans/seconds, in schedule order
+// seconds holds how long both stations observe together, each station observes from the scan's start until its offset
+typedef struct {
+    size_t station_count, pair_count;
+    uint32_t* pair_beg; // pair_count + 1 entries
+    uint32_t* scans;
+    uint32_t* seconds;
+} BaselineIndex;
+// build the index over the scans the Schedule holds now, the work is spread over every core
+// a station listed more than once in a scan only counts once, with its first offset
+unsigned int BaselineIndex_build(BaselineIndex* index, Schedule skd);
+// scans of the baseline between stations a and b (indices into Schedule.stations), in either order
+// scans and seconds point into the index, returns their count
+size_t BaselineIndex_scans(BaselineIndex index, size_t a, size_t b, const uint32_t** scans, const uint32_t** seconds);
+// free BaselineIndex
+void BaselineIndex_free(BaselineIndex index);
+
+#endif /* __SKD_BASELINE_H__ */
@@ -0,0 +1,24 @@
+#ifndef __SKD_BULK_H__
+#define __SKD_BULK_H__
+
+#include <stddef.h>
+#include "skd.h"
+
+// receives each schedule once it's parsed and validated, in the order they complete
+// callbacks only ever run on the thread which called Schedule_build_bulk, one at a time
+// on success the callback owns skd and has to free it, otherwise skd is NULL and failure holds the build's error code
+typedef void (*ScheduleBulkCallback)(void* ctx, size_t idx, const char* path, Schedule* skd, unsigned int failure);
+typedef struct {
+    // number of schedules parsed at once, 0 uses one per core
+    // their parses share the worker set of pool_run, so this doesn't multiply the threads each parse uses
+    size_t worker_count;
+    // bytes of schedules which may be read ahead of the callback, 0 doesn't limit it
+    // a schedule's file size is charged when it's read, once parsed the charge becomes what it holds in memory
+    // (its tables, its decoded source and any compiled image) and it's released once its callback returns
+    size_t memory_cap;
+} ScheduleBulkConfig;
+// load every schedule in paths, files are read on a separate thread while earlier ones are parsed
+// returns 1 if the loader couldn't be set up, failures of individual schedules are passed to callback
+unsigned int Schedule_build_bulk(const char* const* paths, size_t path_count, ScheduleBulkConfig config, ScheduleBulkCallback callback, void* ctx);
+
+#endif /* __SKD_BULK_H__ */
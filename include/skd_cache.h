@@ -0,0 +1,25 @@
+#ifndef __SKD_CACHE_H__
+#define __SKD_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "skd.h"
+
+// identifies the exact source file a compiled schedule (.skdb) was built from
+typedef struct {
+    uint64_t size;
+    int64_t mtime_sec, mtime_nsec;
+    uint64_t hash;
+} ScheduleStamp;
+// stat the schedule at path and hash its contents
+unsigned int ScheduleStamp_init(ScheduleStamp* stamp, const char* path, const char* src, size_t src_len);
+// map the compiled image stored alongside path and build the Schedule from it in place
+// fails if the image is missing, from another version or stamped with a different source
+// only the source text (src, src_len) must be filled in by the caller beforehand
+unsigned int ScheduleCache_load(Schedule* skd, const char* path, ScheduleStamp stamp);
+// write a compiled image of a freshly parsed Schedule alongside path
+unsigned int ScheduleCache_write(Schedule skd, const char* path, ScheduleStamp stamp);
+// unmap an image created by ScheduleCache_load
+void ScheduleCache_release(ScheduleImage image);
+
+#endif /* __SKD_CACHE_H__ */
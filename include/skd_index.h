@@ -0,0 +1,60 @@
+#ifndef __SKD_INDEX_H__
+#define __SKD_INDEX_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "util/mjd.h"
+
+// persistent summary of every schedule below a directory, stored as <dir>/.skdindex
+// only $EXPER, $STATIONS, $SOURCES and the first and last lines of $SKED are read from each schedule
+typedef struct {
+    char id[3], name[9];
+} IndexStation;
+typedef struct {
+    char iau[9], name[9];
+} IndexSource;
+// stations and sources are stored once, entries refer to them through refs
+// [station_beg, station_beg + station_count) and [source_beg, source_beg + source_count) index refs
+typedef struct {
+    uint64_t path; // offset of the path (relative to the indexed directory) into paths
+    uint64_t size;
+    int64_t mtime_sec, mtime_nsec;
+    char session[16];
+    Datetime beg, end;
+    uint32_t station_beg, station_count;
+    uint32_t source_beg, source_count;
+} IndexEntry;
+// entries are sorted by path
+typedef struct {
+    IndexEntry* entries;
+    IndexStation* stations;
+    IndexSource* sources;
+    uint32_t* refs;
+    char* paths;
+    size_t entry_count, station_count, source_count, ref_count, path_len;
+} ScheduleIndex;
+// a session matches if it lists every station and source and overlaps [from, to]
+// stations are matched by code or name, sources by IAU or common name, both ignoring case
+typedef struct {
+    const char** stations;
+    size_t station_count;
+    const char** sources;
+    size_t source_count;
+    Datetime from, to;
+    unsigned int bounded_from, bounded_to;
+} IndexQuery;
+// load the index stored in dir, it's left empty if there isn't one or it's from another version
+unsigned int ScheduleIndex_load(ScheduleIndex* index, const char* dir);
+// bring the index in line with the schedules (.skd, .skd.gz, .skd.zst) below dir
+// only schedules which are new or whose size or modification time changed are read
+// updated is set to the number of entries which were added, re-read or dropped
+unsigned int ScheduleIndex_update(ScheduleIndex* index, const char* dir, size_t* updated);
+// write the index to <dir>/.skdindex
+unsigned int ScheduleIndex_write(ScheduleIndex index, const char* dir);
+// collect the indices of the matching entries, ordered by start time
+// matches must be freed by the caller
+unsigned int ScheduleIndex_query(ScheduleIndex index, IndexQuery query, size_t** matches, size_t* match_count);
+// free ScheduleIndex
+void ScheduleIndex_free(ScheduleIndex index);
+
+#endif /* __SKD_INDEX_H__ */
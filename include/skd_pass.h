@@ -18,6 +18,14 @@ typedef struct {
 } SchedulePassDesc;
 // initialize SchedulePass from a given Schedule
 SchedulePass* SchedulePass_init_from_schedule(SchedulePassDesc desc, Schedule skd);
+// append events for scans published since the SchedulePass was last synced
+// playback is held at the last loaded scan while the Schedule is still streaming
+unsigned int SchedulePass_sync(SchedulePass* const pass, Schedule skd);
+// patch events, active scans and markers after Schedule_reload, keeping the playback time
+unsigned int SchedulePass_reload(SchedulePass* const pass, Schedule skd, ScheduleDiff diff);
+// jump playback to ms, showing the scans that would be active had it played up to there
+// a binary search finds the nearest keyframe, only the events after it are replayed
+unsigned int SchedulePass_seek(SchedulePass* const pass, Schedule skd, TimeMs ms);
 // free SchedulePass
 void SchedulePass_free(const SchedulePass* const pass);
 // update relevant uniforms and render
@@ -26,7 +34,7 @@ void SchedulePass_free(const SchedulePass* const pass);
 void SchedulePass_update_and_draw(SchedulePass* const pass, Schedule skd, const Camera* const cam);
 // called by SchedulePass_handle_input
 void SchedulePass_handle_action(SchedulePass* const pass, Schedule skd, const OverlayAction act);
-// allows pausing/unpausing and resetting
+// allows pausing/unpausing, resetting and stepping between scans
 void SchedulePass_handle_input(SchedulePass* const pass, Schedule skd, const RGFW_window* const win);
 
 #endif /* __SKD_PASS_H__ */
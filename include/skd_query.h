@@ -0,0 +1,31 @@
+#ifndef __SKD_QUERY_H__
+#define __SKD_QUERY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "skd.h"
+
+// set of stations to match scans against, one bit per index into Schedule.stations
+typedef struct {
+    uint64_t words[STATION_SET_WORDS_MAX];
+} StationSet;
+// empty the set
+void StationSet_clear(StationSet* set);
+// add a station by its key or 2-char id, fails if it isn't defined
+unsigned int StationSet_add(StationSet* set, Schedule skd, const char* name);
+// collect the scans every station of set takes part in, in schedule order
+// a single station gives its timeline, two stations the scans of their baseline
+// once the scans are indexed only the scans of the set's least busy station are visited
+// matches holds up to scan_count indices and may be NULL to only count them, returns the match count
+size_t Schedule_scans_with(Schedule skd, const StationSet* set, size_t* matches);
+// collect the scans whose stations all belong to set, i.e. the scans a subnet could observe on its own
+size_t Schedule_scans_within(Schedule skd, const StationSet* set, size_t* matches);
+// scans station (an index into Schedule.stations) takes part in, in schedule order, with its offset into each
+// scans and offsets point into the Schedule's scan index, returns their count
+// nothing is returned while the Schedule is still streaming
+size_t Schedule_station_timeline(Schedule skd, size_t station, const uint32_t** scans, const uint32_t** offsets);
+// scans observing source (an index into Schedule.sources), in schedule order
+// scans points into the Schedule's scan index, returns their count
+size_t Schedule_source_scans(Schedule skd, size_t source, const uint32_t** scans);
+
+#endif /* __SKD_QUERY_H__ */
@@ -0,0 +1,66 @@
+#ifndef __SKD_SNAPSHOT_H__
+#define __SKD_SNAPSHOT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "skd.h"
+
+// scans are shared between a Schedule and its snapshots in chunks of this many
+#define SNAPSHOT_CHUNK_SCANS 4096
+// a chunk's tables point into the base (or the snapshot it was forked from) until an edit copies them
+// its i-th scan has members [station_beg[i], station_beg[i + 1]) of stations and offsets, which only index from 0 once copied
+// owned holds the tables this snapshot copied
+typedef struct {
+    TimeMs* timestamp;
+    uint32_t* source;
+    uint32_t* station_beg;
+    uint16_t* stations;
+    uint32_t* offsets;
+    uint64_t* station_sets;
+    unsigned int owned;
+} ScanChunk;
+// what-if variant of a Schedule, edited without touching the Schedule it was taken from
+// only the chunks an edit touches are copied into arena, so holding dozens of variants costs little more than holding one
+// the base must outlive its snapshots and mustn't change meanwhile
+// every edit keeps the scans in time order, which the scan index, StationTimeline and SchedulePass all rely on
+typedef struct {
+    Schedule base;
+    Arena* arena;
+    size_t chunk_count;
+    ScanChunk* chunks;
+    size_t dirty_beg, dirty_end; // scans which may differ from base
+    unsigned int stale; // halves of the scan index which a view has to rebuild
+} ScheduleSnapshot;
+// share every scan of base, fails if base is still streaming
+unsigned int ScheduleSnapshot_init(ScheduleSnapshot* snap, Schedule base);
+// start another variant from the edits of parent, which must outlive it
+unsigned int ScheduleSnapshot_fork(ScheduleSnapshot* snap, const ScheduleSnapshot* parent);
+// remove station (an index into Schedule.stations) from every scan, the station itself stays defined
+unsigned int ScheduleSnapshot_drop_station(ScheduleSnapshot* snap, size_t station);
+// move the scans [beg, end) by ms, which may be negative
+// fails without moving anything if a scan would pass one of its neighbours, scans are never re-sorted
+unsigned int ScheduleSnapshot_shift_scans(ScheduleSnapshot* snap, size_t beg, size_t end, TimeMs ms);
+// observe source (an index into Schedule.sources) during scan instead
+unsigned int ScheduleSnapshot_set_source(ScheduleSnapshot* snap, size_t scan, size_t source);
+// free the chunks the snapshot copied
+void ScheduleSnapshot_free(ScheduleSnapshot snap);
+// the Schedule to draw, either the base or one of its snapshots laid out flat
+// skd can be read anywhere a Schedule is, never pass it to Schedule_free
+// a table no chunk of the shown snapshot copied still points into the base, the rest are assembled in arena
+typedef struct {
+    Schedule skd;
+    Schedule base;
+    Arena* arena; // NULL while showing base
+    size_t dirty_beg, dirty_end; // of the snapshot shown
+} ScheduleView;
+// show base
+void ScheduleView_init(ScheduleView* view, Schedule base);
+// show snap instead, or base if it's NULL, snap must have been taken from the view's base
+// only the scans of copied chunks are validated and only the stale halves of the scan index are rebuilt
+// diff is filled in for SchedulePass_reload, to go from a pass showing the previous variant to one showing this one
+// the view is unchanged on failure
+unsigned int ScheduleView_show(ScheduleView* view, const ScheduleSnapshot* snap, ScheduleDiff* diff);
+// free the tables assembled for the variant shown
+void ScheduleView_free(ScheduleView view);
+
+#endif /* __SKD_SNAPSHOT_H__ */
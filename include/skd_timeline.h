@@ -0,0 +1,60 @@
+#ifndef __SKD_TIMELINE_H__
+#define __SKD_TIMELINE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "skd.h"
+
+// what a station is doing at some point of the session
+// within a scan it's on source until its offset, then calibrates for the scan's calibration time
+// $SKED only names the PREOB, MIDOB and POSTOB procedures without their durations, so they're all folded into that one phase
+// between two scans it's slewing if they observe different sources and idle otherwise
+// a $DOWNTIME window overrides everything else
+typedef enum {
+    STATION_IDLE = 0,
+    STATION_SLEWING,
+    STATION_ON_SOURCE,
+    STATION_CALIBRATING,
+    STATION_DOWN,
+    STATION_STATE_COUNT
+} StationState;
+// the station's state doesn't change after this
+#define TIMELINE_NEVER INT64_MAX
+// scan is the one the station is in, or heading to while idle or slewing, SCAN_NONE after its last and while down
+#define SCAN_NONE UINT32_MAX
+typedef struct {
+    StationState state;
+    uint32_t scan;
+    TimeMs until; // when the state changes next
+} StationStatus;
+// the next change of a station, the queue holds at most one per station
+typedef struct {
+    TimeMs ms;
+    uint16_t station;
+} StationEvent;
+// state of every station, advanced in time by a priority queue of their next changes
+// each station walks its own scans from Schedule_station_timeline, so advancing only touches the stations which change
+typedef struct {
+    size_t station_count;
+    TimeMs ms;
+    StationStatus* stations;
+    uint32_t* cursor; // position in the station's scans
+    uint32_t* down_cursor; // position in the station's downtime
+    const StationDowntime* downtime; // the Schedule's, NULL if it has none
+    StationEvent* queue; // binary min-heap on ms
+    size_t queue_count;
+    size_t counts[STATION_STATE_COUNT]; // stations in each state
+} StationTimeline;
+// parse $DOWNTIME (if there is one and it wasn't yet) and place every station at the session's start
+// $DOWNTIME is read as sked writes it, a line per window: <station id or key> <yyyy-ddd-hh:mm:ss> <yyyy-ddd-hh:mm:ss>
+// needs the by-station half of skd.scan_index, a station's scans are taken in schedule order
+unsigned int StationTimeline_build(StationTimeline* timeline, Schedule skd);
+// place every station at ms directly, in O(stations * log scans)
+void StationTimeline_seek(StationTimeline* timeline, Schedule skd, TimeMs ms);
+// apply every change up to and including ms, which mustn't be before the timeline's time
+// returns how many changes were applied
+size_t StationTimeline_advance(StationTimeline* timeline, Schedule skd, TimeMs ms);
+// free StationTimeline
+void StationTimeline_free(StationTimeline timeline);
+
+#endif /* __SKD_TIMELINE_H__ */
@@ -9,7 +9,10 @@ typedef enum {
     ACTION_SKD_PASS_FASTER,
     ACTION_SKD_PASS_SLOWER,
     ACTION_SKD_PASS_PAUSE,
-    ACTION_SKD_PASS_RESET
+    ACTION_SKD_PASS_RESET,
+    ACTION_SKD_PASS_NEXT,
+    ACTION_SKD_PASS_PREV,
+    ACTION_SKD_PASS_SEEK
 } OverlayAction;
 // reduce binary size by deleting these functions
 // if the UI is disabled
@@ -19,17 +22,31 @@ typedef struct {
     double jd, gmst;
     unsigned long long speed;
     unsigned int paused;
+    size_t scan_count;
+    unsigned int loading;
+    float progress; // fraction of the session played
+    size_t observing, calibrating, slewing, idle, down; // stations in each state
 } OverlayControls;
 //initialize Overlay
 void Overlay_init(const char* path, RGFW_window* const win);
+// free the name lists
+void Overlay_free();
 // pop queued action
 OverlayAction Overlay_get_action();
+// position the time slider was dragged to, as a fraction of the session
+float Overlay_get_seek();
 // update the controls
 void Overlay_set_controls(const OverlayControls controls);
+// empty the active_scans and stations lists, they're shown as they are until then
+void Overlay_clear_lists();
 // push a source to the active_scans list
 void Overlay_add_active_scan(const char* const name);
 // push a station to the stations list
 void Overlay_add_station(const char* const name);
+// i-th most recently pushed name of either list, NULL past its end
+// the name is overwritten by the next call
+const char* Overlay_get_active_scan(size_t i);
+const char* Overlay_get_station(size_t i);
 // prepare the Overlay for drawing
 void Overlay_prepare_interface(const RGFW_window* const win);
 #endif /* not NO_UI */
@@ -0,0 +1,149 @@
+#ifndef __ARCHIVE_H__
+#define __ARCHIVE_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <zstd.h>
+#include "log.h"
+#include "gzip.h"
+
+// reads files which may be gzip or zstd compressed, the format is detected by the file's magic bytes
+// decompressed data is handed out in caller-sized pieces, so only the decoders' own buffers are held
+typedef enum {
+    ARCHIVE_PLAIN,
+    ARCHIVE_GZIP,
+    ARCHIVE_ZSTD
+} ArchiveFormat;
+
+typedef struct {
+    FILE* stream;
+    ArchiveFormat format;
+    GzipStream* gzip;
+    ZSTD_DStream* zstd;
+    ZSTD_inBuffer zstd_in;
+    size_t zstd_cap, zstd_hint;
+    unsigned int failure;
+} Archive;
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static ArchiveFormat archive_detect(FILE* stream) {
+    unsigned char magic[4] = {0,};
+    size_t len = fread(magic, 1, sizeof(magic), stream);
+    rewind(stream);
+    if(len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return ARCHIVE_GZIP;
+    if(len == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) return ARCHIVE_ZSTD;
+    return ARCHIVE_PLAIN;
+}
+
+// only sniffs the format, returns 1 if the file couldn't be opened
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int archive_format(const char* path, ArchiveFormat* format) {
+    FILE* stream = fopen(path, "rb");
+    if(stream == NULL) {
+        LOG_ERROR("Stream couldn't be opened.");
+        return 1;
+    }
+    *format = archive_detect(stream);
+    fclose(stream);
+    return 0;
+}
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static void Archive_close(Archive* archive) {
+    if(archive->stream != NULL) fclose(archive->stream);
+    free(archive->gzip);
+    ZSTD_freeDStream(archive->zstd);
+    free((void*) archive->zstd_in.src);
+    memset(archive, 0, sizeof(Archive));
+}
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int Archive_open(Archive* archive, const char* path) {
+    memset(archive, 0, sizeof(Archive));
+    archive->stream = fopen(path, "rb");
+    if(archive->stream == NULL) {
+        LOG_ERROR("Stream couldn't be opened.");
+        return 1;
+    }
+    archive->format = archive_detect(archive->stream);
+    switch(archive->format) {
+        case ARCHIVE_PLAIN: break;
+        case ARCHIVE_GZIP:
+            archive->gzip = (GzipStream*) malloc(sizeof(GzipStream));
+            if(archive->gzip == NULL) {
+                LOG_ERROR("Unable to allocate gzip decoder.");
+                Archive_close(archive);
+                return 1;
+            }
+            if(GzipStream_init(archive->gzip, archive->stream)) {
+                Archive_close(archive);
+                return 1;
+            }
+            break;
+        case ARCHIVE_ZSTD:
+            archive->zstd = ZSTD_createDStream();
+            archive->zstd_cap = ZSTD_DStreamInSize();
+            archive->zstd_in.src = malloc(archive->zstd_cap);
+            if(archive->zstd == NULL || archive->zstd_in.src == NULL) {
+                LOG_ERROR("Unable to allocate zstd decoder.");
+                Archive_close(archive);
+                return 1;
+            }
+            ZSTD_initDStream(archive->zstd);
+            break;
+    }
+    return 0;
+}
+
+static size_t archive_read_zstd(Archive* archive, void* buf, size_t cap) {
+    ZSTD_outBuffer out = { .dst = buf, .size = cap, .pos = 0 };
+    while(out.pos == 0) {
+        if(archive->zstd_in.pos == archive->zstd_in.size) {
+            archive->zstd_in.size = fread((void*) archive->zstd_in.src, 1, archive->zstd_cap, archive->stream);
+            archive->zstd_in.pos = 0;
+            if(archive->zstd_in.size == 0) {
+                // a non-zero hint means the decoder is still inside a frame
+                if(archive->zstd_hint != 0 || ferror(archive->stream)) {
+                    LOG_ERROR("Compressed data is corrupt or truncated.");
+                    archive->failure = 1;
+                }
+                break;
+            }
+        }
+        archive->zstd_hint = ZSTD_decompressStream(archive->zstd, &out, &(archive->zstd_in));
+        if(ZSTD_isError(archive->zstd_hint)) {
+            LOG_ERROR("Compressed data is corrupt or truncated.");
+            archive->failure = 1;
+            return 0;
+        }
+    }
+    return out.pos;
+}
+
+// fills buf with up to cap decompressed bytes
+// returns the number of bytes read, 0 at the end of the data or on failure, which sets failure
+#pragma GCC diagnostic ignored "-Wunused-function"
+static size_t Archive_read(Archive* archive, void* buf, size_t cap) {
+    size_t len = 0;
+    if(archive->failure || cap == 0) return 0;
+    switch(archive->format) {
+        case ARCHIVE_PLAIN:
+            len = fread(buf, 1, cap, archive->stream);
+            if(len == 0 && ferror(archive->stream)) {
+                LOG_ERROR("Failed to read from stream.");
+                archive->failure = 1;
+            }
+            break;
+        case ARCHIVE_GZIP:
+            len = GzipStream_read(archive->gzip, (unsigned char*) buf, cap);
+            archive->failure = archive->gzip->inflate.failure;
+            break;
+        case ARCHIVE_ZSTD:
+            len = archive_read_zstd(archive, buf, cap);
+            break;
+    }
+    return len;
+}
+
+#endif /* __ARCHIVE_H__ */
@@ -0,0 +1,132 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// every allocation is aligned to this
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(bytes) (((bytes) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+// requests larger than a quarter block get a block of their own, which can be resized in place
+#define ARENA_DEDICATED_DIVISOR 4
+
+typedef struct __ARENA_H__Block ArenaBlock;
+struct __ARENA_H__Block {
+    ArenaBlock* next;
+    size_t used, cap;
+    unsigned int dedicated;
+};
+#define ARENA_BLOCK_HEADER ARENA_ROUND(sizeof(ArenaBlock))
+#define ARENA_BLOCK_DATA(block) ((char*) (block) + ARENA_BLOCK_HEADER)
+
+// region allocator, everything allocated from it is released at once by Arena_release
+// small allocations are bumped out of the newest shared block, so objects allocated together sit together
+// the Arena itself lives at the start of its first block, it isn't thread-safe
+typedef struct {
+    ArenaBlock* head;
+    size_t block_bytes;
+} Arena;
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static ArenaBlock* ArenaBlock_alloc(size_t cap, unsigned int dedicated) {
+    ArenaBlock* block = (ArenaBlock*) malloc(ARENA_BLOCK_HEADER + cap);
+    if(block == NULL) return NULL;
+    block->next = NULL;
+    block->used = 0;
+    block->cap = cap;
+    block->dedicated = dedicated;
+    return block;
+}
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static Arena* Arena_create(size_t block_bytes) {
+    block_bytes = ARENA_ROUND(block_bytes);
+    if(block_bytes < ARENA_ROUND(sizeof(Arena))) block_bytes = ARENA_ROUND(sizeof(Arena));
+    ArenaBlock* block = ArenaBlock_alloc(block_bytes, 0);
+    if(block == NULL) return NULL;
+    Arena* arena = (Arena*) ARENA_BLOCK_DATA(block);
+    block->used = ARENA_ROUND(sizeof(Arena));
+    arena->head = block;
+    arena->block_bytes = block_bytes;
+    return arena;
+}
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static void* Arena_alloc(Arena* arena, size_t bytes) {
+    bytes = ARENA_ROUND(bytes);
+    ArenaBlock* block = arena->head;
+    if(block->cap - block->used >= bytes) {
+        block->used += bytes;
+        return ARENA_BLOCK_DATA(block) + block->used - bytes;
+    }
+    if(bytes > arena->block_bytes / ARENA_DEDICATED_DIVISOR) {
+        // kept behind the head, so the rest of the shared block is still used
+        block = ArenaBlock_alloc(bytes, 1);
+        if(block == NULL) return NULL;
+        block->used = bytes;
+        block->next = arena->head->next;
+        arena->head->next = block;
+        return ARENA_BLOCK_DATA(block);
+    }
+    block = ArenaBlock_alloc(arena->block_bytes, 0);
+    if(block == NULL) return NULL;
+    block->used = bytes;
+    block->next = arena->head;
+    arena->head = block;
+    return ARENA_BLOCK_DATA(block);
+}
+
+// resizes an allocation of old_bytes, which keeps its contents up to the smaller size
+// dedicated blocks and the newest allocation of the head block are resized in place, others are copied
+// on failure NULL is returned and ptr stays valid
+#pragma GCC diagnostic ignored "-Wunused-function"
+static void* Arena_realloc(Arena* arena, void* ptr, size_t old_bytes, size_t bytes) {
+    if(ptr == NULL) return Arena_alloc(arena, bytes);
+    old_bytes = ARENA_ROUND(old_bytes);
+    bytes = ARENA_ROUND(bytes);
+    ArenaBlock* head = arena->head;
+    if((char*) ptr + old_bytes == ARENA_BLOCK_DATA(head) + head->used && head->used - old_bytes + bytes <= head->cap) {
+        head->used = head->used - old_bytes + bytes;
+        return ptr;
+    }
+    ArenaBlock* prev = head;
+    ArenaBlock* block;
+    for(block = head->next; block != NULL && ARENA_BLOCK_DATA(block) != (char*) ptr; block = block->next) prev = block;
+    if(block != NULL && block->dedicated) {
+        block = (ArenaBlock*) realloc(block, ARENA_BLOCK_HEADER + bytes);
+        if(block == NULL) return NULL;
+        block->used = bytes;
+        block->cap = bytes;
+        prev->next = block;
+        return ARENA_BLOCK_DATA(block);
+    }
+    void* moved = Arena_alloc(arena, bytes);
+    if(moved == NULL) return NULL;
+    memcpy(moved, ptr, (old_bytes < bytes) ? old_bytes : bytes);
+    return moved;
+}
+
+// bytes held by every block, headers included
+#pragma GCC diagnostic ignored "-Wunused-function"
+static size_t Arena_bytes(const Arena* arena) {
+    size_t bytes = 0;
+    if(arena == NULL) return 0;
+    for(const ArenaBlock* block = arena->head; block != NULL; block = block->next) bytes += ARENA_BLOCK_HEADER + block->cap;
+    return bytes;
+}
+
+// frees every block, including the one holding the Arena
+#pragma GCC diagnostic ignored "-Wunused-function"
+static void Arena_release(Arena* arena) {
+    if(arena == NULL) return;
+    ArenaBlock* block = arena->head;
+    ArenaBlock* temp;
+    while(block != NULL) {
+        temp = block->next;
+        free(block);
+        block = temp;
+    }
+}
+
+#endif /* __ARENA_H__ */
@@ -0,0 +1,100 @@
+#ifndef __FWATCH_H__
+#define __FWATCH_H__
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "log.h"
+#ifdef __linux__
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/inotify.h>
+#endif
+
+// notices when the file at a path has been rewritten
+// the parent directory is watched, so editors and generators which replace the file by renaming are caught too
+// elsewhere the file's modification time is polled instead
+typedef struct {
+    int fd, wd;
+    char* name;
+    struct stat info;
+} FileWatch;
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int FileWatch_init(FileWatch* watch, const char* path) {
+    memset(watch, 0, sizeof(FileWatch));
+    watch->fd = -1;
+    watch->name = strdup(path);
+    if(watch->name == NULL) {
+        LOG_ERROR("Unable to allocate watched path.");
+        return 1;
+    }
+    if(stat(path, &(watch->info)) != 0) {
+        LOG_ERROR("Unable to stat watched file.");
+        free(watch->name);
+        return 1;
+    }
+#ifdef __linux__
+    char* dir = strdup(path);
+    if(dir == NULL) {
+        LOG_ERROR("Unable to allocate watched path.");
+        free(watch->name);
+        return 1;
+    }
+    char* slash = strrchr(dir, '/');
+    const char* dir_path = ".";
+    if(slash == dir) dir_path = "/";
+    else if(slash != NULL) {
+        *slash = '\0';
+        dir_path = dir;
+    }
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(watch->fd >= 0) watch->wd = inotify_add_watch(watch->fd, dir_path, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(watch->fd < 0 || watch->wd < 0) {
+        LOG_INFO("Unable to watch schedule with inotify. Polling its modification time instead.");
+        if(watch->fd >= 0) close(watch->fd);
+        watch->fd = -1;
+    } else {
+        // events only carry the file name
+        strcpy(watch->name, (slash == NULL) ? path : path + (slash - dir) + 1);
+    }
+    free(dir);
+#endif
+    return 0;
+}
+
+// returns 1 if the file was written to since the last call, never blocks
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int FileWatch_changed(FileWatch* watch) {
+#ifdef __linux__
+    if(watch->fd >= 0) {
+        char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+        const struct inotify_event* event;
+        unsigned int changed = 0;
+        ssize_t len;
+        // drain every queued event, a single save can produce several
+        while((len = read(watch->fd, buf, sizeof(buf))) > 0) {
+            for(char* ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + event->len) {
+                event = (const struct inotify_event*) ptr;
+                if(event->len > 0 && strcmp(event->name, watch->name) == 0) changed = 1;
+            }
+        }
+        return changed;
+    }
+#endif
+    struct stat info;
+    if(stat(watch->name, &info) != 0) return 0;
+    unsigned int changed = info.st_mtime != watch->info.st_mtime || info.st_size != watch->info.st_size;
+    watch->info = info;
+    return changed;
+}
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static void FileWatch_free(FileWatch watch) {
+#ifdef __linux__
+    if(watch.fd >= 0) close(watch.fd);
+#endif
+    free(watch.name);
+}
+
+#endif /* __FWATCH_H__ */
@@ -0,0 +1,394 @@
+#ifndef __GZIP_H__
+#define __GZIP_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "log.h"
+
+// Streaming gzip (RFC 1952) and DEFLATE (RFC 1951) decoder
+// compressed input is pulled from a FILE through a fixed buffer and output is produced in pieces of any size
+// only the 32 KiB window that matches can refer back into is kept between reads
+#define INFLATE_WINDOW (1 << 15)
+#define INFLATE_INPUT (1 << 16)
+#define INFLATE_MAX_BITS 15
+
+typedef enum {
+    INFLATE_HEADER,
+    INFLATE_STORED,
+    INFLATE_CODES,
+    INFLATE_DONE
+} InflateMode;
+
+typedef struct {
+    FILE* stream;
+    unsigned char in[INFLATE_INPUT];
+    size_t in_pos, in_len;
+    // bits are consumed from the bottom, padding holds the zero bytes appended past the end of the input
+    uint64_t bit_buf;
+    unsigned int bit_count, padding;
+    unsigned int failure;
+    InflateMode mode;
+    unsigned int last;
+    size_t stored_left, match_left, match_dist;
+    // tables map the next table_bits input bits to (symbol << 4 | code length), 0 marks an unused code
+    uint16_t lit[1 << INFLATE_MAX_BITS], dist[1 << INFLATE_MAX_BITS];
+    unsigned int lit_bits, dist_bits;
+    unsigned char window[INFLATE_WINDOW];
+    uint64_t total_out;
+} Inflate;
+
+static const uint16_t InflateLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t InflateLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t InflateDistBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t InflateDistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t InflateCodeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static void Inflate_init(Inflate* z, FILE* stream) {
+    z->stream = stream;
+    z->in_pos = 0;
+    z->in_len = 0;
+    z->bit_buf = 0;
+    z->bit_count = 0;
+    z->padding = 0;
+    z->failure = 0;
+    z->mode = INFLATE_HEADER;
+    z->last = 0;
+    z->stored_left = 0;
+    z->match_left = 0;
+    z->match_dist = 0;
+    z->total_out = 0;
+}
+
+// starts a new DEFLATE stream, keeping whatever input was already buffered
+#pragma GCC diagnostic ignored "-Wunused-function"
+static void Inflate_restart(Inflate* z) {
+    z->mode = INFLATE_HEADER;
+    z->last = 0;
+    z->stored_left = 0;
+    z->match_left = 0;
+    z->total_out = 0;
+}
+
+// tops the bit buffer up to at least count bits, past the end of the input it's padded with zeros
+static inline void inflate_need(Inflate* z, unsigned int count) {
+    while(z->bit_count < count) {
+        if(z->in_pos == z->in_len) {
+            z->in_len = fread(z->in, 1, INFLATE_INPUT, z->stream);
+            z->in_pos = 0;
+            if(z->in_len == 0) {
+                z->padding++;
+                z->bit_count += 8;
+                continue;
+            }
+        }
+        z->bit_buf |= (uint64_t) z->in[(z->in_pos)++] << z->bit_count;
+        z->bit_count += 8;
+    }
+}
+
+// consuming any of the padding means the input was truncated
+static inline void inflate_drop(Inflate* z, unsigned int count) {
+    z->bit_buf >>= count;
+    z->bit_count -= count;
+    if(z->bit_count < z->padding * 8) z->failure = 1;
+}
+
+static inline uint32_t inflate_bits(Inflate* z, unsigned int count) {
+    if(count == 0) return 0;
+    inflate_need(z, count);
+    uint32_t bits = (uint32_t) (z->bit_buf & ((1ULL << count) - 1));
+    inflate_drop(z, count);
+    return bits;
+}
+
+static inline void inflate_align(Inflate* z) {
+    inflate_drop(z, z->bit_count % 8);
+}
+
+static inline int inflate_decode(Inflate* z, const uint16_t* table, unsigned int table_bits) {
+    inflate_need(z, table_bits);
+    uint16_t entry = table[z->bit_buf & ((1ULL << table_bits) - 1)];
+    if((entry & 15) == 0) {
+        z->failure = 1;
+        return -1;
+    }
+    inflate_drop(z, entry & 15);
+    return entry >> 4;
+}
+
+// builds a lookup table for the canonical code described by lengths
+// incomplete codes are allowed, their unused entries fail when decoded
+static unsigned int inflate_build(uint16_t* table, unsigned int* table_bits, const uint8_t* lengths, size_t count) {
+    uint16_t counts[INFLATE_MAX_BITS + 1] = {0,}, next[INFLATE_MAX_BITS + 1];
+    size_t i;
+    unsigned int len, max = 0;
+    for(i = 0; i < count; ++i) {
+        counts[lengths[i]]++;
+        if(lengths[i] > max) max = lengths[i];
+    }
+    int left = 1;
+    for(len = 1; len <= INFLATE_MAX_BITS; ++len) {
+        left <<= 1;
+        left -= counts[len];
+        if(left < 0) return 1;
+    }
+    next[1] = 0;
+    for(len = 1; len < INFLATE_MAX_BITS; ++len) next[len + 1] = (uint16_t) ((next[len] + counts[len]) << 1);
+    *table_bits = max;
+    memset(table, 0, ((size_t) 1 << max) * sizeof(uint16_t));
+    uint32_t code, rev;
+    unsigned int j;
+    for(i = 0; i < count; ++i) {
+        len = lengths[i];
+        if(len == 0) continue;
+        code = next[len]++;
+        // codes are packed starting from their most significant bit
+        for(rev = 0, j = 0; j < len; ++j) rev |= ((code >> j) & 1) << (len - 1 - j);
+        for(; rev < (1u << max); rev += 1u << len) table[rev] = (uint16_t) ((i << 4) | len);
+    }
+    return 0;
+}
+
+static unsigned int inflate_fixed(Inflate* z) {
+    uint8_t lengths[288];
+    size_t i;
+    for(i = 0; i < 144; ++i) lengths[i] = 8;
+    for(; i < 256; ++i) lengths[i] = 9;
+    for(; i < 280; ++i) lengths[i] = 7;
+    for(; i < 288; ++i) lengths[i] = 8;
+    if(inflate_build(z->lit, &(z->lit_bits), lengths, 288)) return 1;
+    for(i = 0; i < 30; ++i) lengths[i] = 5;
+    return inflate_build(z->dist, &(z->dist_bits), lengths, 30);
+}
+
+static unsigned int inflate_dynamic(Inflate* z) {
+    size_t lit_count = inflate_bits(z, 5) + 257;
+    size_t dist_count = inflate_bits(z, 5) + 1;
+    size_t cl_count = inflate_bits(z, 4) + 4;
+    if(lit_count > 286 || dist_count > 30) return 1;
+    uint8_t lengths[288 + 32];
+    size_t i;
+    memset(lengths, 0, 19);
+    for(i = 0; i < cl_count; ++i) lengths[InflateCodeLengthOrder[i]] = (uint8_t) inflate_bits(z, 3);
+    // the code length code is decoded through the distance table, which isn't built yet
+    if(inflate_build(z->dist, &(z->dist_bits), lengths, 19)) return 1;
+    int sym;
+    uint8_t prev;
+    size_t repeat;
+    for(i = 0; i < lit_count + dist_count;) {
+        sym = inflate_decode(z, z->dist, z->dist_bits);
+        if(sym < 0) return 1;
+        if(sym < 16) {
+            lengths[i++] = (uint8_t) sym;
+            continue;
+        }
+        prev = 0;
+        if(sym == 16) {
+            if(i == 0) return 1;
+            prev = lengths[i - 1];
+            repeat = 3 + inflate_bits(z, 2);
+        } else if(sym == 17) {
+            repeat = 3 + inflate_bits(z, 3);
+        } else {
+            repeat = 11 + inflate_bits(z, 7);
+        }
+        if(i + repeat > lit_count + dist_count) return 1;
+        while(repeat--) lengths[i++] = prev;
+    }
+    // every block has to be able to end
+    if(lengths[256] == 0) return 1;
+    if(inflate_build(z->lit, &(z->lit_bits), lengths, lit_count)) return 1;
+    return inflate_build(z->dist, &(z->dist_bits), &(lengths[lit_count]), dist_count);
+}
+
+static inline void inflate_emit(Inflate* z, unsigned char* out, size_t* produced, unsigned char byte) {
+    out[(*produced)++] = byte;
+    z->window[z->total_out % INFLATE_WINDOW] = byte;
+    z->total_out++;
+}
+
+// decompresses up to cap bytes into out
+// returns the number of bytes written, which is only 0 once the final block has ended or on failure
+#pragma GCC diagnostic ignored "-Wunused-function"
+static size_t Inflate_read(Inflate* z, unsigned char* out, size_t cap) {
+    size_t produced = 0;
+    int sym;
+    uint32_t header;
+    while(produced < cap && !(z->failure)) {
+        // finish the match that filled the previous read
+        if(z->match_left > 0) {
+            for(; z->match_left > 0 && produced < cap; --(z->match_left)) {
+                inflate_emit(z, out, &produced, z->window[(z->total_out - z->match_dist) % INFLATE_WINDOW]);
+            }
+            continue;
+        }
+        if(z->mode == INFLATE_DONE) break;
+        if(z->mode == INFLATE_HEADER) {
+            if(z->last) {
+                z->mode = INFLATE_DONE;
+                break;
+            }
+            header = inflate_bits(z, 3);
+            z->last = header & 1;
+            switch(header >> 1) {
+                case 0:
+                    inflate_align(z);
+                    header = inflate_bits(z, 16);
+                    if((header ^ 0xffff) != inflate_bits(z, 16)) z->failure = 1;
+                    z->stored_left = header;
+                    z->mode = INFLATE_STORED;
+                    break;
+                case 1:
+                    z->failure |= inflate_fixed(z);
+                    z->mode = INFLATE_CODES;
+                    break;
+                case 2:
+                    z->failure |= inflate_dynamic(z);
+                    z->mode = INFLATE_CODES;
+                    break;
+                default:
+                    z->failure = 1;
+            }
+        } else if(z->mode == INFLATE_STORED) {
+            for(; z->stored_left > 0 && produced < cap && !(z->failure); --(z->stored_left)) {
+                inflate_emit(z, out, &produced, (unsigned char) inflate_bits(z, 8));
+            }
+            if(z->stored_left == 0) z->mode = INFLATE_HEADER;
+        } else {
+            while(produced < cap) {
+                sym = inflate_decode(z, z->lit, z->lit_bits);
+                if(sym < 0) break;
+                if(sym < 256) {
+                    inflate_emit(z, out, &produced, (unsigned char) sym);
+                    continue;
+                }
+                if(sym == 256) {
+                    z->mode = INFLATE_HEADER;
+                    break;
+                }
+                sym -= 257;
+                if(sym >= 29) {
+                    z->failure = 1;
+                    break;
+                }
+                z->match_left = InflateLengthBase[sym] + inflate_bits(z, InflateLengthExtra[sym]);
+                sym = inflate_decode(z, z->dist, z->dist_bits);
+                if(sym < 0 || sym >= 30) {
+                    z->failure = 1;
+                    break;
+                }
+                z->match_dist = InflateDistBase[sym] + inflate_bits(z, InflateDistExtra[sym]);
+                if(z->match_dist > z->total_out) {
+                    z->failure = 1;
+                    break;
+                }
+                for(; z->match_left > 0 && produced < cap; --(z->match_left)) {
+                    inflate_emit(z, out, &produced, z->window[(z->total_out - z->match_dist) % INFLATE_WINDOW]);
+                }
+            }
+        }
+    }
+    if(z->failure) {
+        LOG_ERROR("Compressed data is corrupt or truncated.");
+        return 0;
+    }
+    return produced;
+}
+
+// gzip wraps DEFLATE streams (members) with a header and a CRC-32/size trailer
+// concatenated members decompress to the concatenation of their contents
+typedef struct {
+    Inflate inflate;
+    uint32_t crc, size;
+    uint32_t crc_table[256];
+    unsigned int done;
+} GzipStream;
+
+static unsigned int gzip_header(GzipStream* gz) {
+    Inflate* z = &(gz->inflate);
+    if(inflate_bits(z, 8) != 0x1f || inflate_bits(z, 8) != 0x8b || inflate_bits(z, 8) != 8) return 1;
+    uint32_t flags = inflate_bits(z, 8);
+    // skip mtime, extra flags and the OS
+    inflate_bits(z, 16);
+    inflate_bits(z, 16);
+    inflate_bits(z, 16);
+    if(flags & 4) {
+        for(uint32_t extra = inflate_bits(z, 16); extra > 0 && !(z->failure); --extra) inflate_bits(z, 8);
+    }
+    // original file name, then comment
+    if(flags & 8) while(inflate_bits(z, 8) != 0 && !(z->failure));
+    if(flags & 16) while(inflate_bits(z, 8) != 0 && !(z->failure));
+    if(flags & 2) inflate_bits(z, 16);
+    gz->crc = 0xffffffffu;
+    gz->size = 0;
+    Inflate_restart(z);
+    return z->failure || (flags & 0xe0) != 0;
+}
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int GzipStream_init(GzipStream* gz, FILE* stream) {
+    uint32_t crc, i, j;
+    for(i = 0; i < 256; ++i) {
+        for(crc = i, j = 0; j < 8; ++j) crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320u : crc >> 1;
+        gz->crc_table[i] = crc;
+    }
+    Inflate_init(&(gz->inflate), stream);
+    gz->done = 0;
+    if(gzip_header(gz)) {
+        LOG_ERROR("Invalid gzip header.");
+        return 1;
+    }
+    return 0;
+}
+
+// same as Inflate_read, but checks every member's trailer and continues into the next one
+#pragma GCC diagnostic ignored "-Wunused-function"
+static size_t GzipStream_read(GzipStream* gz, unsigned char* out, size_t cap) {
+    Inflate* z = &(gz->inflate);
+    size_t produced, i;
+    uint32_t crc;
+    while(!(gz->done)) {
+        produced = Inflate_read(z, out, cap);
+        if(z->failure) return 0;
+        if(produced > 0) {
+            for(crc = gz->crc, i = 0; i < produced; ++i) crc = gz->crc_table[(crc ^ out[i]) & 0xff] ^ (crc >> 8);
+            gz->crc = crc;
+            gz->size += (uint32_t) produced;
+            return produced;
+        }
+        inflate_align(z);
+        crc = inflate_bits(z, 16);
+        crc |= inflate_bits(z, 16) << 16;
+        i = inflate_bits(z, 16);
+        i |= (size_t) inflate_bits(z, 16) << 16;
+        if(z->failure || crc != (gz->crc ^ 0xffffffffu) || (uint32_t) i != gz->size) {
+            LOG_ERROR("gzip member failed its integrity check.");
+            z->failure = 1;
+            return 0;
+        }
+        // anything other than another member after the trailer is ignored
+        inflate_need(z, 8);
+        if(z->padding > 0 || (z->bit_buf & 0xff) != 0x1f) {
+            gz->done = 1;
+        } else if(gzip_header(gz)) {
+            LOG_ERROR("Invalid gzip header.");
+            z->failure = 1;
+            return 0;
+        }
+    }
+    return 0;
+}
+
+#endif /* __GZIP_H__ */
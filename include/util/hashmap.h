@@ -5,119 +5,220 @@
 #include <stdlib.h>
 #include <string.h>
 #include "log.h"
+#include "arena.h"
 
-typedef struct __HASHMAP_H__Node Node;
-struct __HASHMAP_H__Node {
-    Node* next;
-    char contents[];
-};
+// keys are stored inline, zero-padded to a fixed width, so they're compared a word at a time
+#define HASHMAP_KEY_BYTES 16
+#define HASHMAP_KEY_WORDS (HASHMAP_KEY_BYTES / sizeof(uint64_t))
+// the table grows once it would be more than 7/8 full
+#define HASHMAP_LOAD_NUM 7
+#define HASHMAP_LOAD_DEN 8
+#define HASHMAP_MIN_CAP 8
+// HashMap_insert's result if the key was already present, the map is left unchanged
+#define HASHMAP_DUPLICATE 2
 
-#pragma GCC diagnostic ignored "-Wunused-function"
-static Node* Node_alloc(const char* key, const void* val, size_t bytes_per_elem) {
-    size_t bytes_per_key = sizeof(char) * (strlen(key) + 1);
-    Node* node = (Node*) malloc(sizeof(Node) + bytes_per_key + bytes_per_elem);
-    if(node == NULL) return NULL;
-    node->next = NULL;
-    strcpy(node->contents, key);
-    memcpy(&(node->contents[bytes_per_key]), (char*) val, bytes_per_elem);
-    return node;
-}
+typedef union {
+    char str[HASHMAP_KEY_BYTES];
+    uint64_t words[HASHMAP_KEY_WORDS];
+} HashKey;
 
-#pragma GCC diagnostic ignored "-Wunused-function"
-static void* Node_value(Node* node) {
-    return (void*) &(node->contents[strlen(node->contents) + 1]);
-}
+// a slot's value follows it inline, hash is 0 for an empty slot
+typedef struct {
+    HashKey key;
+    uint32_t hash;
+} HashSlot;
 
+// open addressing with Robin Hood probing over a single array of slots
+// an entry never sits further from its home slot than the entry after it, so a lookup stops at the first closer one
+// slots come from arena if it isn't NULL, they're then released with it instead of by HashMap_free
+// values move as the table changes, pointers returned by HashMap_get are only valid until the next insert
 typedef struct {
     size_t size;
     size_t bytes_per_elem;
-    size_t bucket_count;
-    Node** buckets;
+    size_t cap; // a power of two, the two slots past it hold entries being moved during an insert
+    size_t slot_bytes;
+    unsigned char* slots;
+    Arena* arena;
 } HashMap;
 
+#define HASHMAP_SLOT(hm, i) ((HashSlot*) ((hm)->slots + (i) * (hm)->slot_bytes))
+#define HASHMAP_VALUE(slot) ((void*) ((unsigned char*) (slot) + sizeof(HashSlot)))
+
+// fails if key doesn't fit
 #pragma GCC diagnostic ignored "-Wunused-function"
-static unsigned int HashMap_init(HashMap* hm, size_t bucket_count, size_t bytes_per_elem) {
+static unsigned int HashKey_init(HashKey* hk, const char* key) {
+    size_t len = strlen(key);
+    if(len >= HASHMAP_KEY_BYTES) return 1;
+    memset(hk, 0, sizeof(HashKey));
+    memcpy(hk->str, key, len);
+    return 0;
+}
+
+// never 0, so every hash can be told apart from an empty slot
+#pragma GCC diagnostic ignored "-Wunused-function"
+static uint32_t HashKey_hash(const HashKey* hk) {
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+    for(size_t i = 0; i < HASHMAP_KEY_WORDS; ++i) {
+        h = (h ^ hk->words[i]) * 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 31;
+    }
+    h *= 0x94d049bb133111ebull;
+    return (uint32_t) (h >> 32) | 0x80000000u;
+}
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int HashKey_equal(const HashKey* a, const HashKey* b) {
+    for(size_t i = 0; i < HASHMAP_KEY_WORDS; ++i) if(a->words[i] != b->words[i]) return 0;
+    return 1;
+}
+
+// allocates an empty table of cap slots, the current one isn't touched
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned char* HashMap_alloc_slots(HashMap* hm, size_t cap) {
+    size_t bytes = (cap + 2) * hm->slot_bytes;
+    unsigned char* slots = (unsigned char*) ((hm->arena == NULL) ? malloc(bytes) : Arena_alloc(hm->arena, bytes));
+    if(slots != NULL) memset(slots, 0, bytes);
+    return slots;
+}
+
+// capacity is rounded up to a power of two, it's only a hint since the table grows as needed
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int HashMap_init_in(HashMap* hm, Arena* arena, size_t capacity, size_t bytes_per_elem) {
+    size_t cap = HASHMAP_MIN_CAP;
+    while(cap < capacity) cap *= 2;
     hm->size = 0;
     hm->bytes_per_elem = bytes_per_elem;
-    hm->bucket_count = bucket_count;
-    void* buckets = calloc(bucket_count, sizeof(Node*));
-    if(buckets == NULL) {
+    hm->cap = cap;
+    hm->slot_bytes = (sizeof(HashSlot) + bytes_per_elem + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    hm->arena = arena;
+    hm->slots = HashMap_alloc_slots(hm, cap);
+    if(hm->slots == NULL) {
+        hm->cap = 0;
         LOG_ERROR("Failed to allocate HashMap.");
         return 1;
     }
-    hm->buckets = (Node**) buckets;
     return 0;
 }
 
 #pragma GCC diagnostic ignored "-Wunused-function"
-#pragma GCC diagnostic ignored "-Wsign-conversion"
-static size_t hash(size_t bucket_count, const char* const key) {
-    const char* key_inner = key;
-    const size_t BASE = 0x811c9dc5;
-    const size_t PRIME = 0x01000193;
-    size_t initial = BASE;
-    while(*key_inner) {
-        initial ^= *key_inner++;
-        initial *= PRIME;
+static unsigned int HashMap_init(HashMap* hm, size_t capacity, size_t bytes_per_elem) {
+    return HashMap_init_in(hm, NULL, capacity, bytes_per_elem);
+}
+
+// slot holding hk, NULL if it isn't present
+#pragma GCC diagnostic ignored "-Wunused-function"
+static HashSlot* HashMap_find(const HashMap* hm, const HashKey* hk, uint32_t hash) {
+    if(hm->cap == 0) return NULL;
+    size_t mask = hm->cap - 1, i = hash & mask, dist;
+    HashSlot* slot;
+    for(dist = 0;; ++dist, i = (i + 1) & mask) {
+        slot = HASHMAP_SLOT(hm, i);
+        if(slot->hash == 0 || ((i - (slot->hash & mask)) & mask) < dist) return NULL;
+        if(slot->hash == hash && HashKey_equal(&(slot->key), hk)) return slot;
+    }
+}
+
+// places the entry held in the carry slot (cap), which must not be present yet
+// richer entries are displaced along the probe sequence through the spare slot (cap + 1)
+#pragma GCC diagnostic ignored "-Wunused-function"
+static void HashMap_place(HashMap* hm) {
+    size_t mask = hm->cap - 1, dist, slot_dist;
+    HashSlot* carry = HASHMAP_SLOT(hm, hm->cap);
+    HashSlot* spare = HASHMAP_SLOT(hm, hm->cap + 1);
+    HashSlot* slot;
+    size_t i = carry->hash & mask;
+    for(dist = 0;; ++dist, i = (i + 1) & mask) {
+        slot = HASHMAP_SLOT(hm, i);
+        if(slot->hash == 0) {
+            memcpy(slot, carry, hm->slot_bytes);
+            hm->size++;
+            return;
+        }
+        slot_dist = (i - (slot->hash & mask)) & mask;
+        if(slot_dist < dist) {
+            memcpy(spare, slot, hm->slot_bytes);
+            memcpy(slot, carry, hm->slot_bytes);
+            memcpy(carry, spare, hm->slot_bytes);
+            dist = slot_dist;
+        }
+    }
+}
+
+// moves every entry into a table of cap slots
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int HashMap_resize(HashMap* hm, size_t cap) {
+    unsigned char* slots = HashMap_alloc_slots(hm, cap);
+    if(slots == NULL) return 1;
+    HashMap prev = *hm;
+    hm->slots = slots;
+    hm->cap = cap;
+    hm->size = 0;
+    HashSlot* slot;
+    for(size_t i = 0; i < prev.cap; ++i) {
+        slot = HASHMAP_SLOT(&prev, i);
+        if(slot->hash == 0) continue;
+        memcpy(HASHMAP_SLOT(hm, cap), slot, hm->slot_bytes);
+        HashMap_place(hm);
+    }
+    // a table in an arena is left to it
+    if(hm->arena == NULL) free(prev.slots);
+    return 0;
+}
+
+// makes room for count entries, so inserting that many won't grow the table
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int HashMap_reserve(HashMap* hm, size_t count) {
+    size_t cap = (hm->cap == 0) ? HASHMAP_MIN_CAP : hm->cap;
+    while(count * HASHMAP_LOAD_DEN > cap * HASHMAP_LOAD_NUM) cap *= 2;
+    if(cap == hm->cap) return 0;
+    if(HashMap_resize(hm, cap)) {
+        LOG_ERROR("Unable to grow HashMap.");
+        return 1;
     }
-    return initial & (bucket_count - 1);
+    return 0;
 }
 
+// returns HASHMAP_DUPLICATE if key is already present, 1 if it's too long or the table couldn't grow
 #pragma GCC diagnostic ignored "-Wunused-function"
 static unsigned int HashMap_insert(HashMap* hm, const char* const key, const void* const val) {
-    hm->size++;
-    Node* bucket = hm->buckets[hash(hm->bucket_count, key)];
-    Node* node;
-    if(bucket == NULL) {
-        node = Node_alloc(key, val, hm->bytes_per_elem);
-        hm->buckets[hash(hm->bucket_count, key)] = node;
-    } else {
-        while(bucket->next != NULL) bucket = bucket->next;
-        bucket->next = Node_alloc(key, val, hm->bytes_per_elem);
-        node = bucket->next;
+    HashKey hk;
+    if(HashKey_init(&hk, key)) {
+        LOG_ERROR("Unable to insert value in HashMap, the key is too long.");
+        return 1;
     }
-    if(node == NULL) {
+    uint32_t hash = HashKey_hash(&hk);
+    if(HashMap_find(hm, &hk, hash) != NULL) return HASHMAP_DUPLICATE;
+    if(HashMap_reserve(hm, hm->size + 1)) {
         LOG_ERROR("Unable to insert value in HashMap.");
-        free(node);
         return 1;
     }
+    HashSlot* carry = HASHMAP_SLOT(hm, hm->cap);
+    carry->key = hk;
+    carry->hash = hash;
+    memcpy(HASHMAP_VALUE(carry), val, hm->bytes_per_elem);
+    HashMap_place(hm);
     return 0;
 }
 
 #pragma GCC diagnostic ignored "-Wunused-function"
 static void* HashMap_get(HashMap hm, const char* const key) {
-    Node* node = hm.buckets[hash(hm.bucket_count, key)];
-    while(node != NULL) {
-        if(strcmp(node->contents, key) == 0) return Node_value(node);
-        node = node->next;
-    }
-    return NULL;
+    HashKey hk;
+    if(HashKey_init(&hk, key)) return NULL;
+    HashSlot* slot = HashMap_find(&hm, &hk, HashKey_hash(&hk));
+    return (slot == NULL) ? NULL : HASHMAP_VALUE(slot);
 }
 
 #pragma GCC diagnostic ignored "-Wunused-function"
 static void HashMap_free(HashMap hm) {
-    Node* bucket;
-    Node* temp;
-    for(size_t i = 0; i < hm.bucket_count; ++i) {
-        bucket = hm.buckets[i];
-        while(bucket != NULL) {
-            temp = bucket->next;
-            free(bucket);
-            bucket = temp;
-        }
-    }
-    free(hm.buckets);
+    if(hm.arena == NULL) free(hm.slots);
 }
 
 #pragma GCC diagnostic ignored "-Wunused-function"
 static void HashMap_dump(HashMap hm, void (*func)(char*, void*)) {
-    Node* node;
-    for(size_t i = 0; i < hm.bucket_count; ++i) {
-        node = hm.buckets[i];
-        while(node != NULL) {
-            func(node->contents, Node_value(node));
-            node = node->next;
-        }
+    HashSlot* slot;
+    for(size_t i = 0; i < hm.cap; ++i) {
+        slot = HASHMAP_SLOT(&hm, i);
+        if(slot->hash != 0) func(slot->key.str, HASHMAP_VALUE(slot));
     }
 }
 
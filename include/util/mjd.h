@@ -2,9 +2,7 @@
 #define __MJD_H__
 
 #include <math.h>
-#include <stdio.h>
 #include <stdint.h>
-#include <string.h>
 #include <sofa.h>
 #include <sofam.h>
 #include "log.h"
@@ -15,96 +13,64 @@ typedef struct {
     uint16_t sec;
 } Datetime;
 
-// Accepts a format string of the form "y2d3h2m2s2"
-// Every character pair represents a field and the number of digits in the string it occupies.
-// This function is used for compressed dates like 2025311120000 ("y4d3h2m2s2")
-// Fields can be omitted but not repeated
+// times are counted in milliseconds since TIME_EPOCH_YRS-001 00:00:00, the earliest a $SKED timestamp can name
+// integer times add up exactly, Julian dates are only derived where they're needed
+typedef int64_t TimeMs;
+#define TIME_EPOCH_YRS 1979
+// iauCal2jd(TIME_EPOCH_YRS, 1, 1)
+#define TIME_EPOCH_JD 2443874.5
+#define TIME_MS_PER_SEC ((TimeMs) 1000)
+#define TIME_MS_PER_DAY ((TimeMs) 86400000)
+
+// days from TIME_EPOCH_YRS-001 until yrs-001
 #pragma GCC diagnostic ignored "-Wunused-function"
-static unsigned int Datetime_parse_from_scan(Datetime* dt, const char* format, const char* line) { // TODO: This needs refinement
-    char ord[6] = {'\0',}, fmt[16] = {'\0',};
-    size_t i, j;
-    for(i = 0; i < strlen(format) / 2; ++i) {
-        j = strlen(ord);
-        ord[j] = format[i * 2];
-        ord[j + 1] = '\0';
-        j = strlen(fmt);
-        strcpy(&(fmt[j]), "%*u");
-        fmt[j + 1] = format[i * 2 + 1];
-    }
-    unsigned int tmp, val[strlen(ord)];
-    int ret;
-    // TODO: It might be possible to just stuff all variadic arguments into sscanf regardless of how many are used
-    switch(strlen(ord)) {
-        case 0:
-            LOG_ERROR("Unable to parse Datetime format string.");
-            return 1;
-        case 1: ret = sscanf(line, fmt, &(val[0])); break;
-        case 2: ret = sscanf(line, fmt, &(val[0]), &(val[1])); break;
-        case 3: ret = sscanf(line, fmt, &(val[0]), &(val[1]), &(val[2])); break;
-        case 4: ret = sscanf(line, fmt, &(val[0]), &(val[1]), &(val[2]), &(val[3])); break;
-        case 5: ret = sscanf(line, fmt, &(val[0]), &(val[1]), &(val[2]), &(val[3]), &(val[4])); break;
-        default:
-            LOG_ERROR("Too many Datetime format specifiers provided.");
-            return 1;
-    }
-    j = 0;
-    if(ret != (int) strlen(ord)) {
-        LOG_ERROR("Failed to parse Datetime.");
-        return 1;
-    } else for(i = 0; i < strlen(ord); ++i) {
-        tmp = val[j++];
-        switch(ord[i]) {
-            case 'y': dt->yrs = (uint16_t) tmp; break;
-            case 'd': dt->day = (uint16_t) tmp; break;
-            case 'h': dt->hrs = (uint8_t) tmp; break;
-            case 'm': dt->min = (uint8_t) tmp; break;
-            case 's': dt->sec = (uint16_t) tmp; break;
-            default:
-                LOG_ERROR("Invalid Datetime component symbol.");
-                return 1;
-        }
+static int64_t days_before_year(int64_t yrs) {
+    int64_t prev = yrs - 1, epoch = TIME_EPOCH_YRS - 1;
+    return 365 * (yrs - TIME_EPOCH_YRS) + \
+        (prev / 4 - prev / 100 + prev / 400) - (epoch / 4 - epoch / 100 + epoch / 400);
+}
+
+// fields past their range carry over, so day 366 of a common year is the next year's first day
+#pragma GCC diagnostic ignored "-Wunused-function"
+static TimeMs Datetime_to_ms(Datetime dt) {
+    int64_t days = days_before_year(dt.yrs) + (int64_t) dt.day - 1;
+    return (((days * 24 + dt.hrs) * 60 + dt.min) * 60 + dt.sec) * TIME_MS_PER_SEC;
+}
+
+// milliseconds are truncated
+#pragma GCC diagnostic ignored "-Wunused-function"
+static Datetime Datetime_from_ms(TimeMs ms) {
+    int64_t days = ms / TIME_MS_PER_DAY, secs = ms % TIME_MS_PER_DAY;
+    if(secs < 0) {
+        secs += TIME_MS_PER_DAY;
+        days--;
     }
-    // printf("%s: %hu %hu %hhu %hhu %hhu\n", line, dt->yrs, dt->day, dt->hrs, dt->min, dt->sec);
-    return 0;
+    secs /= TIME_MS_PER_SEC;
+    // a year has at most 366 days, so the estimate never passes the actual year
+    int64_t yrs = TIME_EPOCH_YRS + days / 366 - ((days < 0) ? 1 : 0);
+    while(days_before_year(yrs + 1) <= days) yrs++;
+    return (Datetime) {
+        .yrs = (uint16_t) yrs,
+        .day = (uint16_t) (days - days_before_year(yrs) + 1),
+        .hrs = (uint8_t) (secs / 3600),
+        .min = (uint8_t) (secs / 60 % 60),
+        .sec = (uint16_t) (secs % 60)
+    };
+}
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static Datetime Datetime_add_seconds(Datetime dt, uint32_t secs) {
+    return Datetime_from_ms(Datetime_to_ms(dt) + (TimeMs) secs * TIME_MS_PER_SEC);
 }
 
 #pragma GCC diagnostic ignored "-Wunused-function"
-static Datetime Datetime_add_seconds(Datetime dt, uint16_t secs) {
-    dt.sec += secs;
-    uint16_t days_per_year;
-    while(dt.sec > 60) {
-        dt.sec -= 60;
-        dt.min++;
-        while(dt.min > 60) {
-            dt.min -= 60;
-            dt.hrs++;
-            while(dt.hrs > 24) {
-                dt.hrs -= 24;
-                dt.day++;
-                while(1) {
-                    days_per_year = ((dt.yrs % 4 == 0 && dt.yrs % 100 != 0) || (dt.yrs % 400 == 0)) ? 366 : 365;
-                    if(dt.day > days_per_year) {
-                        dt.day -= days_per_year;
-                        dt.yrs++;
-                    } else {
-                        break;
-                    }
-                }
-            }
-        }
-    }    
-    return dt;
+static inline double TimeMs_to_jd(TimeMs ms) {
+    return TIME_EPOCH_JD + (double) ms / (double) TIME_MS_PER_DAY;
 }
 
 #pragma GCC diagnostic ignored "-Wunused-function"
 static double Datetime_to_jd(Datetime dt) {
-    double jd1, jd2, jd;
-    iauCal2jd((int) dt.yrs, 1, 1, &jd1, &jd2);
-    jd = jd1 + jd2 + ((double) dt.day) - 1.0;
-    jd += (((double) dt.hrs) / 24.0);
-    jd += (((double) dt.min) / 1440.0);
-    jd += (((double) dt.sec) / 86400.0);
-    return jd;
+    return TimeMs_to_jd(Datetime_to_ms(dt));
 }
 
 #pragma GCC diagnostic ignored "-Wunused-function"
@@ -1,12 +1,19 @@
 #include <glenv.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include "globe.h"
 #include "camera.h"
 #include "skd.h"
 #include "skd_pass.h"
+#include "skd_index.h"
+#include "skd_bulk.h"
+#include "skd_query.h"
+#include "skd_baseline.h"
+#include "skd_snapshot.h"
 #include "ui.h"
 #include "util/shaders.h"
+#include "util/fwatch.h"
 
 // window configuration options
 #define WINDOW_TITLE "sked_viewer"
@@ -30,27 +37,255 @@
     .z_far = CAMERA_SCALAR * GLOBE_CONFIG.globe_radius * 2.f,\
 }
 
+// bulk loading configuration options
+#define BULK_MEMORY_CAP ((size_t) 1 << 30)
+
+// dates on the command line are either a year or a year and day of year (2025-030)
+// last selects the final second of the period instead of the first
+static unsigned int parse_index_date(const char* arg, Datetime* dt, unsigned int last) {
+    unsigned int yrs, day;
+    char tail;
+    int ret = sscanf(arg, "%u-%u%c", &yrs, &day, &tail);
+    if(ret == 1) day = last ? 366 : 1;
+    else if(ret != 2 || day == 0 || day > 366) return 1;
+    if(yrs < 1979 || yrs > 2078) return 1;
+    *dt = (Datetime) {
+        .yrs = (uint16_t) yrs,
+        .day = (uint16_t) day,
+        .hrs = (uint8_t) (last ? 23 : 0),
+        .min = (uint8_t) (last ? 59 : 0),
+        .sec = (uint16_t) (last ? 59 : 0),
+    };
+    return 0;
+}
+
+// vis --index <dir> [--station <code|name>]... [--source <name>]... [--year <yyyy>] [--from <date>] [--to <date>]
+// brings the index of every schedule below dir up to date, then lists the sessions matching the filters
+#define INDEX_TERMS_MAX 32
+static int run_index(int argc, const char* argv[]) {
+    if(argc < 3) {
+        LOG_ERROR("Must provide a directory to index.");
+        return 1;
+    }
+    const char* stations[INDEX_TERMS_MAX];
+    const char* sources[INDEX_TERMS_MAX];
+    IndexQuery query = { .stations = stations, .station_count = 0, .sources = sources, .source_count = 0 };
+    unsigned int filtered = 0, failure = 0;
+    for(int i = 3; i < argc && !failure; i += 2) {
+        if(i + 1 == argc) {
+            LOG_ERROR("Index filter is missing its value.");
+            return 7;
+        }
+        if(strcmp(argv[i], "--station") == 0 && query.station_count < INDEX_TERMS_MAX) {
+            stations[(query.station_count)++] = argv[i + 1];
+        } else if(strcmp(argv[i], "--source") == 0 && query.source_count < INDEX_TERMS_MAX) {
+            sources[(query.source_count)++] = argv[i + 1];
+        } else if(strcmp(argv[i], "--year") == 0) {
+            failure = parse_index_date(argv[i + 1], &(query.from), 0) || parse_index_date(argv[i + 1], &(query.to), 1);
+            query.bounded_from = query.bounded_to = 1;
+        } else if(strcmp(argv[i], "--from") == 0) {
+            failure = parse_index_date(argv[i + 1], &(query.from), 0);
+            query.bounded_from = 1;
+        } else if(strcmp(argv[i], "--to") == 0) {
+            failure = parse_index_date(argv[i + 1], &(query.to), 1);
+            query.bounded_to = 1;
+        } else {
+            LOG_ERROR("Unknown or repeated index filter.");
+            return 7;
+        }
+        filtered = 1;
+    }
+    if(failure) {
+        LOG_ERROR("Index dates must be given as <yyyy> or <yyyy-ddd>.");
+        return 7;
+    }
+    ScheduleIndex index;
+    size_t updated, i, match_count;
+    if(ScheduleIndex_load(&index, argv[2])) return 1;
+    if(ScheduleIndex_update(&index, argv[2], &updated)) {
+        ScheduleIndex_free(index);
+        return 1;
+    }
+    // an unchanged index isn't rewritten
+    if(updated > 0) ScheduleIndex_write(index, argv[2]);
+    if(!filtered) {
+        printf("Indexed %zu schedules (%zu updated).\n", index.entry_count, updated);
+        ScheduleIndex_free(index);
+        return 0;
+    }
+    size_t* matches;
+    if(ScheduleIndex_query(index, query, &matches, &match_count)) {
+        ScheduleIndex_free(index);
+        return 1;
+    }
+    const IndexEntry* entry;
+    for(i = 0; i < match_count; ++i) {
+        entry = &(index.entries[matches[i]]);
+        printf("%-15s %04hu-%03hu %02hhu:%02hhu:%02hu  %04hu-%03hu %02hhu:%02hhu:%02hu  %2u stations  %3u sources  %s/%s\n",
+            entry->session,
+            entry->beg.yrs, entry->beg.day, entry->beg.hrs, entry->beg.min, entry->beg.sec,
+            entry->end.yrs, entry->end.day, entry->end.hrs, entry->end.min, entry->end.sec,
+            entry->station_count, entry->source_count, argv[2], &(index.paths[entry->path]));
+    }
+    free(matches);
+    ScheduleIndex_free(index);
+    return 0;
+}
+
+typedef struct {
+    size_t loaded, failed, invalid, scans;
+} BulkStats;
+
+static void print_schedule_stats(void* ctx, size_t idx, const char* path, Schedule* skd, unsigned int failure) {
+    BulkStats* stats = (BulkStats*) ctx;
+    (void) idx;
+    if(failure) {
+        stats->failed++;
+        printf("%s: failed to load\n", path);
+        return;
+    }
+    stats->loaded++;
+    stats->scans += skd->scan_count;
+    printf("%s: %zu scans, %zu stations, %zu sources\n", path, skd->scan_count, skd->station_count, skd->source_count);
+    // scans per station, each is only a walk over the station's timeline
+    StationSet set;
+    size_t i;
+    for(i = 0; i < skd->station_count; ++i) {
+        StationSet_clear(&set);
+        StationSet_add(&set, *skd, skd->stations[i].key);
+        printf("%s%s %zu", (i == 0) ? "  " : (i % 8 == 0) ? "\n  " : ", ", skd->stations[i].id, Schedule_scans_with(*skd, &set, NULL));
+    }
+    if(skd->station_count > 0) printf("\n");
+    // the longest wait between two scans of a source, each source only walks its own scans
+    const uint32_t* own;
+    size_t j, count, worst = skd->source_count;
+    TimeMs gap, longest = 0;
+    for(i = 0; i < skd->source_count; ++i) {
+        count = Schedule_source_scans(*skd, i, &own);
+        for(j = 1; j < count; ++j) {
+            gap = skd->scans.timestamp[own[j]] - skd->scans.timestamp[own[j - 1]];
+            if(gap > longest) {
+                longest = gap;
+                worst = i;
+            }
+        }
+    }
+    if(worst < skd->source_count) printf("  longest revisit: %s after %lld s\n", skd->sources[worst].iau, (long long) (longest / TIME_MS_PER_SEC));
+    // the viewer can only draw scans whose stations all have a position
+    StationSet_clear(&set);
+    for(i = 0; i < skd->station_count; ++i) if(skd->stations[i].pos.name[0] != '\0') StationSet_add(&set, *skd, skd->stations[i].key);
+    size_t unplaced = skd->scan_count - Schedule_scans_within(*skd, &set, NULL);
+    if(unplaced > 0) {
+        stats->invalid++;
+        printf("  %zu scans name stations without a position\n", unplaced);
+    }
+    Schedule_free(*skd);
+}
+
+// vis --stats <skd>...
+// loads every schedule in a single process and summarizes them
+static int run_stats(int argc, const char* argv[]) {
+    if(argc < 3) {
+        LOG_ERROR("Must provide at least one schedule.");
+        return 1;
+    }
+    BulkStats stats = { .loaded = 0, .failed = 0, .invalid = 0, .scans = 0 };
+    ScheduleBulkConfig config = { .worker_count = 0, .memory_cap = BULK_MEMORY_CAP };
+    if(Schedule_build_bulk(&(argv[2]), (size_t) (argc - 2), config, print_schedule_stats, &stats)) return 1;
+    printf("Loaded %zu schedules with %zu scans in total, %zu failed, %zu invalid.\n", stats.loaded, stats.scans, stats.failed, stats.invalid);
+    return stats.failed > 0 || stats.invalid > 0;
+}
+
+// vis --baseline <skd> <station> <station>
+// lists the scans of a single baseline and how long both of its stations observe in each
+static int run_baseline(int argc, const char* argv[]) {
+    if(argc != 5) {
+        LOG_ERROR("Must provide a schedule and the two stations of a baseline.");
+        return 1;
+    }
+    Schedule skd;
+    unsigned int failure = Schedule_build_from_source(&skd, argv[2]);
+    if(failure) {
+        LOG_ERROR("Unable to parse schedule.");
+        return (int) failure;
+    }
+    const Station* fst = Schedule_find_station(skd, argv[3]);
+    const Station* snd = Schedule_find_station(skd, argv[4]);
+    if(fst == NULL || snd == NULL || fst == snd) {
+        LOG_ERROR("Baseline must be given as two different stations, by key or 2-char id.");
+        Schedule_free(skd);
+        return 7;
+    }
+    BaselineIndex index;
+    if(BaselineIndex_build(&index, skd)) {
+        Schedule_free(skd);
+        return 1;
+    }
+    const uint32_t* scans;
+    const uint32_t* seconds;
+    Datetime dt;
+    size_t i, total = 0, count = BaselineIndex_scans(index, (size_t) (fst - skd.stations), (size_t) (snd - skd.stations), &scans, &seconds);
+    for(i = 0; i < count; ++i) {
+        dt = Datetime_from_ms(skd.scans.timestamp[scans[i]]);
+        printf("%04hu-%03hu %02hhu:%02hhu:%02hu  %-8s  %5u s\n",
+            dt.yrs, dt.day, dt.hrs, dt.min, dt.sec,
+            (skd.scans.source[scans[i]] < skd.source_count) ? skd.sources[skd.scans.source[scans[i]]].iau : "?", seconds[i]);
+        total += seconds[i];
+    }
+    printf("%s-%s: %zu scans, %zu s observed together.\n", fst->id, snd->id, count, total);
+    BaselineIndex_free(index);
+    Schedule_free(skd);
+    return 0;
+}
+
+// vis <skd> --without <station>...
+// the variant of the schedule without the given stations, which v switches to and back
+static unsigned int build_variant(Schedule skd, int argc, const char* argv[], ScheduleSnapshot* variant) {
+    const Station* station;
+    if(ScheduleSnapshot_init(variant, skd)) return 1;
+    for(int i = 3; i < argc; i += 2) {
+        station = Schedule_find_station(skd, argv[i]);
+        if(station == NULL || ScheduleSnapshot_drop_station(variant, (size_t) (station - skd.stations))) {
+            LOG_ERROR("Unable to drop station from variant, stations are given by their key or 2-char id.");
+            ScheduleSnapshot_free(*variant);
+            return 1;
+        }
+    }
+    return 0;
+}
+
 int main(int argc, const char* argv[]) {
+    // schedule archives are indexed and summarized without opening a window
+    if(argc > 1 && strcmp(argv[1], "--index") == 0) return run_index(argc, argv);
+    if(argc > 1 && strcmp(argv[1], "--stats") == 0) return run_stats(argc, argv);
+    if(argc > 1 && strcmp(argv[1], "--baseline") == 0) return run_baseline(argc, argv);
     unsigned int failure;
     if(argc < 2) {
         LOG_ERROR("Must provide a schedule (.skd).");
         return 1;
-    } else if(argc > 2) {
-        LOG_ERROR("Received more command line arguments than expected.");
-        return 7;
+    }
+    for(int i = 2; i < argc; i += 2) {
+        if(strcmp(argv[i], "--without") != 0 || i + 1 == argc) {
+            LOG_ERROR("Received more command line arguments than expected.");
+            return 7;
+        }
     }
     // build and validate Schedule
+    // scans keep streaming in on a background thread after this returns
     Schedule skd;
-    failure = Schedule_build_from_source(&skd, argv[1]);
+    failure = Schedule_build_streaming(&skd, argv[1]);
     if(failure) {
         LOG_ERROR("Unable to parse schedule.");
-        return failure;
+        return (int) failure;
     }
+    Schedule_poll(&skd);
     failure = Schedule_debug_and_validate(skd, 0);
     if(failure) {
         LOG_ERROR("Schedule contained references to sources/stations which were undefined.");
+        Schedule_free(skd);
         return 1;
     };
+    size_t scans_validated = skd.scan_count;
     // set up window
     RGFW_window* window = RGFW_createWindow(WINDOW_TITLE, WINDOW_BOUNDS, RGFW_windowCenter);
     RGFW_window_setMinSize(window, RGFW_AREA(WINDOW_BOUNDS.w, WINDOW_BOUNDS.h));
@@ -103,8 +338,55 @@ int main(int argc, const char* argv[]) {
     };
     SchedulePass* skd_pass = SchedulePass_init_from_schedule(skd_pass_desc, skd);
     if(skd_pass == NULL) abort();
+    // reload the schedule whenever it's regenerated
+    FileWatch skd_watch;
+    unsigned int skd_watched = !FileWatch_init(&skd_watch, argv[1]);
+    ScheduleDiff skd_diff;
+    // the what-if variant is taken once every scan is loaded, and shown through view
+    ScheduleSnapshot variant;
+    ScheduleView view;
+    unsigned int variant_wanted = argc > 2, variant_built = 0, variant_shown = 0;
+    Schedule shown = skd;
     // event loop
     while(RGFW_window_shouldClose(window) == RGFW_FALSE) {
+        // pick up scans that were parsed since the last frame
+        if(skd.stream != NULL) {
+            Schedule_poll(&skd);
+            failure = Schedule_debug_and_validate_range(skd, scans_validated, skd.scan_count, 0);
+            if(failure) {
+                LOG_ERROR("Schedule contained references to sources/stations which were undefined.");
+                break;
+            }
+            scans_validated = skd.scan_count;
+            if(SchedulePass_sync(skd_pass, skd)) abort();
+        } else if(skd_watched && FileWatch_changed(&skd_watch)) {
+            // the variant points into the schedule, so it's dropped and taken again from the reloaded one
+            if(variant_built) {
+                // showing the schedule itself never fails
+                if(variant_shown) {
+                    ScheduleView_show(&view, NULL, &skd_diff);
+                    if(SchedulePass_reload(skd_pass, skd, skd_diff)) abort();
+                }
+                ScheduleView_free(view);
+                ScheduleSnapshot_free(variant);
+                variant_built = 0;
+                variant_shown = 0;
+            }
+            // only the changed lines are re-parsed, the previous schedule is kept if they're invalid
+            if(Schedule_reload(&skd, argv[1], &skd_diff)) {
+                LOG_ERROR("Unable to reload schedule. Keeping the previous version.");
+            } else {
+                LOG_INFO("Reloaded schedule.");
+                scans_validated = skd.scan_count;
+                if(SchedulePass_reload(skd_pass, skd, skd_diff)) abort();
+            }
+        }
+        if(variant_wanted && !variant_built && skd.stream == NULL) {
+            variant_wanted = !build_variant(skd, argc, argv, &variant);
+            variant_built = variant_wanted;
+            if(variant_built) ScheduleView_init(&view, skd);
+        }
+        shown = variant_built ? view.skd : skd;
         while(RGFW_window_checkEvent(window)) {
             // handle resizes
             if(window->event.type == RGFW_windowResized) glViewport(0, 0, (GLsizei) window->r.w, (GLsizei) window->r.h);
@@ -113,8 +395,18 @@ int main(int argc, const char* argv[]) {
             // process user input
             Camera_handle_events(camera, CAMERA_CONFIG, window);
             CameraController_handle_input(camera_controller, camera, window);
+            // switch between the schedule and its variant
+            if(variant_built && window->event.type == RGFW_keyPressed && window->event.key == RGFW_v) {
+                if(ScheduleView_show(&view, variant_shown ? NULL : &variant, &skd_diff)) {
+                    LOG_ERROR("Unable to show variant.");
+                } else {
+                    variant_shown = !variant_shown;
+                    shown = view.skd;
+                    if(SchedulePass_reload(skd_pass, shown, skd_diff)) abort();
+                }
+            }
             // handle pausing/unpausing and resetting the visualization
-            SchedulePass_handle_input(skd_pass, skd, window);
+            SchedulePass_handle_input(skd_pass, shown, window);
         }
         // prepare glenv frame
         glenv_new_frame();
@@ -124,12 +416,12 @@ int main(int argc, const char* argv[]) {
         Camera_update(camera);
         // draw passes
         GlobePass_update_and_draw(globe_pass, camera);
-        SchedulePass_update_and_draw(skd_pass, skd, camera);
+        SchedulePass_update_and_draw(skd_pass, shown, camera);
         // prepare interface for rendering
     #ifndef NO_UI
         Overlay_prepare_interface(window);
         // process actions
-        SchedulePass_handle_action(skd_pass, skd, Overlay_get_action());
+        SchedulePass_handle_action(skd_pass, shown, Overlay_get_action());
     #endif
         // conclude pass
         glenv_render(NK_ANTI_ALIASING_ON);
@@ -138,14 +430,20 @@ int main(int argc, const char* argv[]) {
     Camera_free(camera);
     CameraController_free(camera_controller);
     GlobePass_free(globe_pass);
+    if(variant_built) {
+        ScheduleView_free(view);
+        ScheduleSnapshot_free(variant);
+    }
     Schedule_free(skd);
     SchedulePass_free(skd_pass);
+    if(skd_watched) FileWatch_free(skd_watch);
     // destroy shaders
     Shader_destroy(&coord_vert);
     Shader_destroy(&sched_frag);
     Shader_destroy(&globe_frag);
     // close window and deinit glenv.h
+    Overlay_free();
     glenv_deinit();
     RGFW_window_close(window);
-    return 0;
+    return (int) failure;
 }
@@ -0,0 +1,103 @@
+#include "pool.h"
+#include <pthread.h>
+#include <unistd.h>
+#include "util/log.h"
+
+typedef struct PoolJob {
+    void (*task)(void*, size_t);
+    void* ctx;
+    size_t task_count;
+    size_t next; // first task not handed out yet
+    size_t done;
+    struct PoolJob* queued; // the job after this one
+} PoolJob;
+
+// every member is guarded by lock
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake, done;
+    unsigned int started;
+    PoolJob* head; // jobs with tasks left to hand out, in the order they were queued
+    PoolJob* tail;
+} Pool;
+
+static Pool pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .started = 0,
+    .head = NULL,
+    .tail = NULL,
+};
+// set while a thread runs a task
+static _Thread_local unsigned int pool_inside = 0;
+
+size_t pool_thread_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if(count < 1) return 1;
+    return ((size_t) count > POOL_THREAD_MAX) ? POOL_THREAD_MAX : (size_t) count;
+}
+
+static void pool_unlink(PoolJob* job) {
+    PoolJob** at = &(pool.head);
+    PoolJob* prev = NULL;
+    while(*at != NULL && *at != job) {
+        prev = *at;
+        at = &((*at)->queued);
+    }
+    if(*at == NULL) return;
+    *at = job->queued;
+    if(pool.tail == job) pool.tail = prev;
+}
+
+// runs one task of job with the lock released, returns with it held again
+static void pool_step(PoolJob* job) {
+    size_t idx = job->next++;
+    if(job->next == job->task_count) pool_unlink(job);
+    pthread_mutex_unlock(&(pool.lock));
+    pool_inside = 1;
+    job->task(job->ctx, idx);
+    pool_inside = 0;
+    pthread_mutex_lock(&(pool.lock));
+    if(++job->done == job->task_count) pthread_cond_broadcast(&(pool.done));
+}
+
+static void* pool_worker(void* arg) {
+    (void) arg;
+    pthread_mutex_lock(&(pool.lock));
+    for(;;) {
+        if(pool.head == NULL) pthread_cond_wait(&(pool.wake), &(pool.lock));
+        else pool_step(pool.head);
+    }
+    return NULL;
+}
+
+// called with the lock held
+static void pool_start(void) {
+    pthread_t thread;
+    size_t i, thread_count = pool_thread_count();
+    pool.started = 1;
+    for(i = 1; i < thread_count; ++i) {
+        if(pthread_create(&thread, NULL, pool_worker, NULL) == 0) pthread_detach(thread);
+        else LOG_INFO("Failed to spawn pool worker. Continuing with fewer threads.");
+    }
+}
+
+void pool_run(size_t task_count, void (*task)(void*, size_t), void* ctx) {
+    size_t i;
+    if(pool_inside || task_count <= 1) {
+        for(i = 0; i < task_count; ++i) task(ctx, i);
+        return;
+    }
+    PoolJob job = { .task = task, .ctx = ctx, .task_count = task_count, .next = 0, .done = 0, .queued = NULL };
+    pthread_mutex_lock(&(pool.lock));
+    if(!pool.started) pool_start();
+    if(pool.tail != NULL) pool.tail->queued = &job;
+    else pool.head = &job;
+    pool.tail = &job;
+    pthread_cond_broadcast(&(pool.wake));
+    // work on this job even while others are queued ahead of it
+    while(job.next < job.task_count) pool_step(&job);
+    while(job.done < job.task_count) pthread_cond_wait(&(pool.done), &(pool.lock));
+    pthread_mutex_unlock(&(pool.lock));
+}
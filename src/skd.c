@@ -1,53 +1,84 @@
 #include "skd.h"
 #include <X11/Xresource.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "util/mjd.h"
 #include "util/hashmap.h"
+#include "util/fio.h"
+#include "pool.h"
+#include "util/archive.h"
+#include "skd_cache.h"
 
 unsigned int Schedule_debug_and_validate(Schedule skd, unsigned int display) {
-    char station_key[2]; station_key[1] = '\0';
-    char* station_id;
-    char* quasar_id;
-    NamedPoint* station_pos;
-    NamedPoint* quasar;
-    ScanFAM* curr;
+    return Schedule_debug_and_validate_range(skd, 0, skd.scan_count, display);
+}
+
+// a scan only refers to defined stations with positions if its set holds one placed station per entry
+static inline unsigned int scan_stations_placed(const ScanTable* scans, size_t i, const uint64_t placed[]) {
+    const uint64_t* set = &(scans->station_sets[i * scans->set_words]);
+    size_t w, bits = 0;
+    for(w = 0; w < scans->set_words; ++w) {
+        if(set[w] & ~placed[w]) return 0;
+        bits += (size_t) __builtin_popcountll(set[w]);
+    }
+    return bits == scans->station_beg[i + 1] - scans->station_beg[i];
+}
+
+unsigned int Schedule_debug_and_validate_range(Schedule skd, size_t beg, size_t end, unsigned int display) {
+    const Station* station;
+    const Source* quasar;
+    const ScanTable* scans = &(skd.scans);
+    Datetime timestamp;
+    uint64_t placed[STATION_SET_WORDS_MAX] = {0,};
     size_t i, j;
-    for(i = 0; i < skd.scan_count; ++i) {
-        curr = Schedule_get_scan(skd, i);
-        if(display) printf("%8s [%s]: %4hu+%3hu [%2hhu:%2hhu:%2hu]\n", 
-            curr->source, curr->ids, 
-            curr->timestamp.yrs, curr->timestamp.day, 
-            curr->timestamp.hrs, curr->timestamp.min, curr->timestamp.sec);
-        if((quasar_id = (char*) HashMap_get(skd.sources_alias, curr->source)) == NULL) quasar_id = curr->source;
-        if((quasar = (NamedPoint*) HashMap_get(skd.sources, quasar_id)) == NULL) {
-            LOG_INFO("IAU source name is missing corresponding NamedPoint entry in HashMap.");
+    if(end > skd.scan_count) end = skd.scan_count;
+    for(i = 0; i < skd.station_count && i < scans->set_words * STATION_SET_WORD_BITS; ++i) {
+        if(skd.stations[i].pos.name[0] != '\0') placed[i / STATION_SET_WORD_BITS] |= (uint64_t) 1 << (i % STATION_SET_WORD_BITS);
+    }
+    for(i = beg; i < end; ++i) {
+        quasar = (scans->source[i] < skd.source_count) ? &(skd.sources[scans->source[i]]) : NULL;
+        if(display) {
+            printf("%8s [", (quasar == NULL) ? "?" : quasar->iau);
+            for(j = scans->station_beg[i]; j < scans->station_beg[i + 1]; ++j) {
+                printf("%s", (scans->stations[j] < skd.station_count) ? skd.stations[scans->stations[j]].key : "?");
+            }
+            timestamp = Datetime_from_ms(scans->timestamp[i]);
+            printf("]: %4hu+%3hu [%2hhu:%2hhu:%2hu]\n", 
+                timestamp.yrs, timestamp.day, 
+                timestamp.hrs, timestamp.min, timestamp.sec);
+        }
+        if(quasar == NULL) {
+            LOG_INFO("Observed source is missing corresponding $SOURCES entry.");
             return 1;
         } else if(display) {
             printf("  ");
-            if(quasar->name[0] == '\0') {
+            if(quasar->point.name[0] == '\0') {
                 printf("%s [%+8.2f, %+8.2f]\n", 
-                    curr->source, quasar->alf, quasar->phi);
+                    quasar->iau, quasar->point.alf, quasar->point.phi);
             } else {
                 printf("%s (%s) [%+8.2f, %+8.2f]\n", 
-                    curr->source, quasar->name, quasar->alf, quasar->phi);
+                    quasar->iau, quasar->point.name, quasar->point.alf, quasar->point.phi);
             }
         }
-        for(j = 0; j < strlen(curr->ids); ++j) {
-            station_key[0] = curr->ids[j];
-            if((station_id = (char*) HashMap_get(skd.stations_ant, station_key)) == NULL) {
-                LOG_INFO("Antenna key in observation lacks matching HashMap entry.");
+        // only scans which fail the set check are walked station by station to find the culprit
+        if(!display && scan_stations_placed(scans, i, placed)) continue;
+        for(j = scans->station_beg[i]; j < scans->station_beg[i + 1]; ++j) {
+            if(scans->stations[j] >= skd.station_count) {
+                LOG_INFO("Antenna key in observation lacks matching $STATIONS entry.");
                 return 1;
-            } else {
-                if((station_pos = (NamedPoint*) HashMap_get(skd.stations_pos, station_id)) == NULL) {
-                    LOG_INFO("2-char station id is missing corresponding NamedPoint entry in HashMap.");
-                    return 1;
-                } else if(display) {
-                    printf("  [%c] ", station_key[0]);
-                    printf("%s: %8s [%+7.2f, %+6.2f]\n", station_id, 
-                        station_pos->name, station_pos->lam, station_pos->phi);
-                }
+            }
+            station = &(skd.stations[scans->stations[j]]);
+            if(station->pos.name[0] == '\0') {
+                LOG_INFO("2-char station id is missing corresponding position entry.");
+                return 1;
+            } else if(display) {
+                printf("  [%s] ", station->key);
+                printf("%s: %8s [%+7.2f, %+6.2f]\n", station->id, 
+                    station->pos.name, station->pos.lam, station->pos.phi);
             }
         }
     }
@@ -55,166 +86,1717 @@ unsigned int Schedule_debug_and_validate(Schedule skd, unsigned int display) {
     return 0;
 }
 
-ScanFAM* Schedule_get_scan(Schedule skd, size_t i) {
-    if(i >= skd.scan_count) return NULL;
-    return (ScanFAM*) ((char*) skd.scans + i * (sizeof(ScanFAM) + skd.stations_ant.size + 1));
+// allocates every column from arena for scan_cap scans and member_cap stations, station_beg starts out as {0}
+// station sets are set_words wide
+static unsigned int ScanTable_alloc(Arena* arena, ScanTable* scans, size_t scan_cap, size_t member_cap, size_t set_words) {
+    scans->timestamp = (TimeMs*) Arena_alloc(arena, (scan_cap + 1) * sizeof(TimeMs));
+    scans->cal_duration = (uint32_t*) Arena_alloc(arena, (scan_cap + 1) * sizeof(uint32_t));
+    scans->obs_duration = (uint32_t*) Arena_alloc(arena, (scan_cap + 1) * sizeof(uint32_t));
+    scans->source = (uint32_t*) Arena_alloc(arena, (scan_cap + 1) * sizeof(uint32_t));
+    scans->station_beg = (uint32_t*) Arena_alloc(arena, (scan_cap + 1) * sizeof(uint32_t));
+    scans->stations = (uint16_t*) Arena_alloc(arena, (member_cap + 1) * sizeof(uint16_t));
+    scans->offsets = (uint32_t*) Arena_alloc(arena, (member_cap + 1) * sizeof(uint32_t));
+    scans->station_sets = (uint64_t*) Arena_alloc(arena, (scan_cap * set_words + 1) * sizeof(uint64_t));
+    scans->set_words = set_words;
+    if(scans->timestamp == NULL || scans->cal_duration == NULL || scans->obs_duration == NULL || scans->source == NULL || \
+        scans->station_beg == NULL || scans->stations == NULL || scans->offsets == NULL || scans->station_sets == NULL) {
+        memset(scans, 0, sizeof(ScanTable));
+        return 1;
+    }
+    scans->station_beg[0] = 0;
+    return 0;
 }
 
-void Schedule_free(Schedule skd) {
-    HashMap_free(skd.stations_ant);
-    HashMap_free(skd.stations_pos);
-    HashMap_free(skd.sources);
-    HashMap_free(skd.sources_alias);
-    ScanFAM* current;
-    for(size_t i = 0; i < skd.scan_count; ++i) {
-        current = Schedule_get_scan(skd, i);
-        free(current->scan_offsets);
+// resizes every column allocated for scan_cap/member_cap to hold new_scan_cap scans and new_member_cap stations
+// columns which were resized stay valid if another one fails
+static unsigned int ScanTable_resize(Arena* arena, ScanTable* scans, size_t scan_cap, size_t member_cap, size_t new_scan_cap, size_t new_member_cap) {
+    void* temp;
+#define SCAN_TABLE_RESIZE(column, count, new_count) \
+    temp = Arena_realloc(arena, scans->column, ((count) + 1) * sizeof(*(scans->column)), ((new_count) + 1) * sizeof(*(scans->column))); \
+    if(temp == NULL) return 1; \
+    scans->column = temp;
+    SCAN_TABLE_RESIZE(timestamp, scan_cap, new_scan_cap)
+    SCAN_TABLE_RESIZE(cal_duration, scan_cap, new_scan_cap)
+    SCAN_TABLE_RESIZE(obs_duration, scan_cap, new_scan_cap)
+    SCAN_TABLE_RESIZE(source, scan_cap, new_scan_cap)
+    SCAN_TABLE_RESIZE(station_beg, scan_cap, new_scan_cap)
+    SCAN_TABLE_RESIZE(stations, member_cap, new_member_cap)
+    SCAN_TABLE_RESIZE(offsets, member_cap, new_member_cap)
+    SCAN_TABLE_RESIZE(station_sets, scan_cap * scans->set_words, new_scan_cap * scans->set_words)
+#undef SCAN_TABLE_RESIZE
+    return 0;
+}
+
+// rebuilds the station set of scan i from its stations
+static void ScanTable_fill_set(ScanTable* scans, size_t i) {
+    uint64_t* set = &(scans->station_sets[i * scans->set_words]);
+    size_t j, station;
+    for(j = 0; j < scans->set_words; ++j) set[j] = 0;
+    for(j = scans->station_beg[i]; j < scans->station_beg[i + 1]; ++j) {
+        station = scans->stations[j];
+        if(station < scans->set_words * STATION_SET_WORD_BITS) set[station / STATION_SET_WORD_BITS] |= (uint64_t) 1 << (station % STATION_SET_WORD_BITS);
     }
-    free(skd.scans);
 }
 
-long seek_to_section(FILE* stream, const char* header) {
-    ssize_t line_len;
-    char* line = NULL;
-    size_t line_cap = 0, header_len = strlen(header);
-    while((line_len = getline(&line, &line_cap, stream)) != -1) {
-        if((size_t) line_len >= header_len && strncmp(line, header, header_len) == 0) {
-            free(line);
-            return ftell(stream);
+// copies scans [beg, end) of src to dst starting at scan at, dst must already hold at's station_beg
+// station sets are rebuilt if the tables' set widths differ
+static void ScanTable_copy(ScanTable* dst, size_t at, ScanTable src, size_t beg, size_t end) {
+    size_t count = end - beg, dst_base = dst->station_beg[at], src_base = src.station_beg[beg];
+    size_t member_count = src.station_beg[end] - src_base;
+    memcpy(&(dst->timestamp[at]), &(src.timestamp[beg]), count * sizeof(TimeMs));
+    memcpy(&(dst->cal_duration[at]), &(src.cal_duration[beg]), count * sizeof(uint32_t));
+    memcpy(&(dst->obs_duration[at]), &(src.obs_duration[beg]), count * sizeof(uint32_t));
+    memcpy(&(dst->source[at]), &(src.source[beg]), count * sizeof(uint32_t));
+    memcpy(&(dst->stations[dst_base]), &(src.stations[src_base]), member_count * sizeof(uint16_t));
+    memcpy(&(dst->offsets[dst_base]), &(src.offsets[src_base]), member_count * sizeof(uint32_t));
+    for(size_t i = 1; i <= count; ++i) dst->station_beg[at + i] = (uint32_t) (dst_base + src.station_beg[beg + i] - src_base);
+    if(dst->set_words == src.set_words) {
+        memcpy(&(dst->station_sets[at * dst->set_words]), &(src.station_sets[beg * src.set_words]), count * src.set_words * sizeof(uint64_t));
+    } else {
+        for(size_t i = at; i < at + count; ++i) ScanTable_fill_set(dst, i);
+    }
+}
+
+// sources are looked up by their common name first, then by their IAU name
+static uint32_t resolve_source(HashMap sources_iau, HashMap sources_alias, const char* name) {
+    uint32_t* idx = (uint32_t*) HashMap_get(sources_alias, name);
+    if(idx == NULL) idx = (uint32_t*) HashMap_get(sources_iau, name);
+    return (idx == NULL) ? SOURCE_NONE : *idx;
+}
+
+const Station* Schedule_find_station(Schedule skd, const char* name) {
+    uint32_t* idx = (uint32_t*) HashMap_get(skd.stations_ant, name);
+    if(idx == NULL) idx = (uint32_t*) HashMap_get(skd.stations_pos, name);
+    return (idx == NULL) ? NULL : &(skd.stations[*idx]);
+}
+
+const Source* Schedule_find_source(Schedule skd, const char* name) {
+    uint32_t idx = resolve_source(skd.sources_iau, skd.sources_alias, name);
+    return (idx == SOURCE_NONE) ? NULL : &(skd.sources[idx]);
+}
+
+// drops stations with a repeated key, then maps every key and placed id to its station
+// $SKED lines only tell keys apart by their width, so stations with a key wider or narrower than the first one's are dropped too
+// as is every station past STATION_COUNT_MAX
+// the HashMaps must be empty
+static unsigned int index_stations(Schedule* skd) {
+    uint32_t k = 0;
+    size_t key_len = (skd->station_count == 0) ? 0 : strlen(skd->stations[0].key);
+    unsigned int failure = HashMap_reserve(&(skd->stations_ant), skd->station_count) || \
+        HashMap_reserve(&(skd->stations_pos), skd->station_count);
+    for(size_t i = 0; !failure && i < skd->station_count; ++i) {
+        if(strlen(skd->stations[i].key) != key_len) {
+            LOG_INFO("Station key differs in width from the first station's. Skipping station.");
+            continue;
+        }
+        if(k == STATION_COUNT_MAX) {
+            LOG_INFO("Schedule has too many stations. Skipping the rest.");
+            break;
         }
+        failure = HashMap_insert(&(skd->stations_ant), skd->stations[i].key, &k);
+        if(failure == HASHMAP_DUPLICATE) {
+            failure = 0;
+            continue;
+        }
+        skd->stations[k] = skd->stations[i];
+        // the first station placed under an id keeps it
+        if(!failure && skd->stations[k].pos.name[0] != '\0') {
+            failure = HashMap_insert(&(skd->stations_pos), skd->stations[k].id, &k);
+            if(failure == HASHMAP_DUPLICATE) failure = 0;
+        }
+        k++;
     }
-    free(line);
-    return -1L;
+    skd->station_count = k;
+    return failure;
 }
 
-#define BUCKET_COUNT 10 // TODO: Allow this to be configured
-unsigned int Schedule_build_from_source(Schedule* skd, const char* path) {
-    FILE* stream = fopen(path, "rb");
-    if(stream == NULL) {
-        LOG_ERROR("Schedule couldn't be opened.");
-        return 2;
+// drops sources with a repeated IAU name, then maps every name to its source
+// the HashMaps must be empty
+static unsigned int index_sources(Schedule* skd) {
+    uint32_t k = 0;
+    unsigned int failure = HashMap_reserve(&(skd->sources_iau), skd->source_count) || \
+        HashMap_reserve(&(skd->sources_alias), skd->source_count);
+    for(size_t i = 0; !failure && i < skd->source_count; ++i) {
+        failure = HashMap_insert(&(skd->sources_iau), skd->sources[i].iau, &k);
+        if(failure == HASHMAP_DUPLICATE) {
+            failure = 0;
+            continue;
+        }
+        skd->sources[k] = skd->sources[i];
+        // the first source with a common name keeps it
+        if(!failure && skd->sources[k].point.name[0] != '\0') {
+            failure = HashMap_insert(&(skd->sources_alias), skd->sources[k].point.name, &k);
+            if(failure == HASHMAP_DUPLICATE) failure = 0;
+        }
+        k++;
     }
-    unsigned int failure;
-    long stations_idx, sources_idx, scan_idx;
-    stations_idx = seek_to_section(stream, "$STATIONS");
-    CLOSE_STREAM_ON_FAILURE(stream, stations_idx < 0, 1, "Schedule contains no $STATIONS section.");
-    HashMap_init(&(skd->stations_ant), BUCKET_COUNT, 3);
-    HashMap_init(&(skd->stations_pos), 10, sizeof(NamedPoint));
-    ssize_t line_len; size_t line_cap = 0;
-    char key[2], id[3]; 
-    char* line = NULL;
-    NamedPoint station;
-    int ret;
-    while((line_len = getline(&line, &line_cap, stream)) != -1) {
-        // TODO: Why does the following line break the parsing
-        // if(line[0] == '$') break;
-        ret = sscanf(line, "A %1s %*s %*s %*f %*f %*d %*f %*f %*f %*d %*f %*f %*f %2s %*s %*s \n", key, id);
-        if(ret == 2) HashMap_insert(&(skd->stations_ant), key, (void*) id);
-        ret = sscanf(line, "P %2s %s %*f %*f %*f %*d %f %f %*s \n", id, station.name, &(station.lam), &(station.phi));
-        if(ret == 4) {
-            station.phi = 90.f - station.phi;
-            HashMap_insert(&(skd->stations_pos), id, (void*) &station);
-        } // TODO: If the station position fails to parse, the antenna entry should be removed
+    skd->source_count = k;
+    return failure;
+}
+
+unsigned int Schedule_index_names(Schedule* skd) {
+    if(index_stations(skd) || index_sources(skd)) {
+        LOG_ERROR("Unable to index station and source names.");
+        return 1;
     }
-    free(line);
-    line = NULL;
-    failure = fseek(stream, 0, SEEK_SET) != 0;
-    CLOSE_STREAM_ON_FAILURE(stream, failure, 1, "Unable to seek to beginning of schedule.");
-    sources_idx = seek_to_section(stream, "$SOURCES");
-    CLOSE_STREAM_ON_FAILURE(stream, sources_idx < 0, 1, "Schedule contains no $SOURCES section.");
-    HashMap_init(&(skd->sources), BUCKET_COUNT, sizeof(NamedPoint));
-    HashMap_init(&(skd->sources_alias), BUCKET_COUNT, 9);
-    char iau[9];
-    NamedPoint source;
+    return 0;
+}
+
+// counting sort of every scan reference by station
+// each start is advanced past its entries while filling, so the starts are shifted back by one afterwards
+unsigned int Schedule_index_station_scans(Schedule* skd) {
+    const ScanTable* scans = &(skd->scans);
+    size_t i, j, at, member_count = (skd->scan_count == 0) ? 0 : scans->station_beg[skd->scan_count];
+    uint32_t* station_beg = (uint32_t*) Arena_alloc(skd->arena, (skd->station_count + 1) * sizeof(uint32_t));
+    uint32_t* station_scans = (uint32_t*) Arena_alloc(skd->arena, (member_count + 1) * sizeof(uint32_t));
+    uint32_t* station_offsets = (uint32_t*) Arena_alloc(skd->arena, (member_count + 1) * sizeof(uint32_t));
+    skd->scan_index.station_beg = NULL;
+    skd->scan_index.station_scans = NULL;
+    skd->scan_index.station_offsets = NULL;
+    if(station_beg == NULL || station_scans == NULL || station_offsets == NULL) {
+        LOG_ERROR("Unable to allocate scan index.");
+        return 1;
+    }
+    memset(station_beg, 0, (skd->station_count + 1) * sizeof(uint32_t));
+    for(j = 0; j < member_count; ++j) if(scans->stations[j] < skd->station_count) station_beg[scans->stations[j] + 1]++;
+    for(i = 0; i < skd->station_count; ++i) station_beg[i + 1] += station_beg[i];
+    for(i = 0; i < skd->scan_count; ++i) {
+        for(j = scans->station_beg[i]; j < scans->station_beg[i + 1]; ++j) {
+            if(scans->stations[j] >= skd->station_count) continue;
+            at = station_beg[scans->stations[j]]++;
+            station_scans[at] = (uint32_t) i;
+            station_offsets[at] = scans->offsets[j];
+        }
+    }
+    memmove(&(station_beg[1]), station_beg, skd->station_count * sizeof(uint32_t));
+    station_beg[0] = 0;
+    skd->scan_index.station_beg = station_beg;
+    skd->scan_index.station_scans = station_scans;
+    skd->scan_index.station_offsets = station_offsets;
+    return 0;
+}
+
+// same counting sort by source
+unsigned int Schedule_index_source_scans(Schedule* skd) {
+    const ScanTable* scans = &(skd->scans);
+    size_t i;
+    uint32_t* source_beg = (uint32_t*) Arena_alloc(skd->arena, (skd->source_count + 1) * sizeof(uint32_t));
+    uint32_t* source_scans = (uint32_t*) Arena_alloc(skd->arena, (skd->scan_count + 1) * sizeof(uint32_t));
+    skd->scan_index.source_beg = NULL;
+    skd->scan_index.source_scans = NULL;
+    if(source_beg == NULL || source_scans == NULL) {
+        LOG_ERROR("Unable to allocate scan index.");
+        return 1;
+    }
+    memset(source_beg, 0, (skd->source_count + 1) * sizeof(uint32_t));
+    for(i = 0; i < skd->scan_count; ++i) if(scans->source[i] < skd->source_count) source_beg[scans->source[i] + 1]++;
+    for(i = 0; i < skd->source_count; ++i) source_beg[i + 1] += source_beg[i];
+    for(i = 0; i < skd->scan_count; ++i) {
+        if(scans->source[i] < skd->source_count) source_scans[source_beg[scans->source[i]]++] = (uint32_t) i;
+    }
+    memmove(&(source_beg[1]), source_beg, skd->source_count * sizeof(uint32_t));
+    source_beg[0] = 0;
+    skd->scan_index.source_beg = source_beg;
+    skd->scan_index.source_scans = source_scans;
+    return 0;
+}
+
+unsigned int Schedule_index_scans(Schedule* skd) {
+    if(Schedule_index_station_scans(skd) || Schedule_index_source_scans(skd)) {
+        memset(&(skd->scan_index), 0, sizeof(ScanIndex));
+        return 1;
+    }
+    return 0;
+}
+
+static size_t count_lines(const char* beg, const char* end) {
+    size_t line_count = 0;
+    while(beg < end) {
+        beg = (const char*) memchr(beg, '\n', (size_t) (end - beg));
+        beg = (beg == NULL) ? end : beg + 1;
+        line_count++;
+    }
+    return line_count;
+}
+
+// copies the line at *cursor into buf and advances cursor past its terminator
+// buf is only reallocated when a line longer than any before it is encountered
+static unsigned int next_line(const char** cursor, const char* end, char** buf, size_t* buf_cap) {
+    if(*cursor >= end) return 0;
+    const char* line_end = (const char*) memchr(*cursor, '\n', (size_t) (end - *cursor));
+    if(line_end == NULL) line_end = end;
+    size_t line_len = (size_t) (line_end - *cursor);
+    if(line_len + 1 > *buf_cap) {
+        size_t cap = (*buf_cap == 0) ? 256 : *buf_cap;
+        while(cap < line_len + 1) cap *= 2;
+        char* temp = (char*) realloc(*buf, cap);
+        if(temp == NULL) {
+            LOG_ERROR("Unable to allocate line buffer.");
+            return 0;
+        }
+        *buf = temp;
+        *buf_cap = cap;
+    }
+    memcpy(*buf, *cursor, line_len);
+    (*buf)[line_len] = '\0';
+    *cursor = (line_end < end) ? line_end + 1 : end;
+    return 1;
+}
+
+// keys are one or two characters, a longer one leaves the line unparsed
+static void parse_antenna_line(Schedule* skd, const char* line) {
+    Station* station = &(skd->stations[skd->station_count]);
+    char key[4];
+    memset(station, 0, sizeof(Station));
+    int ret = sscanf(line, "A %3s %*s %*s %*f %*f %*d %*f %*f %*f %*d %*f %*f %*f %2s %*s %*s \n", key, station->id);
+    if(ret != 2 || strlen(key) >= sizeof(station->key)) return;
+    memcpy(station->key, key, strlen(key) + 1);
+    skd->station_count++;
+}
+
+static void parse_position_line(Schedule* skd, const char* line) {
+    char id[3];
+    NamedPoint pos;
+    int ret = sscanf(line, "P %2s %8s %*f %*f %*f %*d %f %f %*s \n", id, pos.name, &(pos.lam), &(pos.phi));
+    if(ret != 4) return;
+    pos.phi = 90.f - pos.phi;
+    for(size_t i = 0; i < skd->station_count; ++i) {
+        if(strcmp(skd->stations[i].id, id) == 0) skd->stations[i].pos = pos;
+    }
+}
+
+static void parse_source_line(Schedule* skd, const char* line) {
+    Source* source = &(skd->sources[skd->source_count]);
     uint8_t raan_hrs, raan_min; int8_t decl_deg, decl_min;
     float raan_sec, decl_sec;
-    while((line_len = getline(&line, &line_cap, stream)) != -1) {
-        if(line[0] == '$') break;
-        ret = sscanf(line, " %8s %8s %hhu %hhu %f %hhd %hhd %f %*f %*f %*s %*s \n",
-            iau, source.name,
-            &raan_hrs, &raan_min, &raan_sec, 
-            &decl_deg, &decl_min, &decl_sec);
-        if(ret == 8) {
-            source.alf = (float) raan_hrs + (float) raan_min / 60.f + raan_sec / 3600.f;
-            source.alf *= 15.f;
-            source.phi = (float) decl_deg + (float) decl_min / 60.f + decl_sec / 3600.f;
-            source.phi = 90.f - source.phi; // TODO: Since all sked data has this 90 deg. offset, maybe it should be baked into a function
-            if(source.name[0] == '$') source.name[0] = '\0';
-            else HashMap_insert(&(skd->sources_alias), source.name, iau);
-            HashMap_insert(&(skd->sources), iau, &source);
-        }
+    memset(source, 0, sizeof(Source));
+    int ret = sscanf(line, " %8s %8s %hhu %hhu %f %hhd %hhd %f %*f %*f %*s %*s \n",
+        source->iau, source->point.name,
+        &raan_hrs, &raan_min, &raan_sec, 
+        &decl_deg, &decl_min, &decl_sec);
+    if(ret == 8) {
+        source->point.alf = (float) raan_hrs + (float) raan_min / 60.f + raan_sec / 3600.f;
+        source->point.alf *= 15.f;
+        source->point.phi = (float) decl_deg + (float) decl_min / 60.f + decl_sec / 3600.f;
+        source->point.phi = 90.f - source->point.phi; // TODO: Since all sked data has this 90 deg. offset, maybe it should be baked into a function
+        if(source->point.name[0] == '$') source->point.name[0] = '\0';
+        skd->source_count++;
+    }
+}
+
+#define IS_BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
+// skips leading whitespace and returns the length of the token that follows
+static inline size_t next_token(const char** cursor, const char* end, const char** tok) {
+    const char* curr = *cursor;
+    while(curr < end && IS_BLANK(*curr)) curr++;
+    *tok = curr;
+    while(curr < end && !IS_BLANK(*curr)) curr++;
+    *cursor = curr;
+    return (size_t) (curr - *tok);
+}
+
+// decodes a fixed-width run of ASCII digits
+// returns 0 if the run is empty or contains anything other than a digit
+static inline unsigned int decode_digits(const char* str, size_t len, uint32_t* val) {
+    uint32_t acc = 0;
+    if(len == 0 || len > 9) return 0;
+    for(size_t i = 0; i < len; ++i) {
+        if(str[i] < '0' || str[i] > '9') return 0;
+        acc = acc * 10 + (uint32_t) (str[i] - '0');
+    }
+    *val = acc;
+    return 1;
+}
+
+// decodes the 11-digit yydddhhmmss timestamp used in $SKED lines
+static inline unsigned int decode_scan_timestamp(const char* str, size_t len, Datetime* dt) {
+    uint32_t yrs, day, hrs, min, sec;
+    if(len != 11) return 0;
+    if(!decode_digits(&(str[0]), 2, &yrs) || !decode_digits(&(str[2]), 3, &day) || \
+        !decode_digits(&(str[5]), 2, &hrs) || !decode_digits(&(str[7]), 2, &min) || \
+        !decode_digits(&(str[9]), 2, &sec)) return 0;
+    // TODO: Look for a better way to handle this
+    dt->yrs = (uint16_t) (yrs + ((yrs > 78) ? 1900 : 2000));
+    dt->day = (uint16_t) day;
+    dt->hrs = (uint8_t) hrs;
+    dt->min = (uint8_t) min;
+    dt->sec = (uint16_t) sec;
+    return 1;
+}
+
+static inline unsigned int is_flag_token(const char* tok, size_t len) {
+    if(len != 4) return 0;
+    for(size_t i = 0; i < 4; ++i) if(tok[i] != 'Y' && tok[i] != 'N') return 0;
+    return 1;
+}
+
+// shared state for parsing the $SKED section in newline-aligned chunks
+// every line owns the scan slot matching its index, every chunk owns as many station slots as its lines name stations
+// so chunks never contend, a chunk packs the stations of its parsed lines from the start of its slots
+// merging compacts the slots of parsed lines into scans, which makes the stations contiguous
+typedef struct {
+    const char** chunk_beg; // chunk_count + 1 boundaries
+    size_t* chunk_line; // index of each chunk's first line, chunk_count + 1 entries
+    size_t* chunk_slot; // index of each chunk's first station slot, chunk_count + 1 entries
+    size_t chunk_count, chunk_next;
+    Arena* arena; // scans are allocated from it
+    ScanTable scans;
+    size_t max_ids;
+    uint32_t* line_slot; // first station slot of each line
+    uint16_t* line_ids; // number of stations each line wrote to its slots
+    // names are interned as lines are parsed, the HashMaps are only ever read
+    HashMap sources_iau, sources_alias;
+    // every key is key_len characters, key_station maps their bytes read big-endian to the station
+    size_t key_len;
+    uint16_t* key_station; // 1 << (8 * key_len) entries
+    uint8_t* status;
+    size_t merged_lines, merged_scans;
+    size_t* skipped; // lines which didn't produce a scan
+    size_t skipped_count, skipped_cap;
+} SkedJob;
+
+// tokenizes a single $SKED line in one left-to-right pass
+// source cal freq PREOB yydddhhmmss obs MIDOB idle POSTOB wrap codes... YYNN offsets...
+// the status is reported instead of logged, since lines might be parsed out of order
+typedef enum {
+    SCAN_OK = 0,
+    SCAN_MALFORMED,
+    SCAN_BAD_DATETIME,
+    SCAN_BAD_CABLE_WRAP
+} ScanStatus;
+
+static ScanStatus parse_scan_line(const SkedJob* job, size_t idx, const char* line, const char* end) {
+    const char* tok;
+    char name[9];
+    size_t len, j, k;
+    Datetime timestamp;
+    const ScanTable* scans = &(job->scans);
+    uint16_t* stations = &(scans->stations[job->line_slot[idx]]);
+    uint32_t* offsets = &(scans->offsets[job->line_slot[idx]]);
+    size_t key, stride = job->key_len + 1;
+    // source name
+    len = next_token(&line, end, &tok);
+    if(len == 0 || len > 8) {
+        return SCAN_MALFORMED;
+    }
+    memcpy(name, tok, len);
+    name[len] = '\0';
+    scans->source[idx] = resolve_source(job->sources_iau, job->sources_alias, name);
+    // calibration duration, then skip frequency code and PREOB procedure
+    len = next_token(&line, end, &tok);
+    if(!decode_digits(tok, len, &(scans->cal_duration[idx])) || \
+        next_token(&line, end, &tok) == 0 || next_token(&line, end, &tok) == 0) {
+        return SCAN_MALFORMED;
+    }
+    len = next_token(&line, end, &tok);
+    if(!decode_scan_timestamp(tok, len, &timestamp)) {
+        return SCAN_BAD_DATETIME;
+    }
+    scans->timestamp[idx] = Datetime_to_ms(timestamp);
+    // observing duration, then skip MIDOB, idle and POSTOB
+    len = next_token(&line, end, &tok);
+    if(!decode_digits(tok, len, &(scans->obs_duration[idx])) || next_token(&line, end, &tok) == 0 || \
+        next_token(&line, end, &tok) == 0 || next_token(&line, end, &tok) == 0) {
+        return SCAN_MALFORMED;
+    }
+    // cable wrap string holds a station key followed by its wrap for each station
+    len = next_token(&line, end, &tok);
+    if(len == 0 || len % stride != 0 || len / stride > job->max_ids) {
+        return SCAN_BAD_CABLE_WRAP;
+    }
+    for(j = 0; j < len / stride; ++j) {
+        for(key = 0, k = 0; k < job->key_len; ++k) key = (key << 8) | (unsigned char) tok[j * stride + k];
+        stations[j] = job->key_station[key];
     }
+    job->line_ids[idx] = (uint16_t) j;
+    // skip the per-station recorder codes until the YYNN flags
+    do { len = next_token(&line, end, &tok); } while(len != 0 && !is_flag_token(tok, len));
+    for(k = 0; k < j; ++k) {
+        len = next_token(&line, end, &tok);
+        if(!decode_digits(tok, len, &(offsets[k]))) break;
+    }
+    for(; k < j; ++k) offsets[k] = 0;
+    return SCAN_OK;
+}
+
+unsigned int Schedule_scan_span(const char* line, const char* end, Datetime* start, Datetime* stop) {
+    const char* tok;
+    size_t len;
+    uint32_t cal_duration, obs_duration;
+    if(next_token(&line, end, &tok) == 0) return 1;
+    len = next_token(&line, end, &tok);
+    if(!decode_digits(tok, len, &cal_duration) || \
+        next_token(&line, end, &tok) == 0 || next_token(&line, end, &tok) == 0) return 1;
+    len = next_token(&line, end, &tok);
+    if(!decode_scan_timestamp(tok, len, start)) return 1;
+    len = next_token(&line, end, &tok);
+    if(!decode_digits(tok, len, &obs_duration)) return 1;
+    *stop = Datetime_add_seconds(*start, cal_duration + obs_duration);
+    return 0;
+}
+
+// every station is interned before any positions are read, since P lines may come first
+static unsigned int parse_section_stations(Schedule* skd, const char* beg, const char* end) {
+    skd->station_count = 0;
+    skd->stations = (Station*) Arena_alloc(skd->arena, (count_lines(beg, end) + 1) * sizeof(Station));
+    if(skd->stations == NULL) {
+        LOG_ERROR("Unable to allocate station table.");
+        return 1;
+    }
+    char* line = NULL;
+    size_t line_cap = 0;
+    const char* cursor = beg;
+    while(next_line(&cursor, end, &line, &line_cap)) if(line[0] == 'A') parse_antenna_line(skd, line);
+    cursor = beg;
+    while(next_line(&cursor, end, &line, &line_cap)) if(line[0] == 'P') parse_position_line(skd, line);
     free(line);
-    line = NULL;
-    scan_idx = seek_to_section(stream, "$SKED");
-    CLOSE_STREAM_ON_FAILURE(stream, scan_idx < 0, 1, "Schedule contains no $SKED section.");
-    skd->scan_count = 0;
-    while((line_len = getline(&line, &line_cap, stream)) != -1) {
-        if(line[0] == '$') break;
-        (skd->scan_count)++;
+    if(index_stations(skd)) {
+        LOG_ERROR("Unable to index stations.");
+        return 1;
+    }
+    return 0;
+}
+
+static unsigned int parse_section_sources(Schedule* skd, const char* beg, const char* end) {
+    skd->source_count = 0;
+    skd->sources = (Source*) Arena_alloc(skd->arena, (count_lines(beg, end) + 1) * sizeof(Source));
+    if(skd->sources == NULL) {
+        LOG_ERROR("Unable to allocate source table.");
+        return 1;
     }
+    char* line = NULL;
+    size_t line_cap = 0;
+    while(next_line(&beg, end, &line, &line_cap)) parse_source_line(skd, line);
     free(line);
-    line = NULL;
-    skd->scans = (ScanFAM*) malloc(skd->scan_count * (sizeof(ScanFAM) + skd->stations_ant.size + 1));
-    failure = fseek(stream, 0, SEEK_SET);
-    CLOSE_STREAM_ON_FAILURE(stream, failure, 1, "Unable to seek to beginning of schedule.");
-    scan_idx = seek_to_section(stream, "$SKED");
-    CLOSE_STREAM_ON_FAILURE(stream, scan_idx < 0, 1, "Failed to return to Schedule's $SKED section.");
-    char timestamp_raw[12];
-    char cable_wrap[skd->stations_ant.size * 2 + 1];
-    ScanFAM* current;
-    size_t i = 0, j, k = 0;
-    char* line_offset;
-    while((line_len = getline(&line, &line_cap, stream)) != -1 && i < skd->scan_count) {
-        if(line[0] == '$') break;
-        current = Schedule_get_scan(*skd, i);
-        ret = sscanf(line, " %8s %hu %*c%*c %*s %s %hu %*s %*u %*s %s %*s \n",
-            current->source, &(current->cal_duration), timestamp_raw, &(current->obs_duration), cable_wrap);
-        if(ret == 5) {
-            failure = Datetime_parse_from_scan(&(current->timestamp), "y2d3h2m2s2", timestamp_raw);
-            if(failure) {
-                LOG_INFO("Failed to parse observation Datetime. Skipping observation.");
-                continue;
-            }
-            if(strlen(cable_wrap) % 2 != 0) {
-                LOG_INFO("Invalid cable wrap string. Skipping observation.");
-                continue;
+    if(index_sources(skd)) {
+        LOG_ERROR("Unable to index sources.");
+        return 1;
+    }
+    return 0;
+}
+
+// $SKED sections smaller than this are parsed on the calling thread
+#define SKED_PARALLEL_MIN_BYTES (1 << 18)
+#define SKED_CHUNKS_PER_THREAD 4
+// when streaming, scans are published after every batch of chunks of roughly this size
+#define SKED_STREAM_CHUNK_BYTES (1 << 20)
+
+// number of stations parse_scan_line would write for the line, i.e. the stations in its cable wrap string
+// 0 if the string is missing or invalid
+static size_t count_line_ids(const SkedJob* job, const char* line, const char* end) {
+    const char* tok;
+    size_t len = 0, stride = job->key_len + 1;
+    for(size_t i = 0; i < 10; ++i) len = next_token(&line, end, &tok);
+    if(len % stride != 0 || len / stride > job->max_ids) return 0;
+    return len / stride;
+}
+
+// counts every chunk's lines and the station slots they need
+static void count_chunk_lines(void* ctx, size_t chunk) {
+    SkedJob* job = (SkedJob*) ctx;
+    const char* beg = job->chunk_beg[chunk];
+    const char* end = job->chunk_beg[chunk + 1];
+    const char* line_end;
+    size_t line_count = 0, slot_count = 0;
+    while(beg < end) {
+        line_end = (const char*) memchr(beg, '\n', (size_t) (end - beg));
+        if(line_end == NULL) line_end = end;
+        slot_count += count_line_ids(job, beg, line_end);
+        line_count++;
+        beg = line_end + 1;
+    }
+    job->chunk_line[chunk] = line_count;
+    job->chunk_slot[chunk] = slot_count;
+}
+
+static void parse_chunk_lines(void* ctx, size_t idx) {
+    SkedJob* job = (SkedJob*) ctx;
+    size_t chunk = job->chunk_next + idx;
+    const char* beg = job->chunk_beg[chunk];
+    const char* end = job->chunk_beg[chunk + 1];
+    const char* line_end;
+    uint32_t slot = (uint32_t) job->chunk_slot[chunk];
+    for(size_t i = job->chunk_line[chunk]; beg < end; ++i) {
+        line_end = (const char*) memchr(beg, '\n', (size_t) (end - beg));
+        if(line_end == NULL) line_end = end;
+        job->line_slot[i] = slot;
+        job->status[i] = (uint8_t) parse_scan_line(job, i, beg, line_end);
+        // lines which failed to parse give their slots to the next one
+        if(job->status[i] == SCAN_OK) slot += job->line_ids[i];
+        beg = line_end + 1;
+    }
+}
+
+// skipped_count is left at SIZE_MAX once a line can't be recorded
+static void SkedJob_skip(SkedJob* job, size_t line) {
+    if(job->skipped_count == SIZE_MAX) return;
+    if(job->skipped_count == job->skipped_cap) {
+        size_t skipped_cap = (job->skipped_cap == 0) ? 64 : job->skipped_cap * 2;
+        size_t* temp = (size_t*) realloc(job->skipped, skipped_cap * sizeof(size_t));
+        if(temp == NULL) {
+            LOG_INFO("Unable to record skipped observation. Reloads will re-parse every scan.");
+            free(job->skipped);
+            job->skipped = NULL;
+            job->skipped_count = SIZE_MAX;
+            return;
+        }
+        job->skipped = temp;
+        job->skipped_cap = skipped_cap;
+    }
+    job->skipped[(job->skipped_count)++] = line;
+}
+
+static void SkedJob_free(SkedJob* job) {
+    free(job->chunk_beg);
+    free(job->chunk_line);
+    free(job->chunk_slot);
+    free(job->line_slot);
+    free(job->line_ids);
+    free(job->status);
+    free(job->key_station);
+    job->chunk_beg = NULL;
+    job->chunk_line = NULL;
+    job->chunk_slot = NULL;
+    job->line_slot = NULL;
+    job->line_ids = NULL;
+    job->status = NULL;
+    job->key_station = NULL;
+}
+
+// splits the section into chunks which start on a line boundary and allocates every scan slot from arena
+// stations and sources are resolved through skd's tables
+static unsigned int SkedJob_init(SkedJob* job, const Schedule* skd, Arena* arena, const char* beg, const char* end, size_t chunk_count) {
+    size_t i, section_len = (size_t) (end - beg);
+    memset(job, 0, sizeof(SkedJob));
+    job->arena = arena;
+    job->sources_iau = skd->sources_iau;
+    job->sources_alias = skd->sources_alias;
+    // index_stations left every key just as wide as the first one
+    job->key_len = (skd->station_count == 0) ? 1 : strlen(skd->stations[0].key);
+    size_t j, key, key_count = (size_t) 1 << (8 * job->key_len);
+    job->key_station = (uint16_t*) malloc(key_count * sizeof(uint16_t));
+    job->chunk_count = chunk_count;
+    job->chunk_beg = (const char**) malloc((chunk_count + 1) * sizeof(const char*));
+    job->chunk_line = (size_t*) malloc((chunk_count + 1) * sizeof(size_t));
+    job->chunk_slot = (size_t*) malloc((chunk_count + 1) * sizeof(size_t));
+    if(job->key_station == NULL || job->chunk_beg == NULL || job->chunk_line == NULL || job->chunk_slot == NULL) {
+        LOG_ERROR("Unable to allocate $SKED chunk table.");
+        SkedJob_free(job);
+        return 1;
+    }
+    for(key = 0; key < key_count; ++key) job->key_station[key] = STATION_NONE;
+    for(i = 0; i < skd->station_count; ++i) {
+        for(key = 0, j = 0; j < job->key_len; ++j) key = (key << 8) | (unsigned char) skd->stations[i].key[j];
+        job->key_station[key] = (uint16_t) i;
+    }
+    const char* split;
+    job->chunk_beg[0] = beg;
+    for(i = 1; i < chunk_count; ++i) {
+        split = beg + section_len / chunk_count * i;
+        if(split < job->chunk_beg[i - 1]) split = job->chunk_beg[i - 1];
+        split = (const char*) memchr(split, '\n', (size_t) (end - split));
+        job->chunk_beg[i] = (split == NULL) ? end : split + 1;
+    }
+    job->chunk_beg[chunk_count] = end;
+    // count lines and station slots per chunk, then turn the counts into each chunk's first line and slot
+    job->max_ids = skd->station_count;
+    size_t line_count = 0, slot_count = 0, temp;
+    pool_run(chunk_count, count_chunk_lines, job);
+    for(i = 0; i < chunk_count; ++i) {
+        temp = job->chunk_line[i];
+        job->chunk_line[i] = line_count;
+        line_count += temp;
+        temp = job->chunk_slot[i];
+        job->chunk_slot[i] = slot_count;
+        slot_count += temp;
+    }
+    job->chunk_line[chunk_count] = line_count;
+    job->chunk_slot[chunk_count] = slot_count;
+    // station_beg indexes the slots with 32 bits
+    if(slot_count >= UINT32_MAX) {
+        LOG_ERROR("$SKED section is too large to index its stations.");
+        SkedJob_free(job);
+        return 1;
+    }
+    // the section's line and slot counts bound the scans, so the columns are allocated once
+    job->line_slot = (uint32_t*) malloc((line_count + 1) * sizeof(uint32_t));
+    job->line_ids = (uint16_t*) malloc((line_count + 1) * sizeof(uint16_t));
+    job->status = (uint8_t*) malloc(line_count + 1);
+    if(job->line_slot == NULL || job->line_ids == NULL || job->status == NULL || \
+        ScanTable_alloc(arena, &(job->scans), line_count, slot_count, STATION_SET_WORDS(skd->station_count))) {
+        LOG_ERROR("Unable to allocate scan buffer.");
+        SkedJob_free(job);
+        return 1;
+    }
+    return 0;
+}
+
+// moves line's slots to scan k, its stations are appended right after the previous scan's
+// they never move past the line's own slots, since every line before it packed its stations first
+static inline void SkedJob_compact(SkedJob* job, size_t k, size_t line) {
+    ScanTable* scans = &(job->scans);
+    size_t beg = scans->station_beg[k], count = job->line_ids[line];
+    if(k != line) {
+        scans->timestamp[k] = scans->timestamp[line];
+        scans->cal_duration[k] = scans->cal_duration[line];
+        scans->obs_duration[k] = scans->obs_duration[line];
+        scans->source[k] = scans->source[line];
+    }
+    if(beg != job->line_slot[line]) {
+        memmove(&(scans->stations[beg]), &(scans->stations[job->line_slot[line]]), count * sizeof(uint16_t));
+        memmove(&(scans->offsets[beg]), &(scans->offsets[job->line_slot[line]]), count * sizeof(uint32_t));
+    }
+    scans->station_beg[k + 1] = (uint32_t) (beg + count);
+    ScanTable_fill_set(scans, k);
+}
+
+// parses every chunk before chunk_end, then merges their lines in order
+// slots of lines which failed to parse are dropped, scans before merged_scans are final
+static void SkedJob_advance(SkedJob* job, size_t chunk_end) {
+    if(chunk_end > job->chunk_count) chunk_end = job->chunk_count;
+    if(chunk_end <= job->chunk_next) return;
+    pool_run(chunk_end - job->chunk_next, parse_chunk_lines, job);
+    job->chunk_next = chunk_end;
+    size_t i;
+    for(i = job->merged_lines; i < job->chunk_line[chunk_end]; ++i) {
+        if(job->status[i] != SCAN_OK) SkedJob_skip(job, i);
+        switch((ScanStatus) job->status[i]) {
+            case SCAN_OK:
+                SkedJob_compact(job, job->merged_scans, i);
+                job->merged_scans++;
+                break;
+            case SCAN_MALFORMED: LOG_INFO("Failed to parse observation."); break;
+            case SCAN_BAD_DATETIME: LOG_INFO("Failed to parse observation Datetime. Skipping observation."); break;
+            case SCAN_BAD_CABLE_WRAP: LOG_INFO("Invalid cable wrap string. Skipping observation."); break;
+        }
+    }
+    job->merged_lines = i;
+}
+
+// gives back the station slots of lines which were skipped
+// only called once the job is done, since the stream hands out the columns while it runs
+static void SkedJob_shrink(SkedJob* job) {
+    size_t slot_count = job->chunk_slot[job->chunk_count];
+    size_t member_count = job->scans.station_beg[job->merged_scans];
+    uint16_t* stations = (uint16_t*) Arena_realloc(job->arena, job->scans.stations, \
+        (slot_count + 1) * sizeof(uint16_t), (member_count + 1) * sizeof(uint16_t));
+    if(stations != NULL) job->scans.stations = stations;
+    uint32_t* offsets = (uint32_t*) Arena_realloc(job->arena, job->scans.offsets, \
+        (slot_count + 1) * sizeof(uint32_t), (member_count + 1) * sizeof(uint32_t));
+    if(offsets != NULL) job->scans.offsets = offsets;
+}
+
+// parses every line in [beg, end) into scans allocated from arena, only the scans and skipped lines are left in job
+static unsigned int SkedJob_run(SkedJob* job, const Schedule* skd, Arena* arena, const char* beg, const char* end) {
+    size_t chunk_count = 1;
+    if((size_t) (end - beg) >= SKED_PARALLEL_MIN_BYTES) chunk_count = pool_thread_count() * SKED_CHUNKS_PER_THREAD;
+    if(SkedJob_init(job, skd, arena, beg, end, chunk_count)) return 1;
+    SkedJob_advance(job, job->chunk_count);
+    SkedJob_shrink(job);
+    SkedJob_free(job);
+    return 0;
+}
+
+// hands the job's scans to skd and copies its skipped lines into skd's arena
+static void SkedJob_finish(SkedJob* job, Schedule* skd) {
+    skd->scans = job->scans;
+    skd->scan_count = job->merged_scans;
+    skd->skipped_lines = NULL;
+    skd->skipped_count = job->skipped_count;
+    if(job->skipped_count != SIZE_MAX) {
+        skd->skipped_lines = (size_t*) Arena_alloc(skd->arena, (job->skipped_count + 1) * sizeof(size_t));
+        if(skd->skipped_lines == NULL) {
+            LOG_INFO("Unable to record skipped observations. Reloads will re-parse every scan.");
+            skd->skipped_count = SIZE_MAX;
+        } else if(job->skipped_count > 0) {
+            memcpy(skd->skipped_lines, job->skipped, job->skipped_count * sizeof(size_t));
+        }
+    }
+    free(job->skipped);
+    job->skipped = NULL;
+}
+
+static unsigned int parse_section_sked(Schedule* skd, const char* beg, const char* end) {
+    SkedJob job;
+    if(SkedJob_run(&job, skd, skd->arena, beg, end)) return 1;
+    SkedJob_finish(&job, skd);
+    return Schedule_index_scans(skd);
+}
+
+typedef struct {
+    uint16_t station;
+    TimeMs from, until;
+} Downtime;
+
+static int compare_downtime(const void* fst, const void* snd) {
+    const Downtime* a = (const Downtime*) fst;
+    const Downtime* b = (const Downtime*) snd;
+    if(a->station != b->station) return (int) a->station - (int) b->station;
+    return (a->from > b->from) - (a->from < b->from);
+}
+
+// decodes the 17-character yyyy-ddd-hh:mm:ss timestamp used in $DOWNTIME lines
+static inline unsigned int decode_downtime_timestamp(const char* str, size_t len, TimeMs* ms) {
+    uint32_t yrs, day, hrs, min, sec;
+    if(len != 17 || str[4] != '-' || str[8] != '-' || str[11] != ':' || str[14] != ':') return 0;
+    if(!decode_digits(&(str[0]), 4, &yrs) || !decode_digits(&(str[5]), 3, &day) || \
+        !decode_digits(&(str[9]), 2, &hrs) || !decode_digits(&(str[12]), 2, &min) || \
+        !decode_digits(&(str[15]), 2, &sec)) return 0;
+    *ms = Datetime_to_ms((Datetime) { .yrs = (uint16_t) yrs, .day = (uint16_t) day, .hrs = (uint8_t) hrs, .min = (uint8_t) min, .sec = (uint16_t) sec });
+    return 1;
+}
+
+// every line is written by sked as <station> <yyyy-ddd-hh:mm:ss> <yyyy-ddd-hh:mm:ss>, the station going down and coming back up
+// the station is named by its 2-char id or its key, overlapping windows of a station are merged
+// blank lines are ignored, any other line which can't be read, names an unknown station or is empty is logged and skipped
+static void* parse_section_downtime(Schedule* skd, const char* line, const char* end) {
+    Downtime* windows = NULL,* temp;
+    size_t i, count = 0, cap = 0, len;
+    const char* line_end,* tok;
+    char name[9];
+    TimeMs from, until;
+    const Station* station;
+    for(; line < end; line = line_end) {
+        line_end = (const char*) memchr(line, '\n', (size_t) (end - line));
+        line_end = (line_end == NULL) ? end : line_end + 1;
+        len = next_token(&line, line_end, &tok);
+        if(len == 0) continue;
+        if(len >= sizeof(name)) {
+            LOG_INFO("Skipping malformed $DOWNTIME line.");
+            continue;
+        }
+        memcpy(name, tok, len);
+        name[len] = '\0';
+        len = next_token(&line, line_end, &tok);
+        if(!decode_downtime_timestamp(tok, len, &from)) {
+            LOG_INFO("Skipping malformed $DOWNTIME line.");
+            continue;
+        }
+        len = next_token(&line, line_end, &tok);
+        if(!decode_downtime_timestamp(tok, len, &until)) {
+            LOG_INFO("Skipping malformed $DOWNTIME line.");
+            continue;
+        }
+        station = Schedule_find_station(*skd, name);
+        if(station == NULL) {
+            LOG_INFO("Skipping downtime of an undefined station.");
+            continue;
+        }
+        if(until <= from) {
+            LOG_INFO("Skipping empty downtime window.");
+            continue;
+        }
+        if(count == cap) {
+            cap = (cap == 0) ? 16 : cap * 2;
+            temp = (Downtime*) realloc(windows, cap * sizeof(Downtime));
+            if(temp == NULL) {
+                LOG_ERROR("Unable to allocate station downtime.");
+                free(windows);
+                return NULL;
             }
-            for(j = 0; j < strlen(cable_wrap) / 2; ++j) current->ids[j] = cable_wrap[j * 2];
-            current->ids[j + 1] = '\0';
-            current->scan_offsets = (uint16_t*) malloc(strlen(current->ids) * sizeof(uint16_t));
-            if(current->scan_offsets == NULL) {
-                LOG_INFO("Failed to allocate scan duration offsets.");
-            } else {
-                line_offset = &(line[4]);
-                while(line_offset[0] != '\n' || line_offset[0] != '\0') {
-                    // TODO: Messy
-                    if( \
-                        ((line_offset - 4)[0] == 'Y' || (line_offset - 4)[0] == 'N') && \
-                        ((line_offset - 3)[0] == 'Y' || (line_offset - 3)[0] == 'N') && \
-                        ((line_offset - 2)[0] == 'Y' || (line_offset - 2)[0] == 'N') && \
-                        ((line_offset - 1)[0] == 'Y' || (line_offset - 1)[0] == 'N') && 1
-                    ) break;
-                    line_offset += 1;
+            windows = temp;
+        }
+        windows[count++] = (Downtime) { .station = (uint16_t) (station - skd->stations), .from = from, .until = until };
+    }
+    StationDowntime* downtime = (StationDowntime*) Arena_alloc(skd->arena, sizeof(StationDowntime));
+    if(downtime != NULL) {
+        downtime->beg = (uint32_t*) Arena_alloc(skd->arena, (skd->station_count + 1) * sizeof(uint32_t));
+        downtime->from = (TimeMs*) Arena_alloc(skd->arena, (count + 1) * sizeof(TimeMs));
+        downtime->until = (TimeMs*) Arena_alloc(skd->arena, (count + 1) * sizeof(TimeMs));
+    }
+    if(downtime == NULL || downtime->beg == NULL || downtime->from == NULL || downtime->until == NULL) {
+        LOG_ERROR("Unable to allocate station downtime.");
+        free(windows);
+        return NULL;
+    }
+    memset(downtime->beg, 0, (skd->station_count + 1) * sizeof(uint32_t));
+    if(count > 0) qsort(windows, count, sizeof(Downtime), compare_downtime);
+    // windows are counted per station and then turned into offsets
+    size_t merged = 0;
+    for(i = 0; i < count; ++i) {
+        if(i > 0 && windows[i].station == windows[i - 1].station && windows[i].from <= downtime->until[merged - 1]) {
+            if(windows[i].until > downtime->until[merged - 1]) downtime->until[merged - 1] = windows[i].until;
+            continue;
+        }
+        downtime->from[merged] = windows[i].from;
+        downtime->until[merged] = windows[i].until;
+        downtime->beg[windows[i].station + 1]++;
+        merged++;
+    }
+    for(i = 0; i < skd->station_count; ++i) downtime->beg[i + 1] += downtime->beg[i];
+    free(windows);
+    return downtime;
+}
+
+// sections which have a parser, every other section is only indexed
+// eager sections are parsed as the Schedule is built, $STATIONS must be listed before $SKED since scans are resolved through it
+// the rest are parsed when they're first asked for, what their parser returns is kept in the section's data
+static const struct {
+    const char* name;
+    unsigned int (*parse)(Schedule*, const char*, const char*);
+    void* (*parse_lazy)(Schedule*, const char*, const char*);
+    unsigned int eager;
+} SectionParsers[] = {
+    { .name = "$STATIONS", .parse = parse_section_stations, .parse_lazy = NULL, .eager = 1 },
+    { .name = "$SOURCES", .parse = parse_section_sources, .parse_lazy = NULL, .eager = 1 },
+    { .name = "$SKED", .parse = parse_section_sked, .parse_lazy = NULL, .eager = 1 },
+    { .name = "$DOWNTIME", .parse = NULL, .parse_lazy = parse_section_downtime, .eager = 0 },
+};
+
+const Section* Schedule_get_section(Schedule skd, const char* name) {
+    for(size_t i = 0; i < skd.section_count; ++i) {
+        if(strcmp(skd.sections[i].name, name) == 0) return &(skd.sections[i]);
+    }
+    return NULL;
+}
+
+unsigned int Schedule_parse_section(Schedule* skd, const char* name) {
+    Section* section = (Section*) Schedule_get_section(*skd, name);
+    if(section == NULL) return 1;
+    if(section->parsed) return 0;
+    for(size_t i = 0; i < (sizeof(SectionParsers) / sizeof(SectionParsers[0])); ++i) {
+        if(strcmp(SectionParsers[i].name, name) != 0) continue;
+        if(SectionParsers[i].eager) {
+            if(SectionParsers[i].parse(skd, skd->src + section->beg, skd->src + section->end)) return 1;
+        } else {
+            section->data = SectionParsers[i].parse_lazy(skd, skd->src + section->beg, skd->src + section->end);
+            if(section->data == NULL) return 1;
+        }
+        break;
+    }
+    section->parsed = 1;
+    return 0;
+}
+
+// the section table is shared by every copy of the Schedule, so whatever parses the section first parses it for all of them
+const void* Schedule_get_section_data(Schedule skd, const char* name) {
+    const Section* section = Schedule_get_section(skd, name);
+    if(section == NULL || Schedule_parse_section(&skd, name)) return NULL;
+    return section->data;
+}
+
+const StationDowntime* Schedule_get_downtime(Schedule skd) {
+    return (const StationDowntime*) Schedule_get_section_data(skd, "$DOWNTIME");
+}
+
+// eager sections were parsed as the Schedule was built, the rest start out unparsed
+static void mark_eager_sections(Schedule* skd) {
+    size_t i;
+    Section* section;
+    for(i = 0; i < skd->section_count; ++i) {
+        skd->sections[i].parsed = 0;
+        skd->sections[i].data = NULL;
+    }
+    for(i = 0; i < (sizeof(SectionParsers) / sizeof(SectionParsers[0])); ++i) {
+        section = (Section*) Schedule_get_section(*skd, SectionParsers[i].name);
+        if(SectionParsers[i].eager && section != NULL) section->parsed = 1;
+    }
+}
+
+// records the byte range of every $-section in a single scan over the source
+static unsigned int build_section_table(Schedule* skd) {
+    size_t section_cap = 32;
+    skd->section_count = 0;
+    skd->sections = (Section*) Arena_alloc(skd->arena, section_cap * sizeof(Section));
+    if(skd->sections == NULL) {
+        LOG_ERROR("Unable to allocate section table.");
+        return 1;
+    }
+    const char* line = skd->src;
+    const char* end = skd->src + skd->src_len;
+    const char* line_end;
+    Section* section;
+    size_t name_len;
+    while(line < end) {
+        line_end = (const char*) memchr(line, '\n', (size_t) (end - line));
+        line_end = (line_end == NULL) ? end : line_end + 1;
+        if(line[0] == '$') {
+            if(skd->section_count > 0) skd->sections[skd->section_count - 1].end = (size_t) (line - skd->src);
+            if(skd->section_count == section_cap) {
+                section = (Section*) Arena_realloc(skd->arena, skd->sections, section_cap * sizeof(Section), section_cap * 2 * sizeof(Section));
+                if(section == NULL) {
+                    LOG_ERROR("Unable to grow section table.");
+                    return 1;
                 }
-                // the pointer now points to the whitespace after the YYNN sequence
-                while(sscanf(line_offset, " %hu", &(current->scan_offsets[k])) == 1) {
-                    while(isspace(line_offset[0])) line_offset++;
-                    while(isdigit(line_offset[0])) line_offset++;
-                    k++;
-                }; k = 0;
+                skd->sections = section;
+                section_cap *= 2;
+            }
+            section = &(skd->sections[(skd->section_count)++]);
+            for(name_len = 0; line + name_len < line_end && !isspace(line[name_len]); ++name_len);
+            if(name_len >= sizeof(section->name)) name_len = sizeof(section->name) - 1;
+            memcpy(section->name, line, name_len);
+            section->name[name_len] = '\0';
+            section->head = (size_t) (line - skd->src);
+            section->beg = (size_t) (line_end - skd->src);
+            section->end = skd->src_len;
+            section->parsed = 0;
+            section->data = NULL;
+        }
+        line = line_end;
+    }
+    return 0;
+}
+
+// the name lookups start out empty, index_stations and index_sources reserve them once the counts are known
+static unsigned int init_names(Schedule* skd) {
+    return HashMap_init_in(&(skd->stations_ant), skd->arena, 0, sizeof(uint32_t)) || \
+        HashMap_init_in(&(skd->stations_pos), skd->arena, 0, sizeof(uint32_t)) || \
+        HashMap_init_in(&(skd->sources_iau), skd->arena, 0, sizeof(uint32_t)) || \
+        HashMap_init_in(&(skd->sources_alias), skd->arena, 0, sizeof(uint32_t));
+}
+
+// parses every eager section, $SKED is skipped when it is going to be streamed
+// everything is allocated from a new arena, which Schedule_free releases even if this fails
+static unsigned int Schedule_build_from_text(Schedule* skd, unsigned int defer_sked) {
+    skd->arena = Arena_create(SCHEDULE_ARENA_BYTES);
+    if(skd->arena == NULL) {
+        LOG_ERROR("Unable to allocate schedule arena.");
+        return 1;
+    }
+    skd->station_count = 0;
+    skd->stations = NULL;
+    skd->source_count = 0;
+    skd->sources = NULL;
+    skd->scan_count = 0;
+    memset(&(skd->scans), 0, sizeof(ScanTable));
+    memset(&(skd->scan_index), 0, sizeof(ScanIndex));
+    skd->sections = NULL;
+    skd->skipped_lines = NULL;
+    skd->skipped_count = 0;
+    unsigned int failure = init_names(skd) || build_section_table(skd);
+    for(size_t i = 0; !failure && i < (sizeof(SectionParsers) / sizeof(SectionParsers[0])); ++i) {
+        if(!SectionParsers[i].eager) continue;
+        if(Schedule_get_section(*skd, SectionParsers[i].name) == NULL) {
+            LOG_ERROR("Schedule is missing a required section.");
+            failure = 1;
+        } else if(!defer_sked || strcmp(SectionParsers[i].name, "$SKED") != 0) {
+            failure = Schedule_parse_section(skd, SectionParsers[i].name);
+        }
+    }
+    return failure;
+}
+
+typedef enum {
+    OPEN_FAILED,
+    OPEN_CACHED,
+    OPEN_TEXT,
+    OPEN_ARCHIVE
+} OpenResult;
+
+// reads the schedule and loads its compiled image if there is a matching one
+// compressed schedules are left to Schedule_build_from_archive
+// src holds the file's contents if they were already read, the Schedule takes ownership of it
+static OpenResult Schedule_open(Schedule* skd, const char* path, char* src, ScheduleStamp* stamp, unsigned int* stamped) {
+    ArchiveFormat format = ARCHIVE_PLAIN;
+    if(src == NULL && archive_format(path, &format)) {
+        LOG_ERROR("Schedule couldn't be opened.");
+        return OPEN_FAILED;
+    }
+    if(src == NULL && format != ARCHIVE_PLAIN) return OPEN_ARCHIVE;
+    // the file is read exactly once and kept around so sections can be parsed on demand
+    skd->src = (src == NULL) ? (char*) read_file_contents(path) : src;
+    if(skd->src == NULL) {
+        LOG_ERROR("Schedule couldn't be opened.");
+        return OPEN_FAILED;
+    }
+    skd->src_len = strlen(skd->src);
+    skd->arena = NULL;
+    skd->image = (ScheduleImage) { .addr = NULL, .len = 0 };
+    skd->stream = NULL;
+    skd->skipped_lines = NULL;
+    skd->skipped_count = 0;
+    *stamped = 0;
+#ifndef NO_SKD_CACHE
+    // prefer the compiled schedule, it's only trusted if it was stamped with this exact file
+    *stamped = !ScheduleStamp_init(stamp, path, skd->src, skd->src_len);
+    if(*stamped && !ScheduleCache_load(skd, path, *stamp)) {
+        // the image may have been written after a lazy section was parsed, which it doesn't hold
+        mark_eager_sections(skd);
+        return OPEN_CACHED;
+    }
+#else
+    (void) path;
+    (void) stamp;
+#endif
+    return OPEN_TEXT;
+}
+
+// decompressed text is parsed through a window of this size, it only grows to fit a longer line
+#define ARCHIVE_WINDOW_BYTES (1 << 22)
+
+// state of a compressed schedule which is parsed as it's decoded
+// every line but the body of $SKED is kept in src, so the other sections can still be parsed on demand
+typedef struct {
+    Schedule* skd;
+    size_t src_cap, scan_cap, member_cap;
+    unsigned int in_sked, sked_seen;
+} ArchiveLoad;
+
+static inline const char* next_line_start(const char* line, const char* end) {
+    line = (const char*) memchr(line, '\n', (size_t) (end - line));
+    return (line == NULL) ? end : line + 1;
+}
+
+static inline unsigned int is_sked_header(const char* line, const char* end) {
+    return end - line >= 5 && memcmp(line, "$SKED", 5) == 0 && (end - line == 5 || isspace(line[5]));
+}
+
+static unsigned int archive_keep(ArchiveLoad* load, const char* beg, const char* end) {
+    Schedule* skd = load->skd;
+    size_t len = (size_t) (end - beg);
+    if(skd->src_len + len + 1 > load->src_cap) {
+        size_t cap = (load->src_cap == 0) ? 4096 : load->src_cap;
+        while(cap < skd->src_len + len + 1) cap *= 2;
+        char* temp = (char*) realloc(skd->src, cap);
+        if(temp == NULL) {
+            LOG_ERROR("Unable to grow schedule text.");
+            return 1;
+        }
+        skd->src = temp;
+        load->src_cap = cap;
+    }
+    memcpy(skd->src + skd->src_len, beg, len);
+    skd->src_len += len;
+    skd->src[skd->src_len] = '\0';
+    return 0;
+}
+
+// parses the $SKED lines in [beg, end) and appends their scans
+// the lines are parsed into a scratch arena, so only the appended scans are left in skd's
+static unsigned int archive_sked(ArchiveLoad* load, const char* beg, const char* end) {
+    Schedule* skd = load->skd;
+    SkedJob job;
+    Arena* scratch = Arena_create(SCHEDULE_ARENA_BYTES);
+    if(scratch == NULL) {
+        LOG_ERROR("Unable to allocate scan buffer.");
+        return 1;
+    }
+    if(SkedJob_run(&job, skd, scratch, beg, end)) {
+        Arena_release(scratch);
+        return 1;
+    }
+    free(job.skipped);
+    size_t member_count = job.scans.station_beg[job.merged_scans];
+    size_t member_total = skd->scans.station_beg[skd->scan_count] + member_count;
+    if(skd->scan_count + job.merged_scans > load->scan_cap || member_total > load->member_cap) {
+        size_t scan_cap = (load->scan_cap == 0) ? job.merged_scans : load->scan_cap * 2;
+        size_t member_cap = (load->member_cap == 0) ? member_count : load->member_cap * 2;
+        if(scan_cap < skd->scan_count + job.merged_scans) scan_cap = skd->scan_count + job.merged_scans;
+        if(member_cap < member_total) member_cap = member_total;
+        if(ScanTable_resize(skd->arena, &(skd->scans), load->scan_cap, load->member_cap, scan_cap, member_cap)) {
+            LOG_ERROR("Unable to grow scan buffer.");
+            Arena_release(scratch);
+            return 1;
+        }
+        load->scan_cap = scan_cap;
+        load->member_cap = member_cap;
+    }
+    ScanTable_copy(&(skd->scans), skd->scan_count, job.scans, 0, job.merged_scans);
+    skd->scan_count += job.merged_scans;
+    Arena_release(scratch);
+    return 0;
+}
+
+// handles the complete lines in [beg, end)
+static unsigned int archive_lines(ArchiveLoad* load, const char* beg, const char* end) {
+    const char* run;
+    while(beg < end) {
+        // $SKED runs up to the next section header
+        if(load->in_sked) {
+            for(run = beg; run < end && *run != '$'; run = next_line_start(run, end));
+            if(run > beg && archive_sked(load, beg, run)) return 1;
+            if(run == end) return 0;
+            beg = run;
+            load->in_sked = 0;
+        }
+        for(run = beg; run < end && !is_sked_header(run, end); run = next_line_start(run, end));
+        if(run == end) return archive_keep(load, beg, end);
+        run = next_line_start(run, end);
+        if(archive_keep(load, beg, run)) return 1;
+        beg = run;
+        load->in_sked = 1;
+        // scans are resolved through $STATIONS and $SOURCES, so everything before $SKED is parsed first
+        if(!load->sked_seen) {
+            load->sked_seen = 1;
+            if(Schedule_build_from_text(load->skd, 1)) return 1;
+            if(ScanTable_alloc(load->skd->arena, &(load->skd->scans), 0, 0, STATION_SET_WORDS(load->skd->station_count))) {
+                LOG_ERROR("Unable to allocate scan buffer.");
+                return 1;
             }
-            if(current->timestamp.yrs < 100) {
-                if(current->timestamp.yrs > 78) current->timestamp.yrs += 1900; // TODO: Look for a better way to handle this
-                else current->timestamp.yrs += 2000;
+        }
+    }
+    return 0;
+}
+
+// builds the Schedule while the compressed file is decoded
+// $STATIONS and $SOURCES must come before $SKED, which is the case for schedules written by sked
+static unsigned int Schedule_build_from_archive(Schedule* skd, const char* path) {
+    Archive archive;
+    if(Archive_open(&archive, path)) {
+        LOG_ERROR("Schedule couldn't be opened.");
+        return 2;
+    }
+    ArchiveLoad load = { .skd = skd };
+    skd->src = NULL;
+    skd->src_len = 0;
+    skd->arena = NULL;
+    skd->sections = NULL;
+    skd->image = (ScheduleImage) { .addr = NULL, .len = 0 };
+    skd->stream = NULL;
+    size_t window_cap = ARCHIVE_WINDOW_BYTES, fill = 0, len;
+    char* window = (char*) malloc(window_cap);
+    char* temp;
+    const char* last;
+    unsigned int failure = window == NULL;
+    if(failure) LOG_ERROR("Unable to allocate decompression window.");
+    while(!failure) {
+        if(fill == window_cap) {
+            temp = (char*) realloc(window, window_cap * 2);
+            if(temp == NULL) {
+                LOG_ERROR("Unable to grow decompression window.");
+                failure = 1;
+                break;
             }
-            i++;
-        } else {
-            LOG_INFO("Failed to parse observation.");
+            window = temp;
+            window_cap *= 2;
+        }
+        len = Archive_read(&archive, window + fill, window_cap - fill);
+        if(len == 0) {
+            // the last line may not be terminated
+            failure = archive.failure;
+            if(!failure && fill > 0) failure = archive_lines(&load, window, window + fill);
+            break;
         }
+        fill += len;
+        for(last = window + fill; last > window && *(last - 1) != '\n'; --last);
+        if(last == window) continue;
+        failure = archive_lines(&load, window, last);
+        fill -= (size_t) (last - window);
+        memmove(window, last, fill);
     }
-    free(line);
-    skd->scan_count = i;
-    fclose(stream);
+    free(window);
+    Archive_close(&archive);
+    if(!failure && !load.sked_seen) {
+        LOG_ERROR("Schedule is missing a required section.");
+        failure = 1;
+    }
+    // index the sections again now that all of the text is known
+    if(!failure) failure = build_section_table(skd) || Schedule_index_scans(skd);
+    if(failure) {
+        if(load.sked_seen) Schedule_free(*skd);
+        else free(skd->src);
+        return 1;
+    }
+    mark_eager_sections(skd);
+    // the $SKED text isn't kept, so a reload can't diff against it
+    skd->skipped_lines = NULL;
+    skd->skipped_count = SIZE_MAX;
     return 0;
 }
+
+static unsigned int Schedule_build(Schedule* skd, const char* path, char* src) {
+    ScheduleStamp stamp;
+    unsigned int stamped;
+    switch(Schedule_open(skd, path, src, &stamp, &stamped)) {
+        case OPEN_FAILED: return 2;
+        case OPEN_CACHED: return 0;
+        case OPEN_TEXT: break;
+        case OPEN_ARCHIVE: return Schedule_build_from_archive(skd, path);
+    }
+    unsigned int failure = Schedule_build_from_text(skd, 0);
+    if(failure) {
+        Schedule_free(*skd);
+        return failure;
+    }
+#ifndef NO_SKD_CACHE
+    if(stamped) ScheduleCache_write(*skd, path, stamp);
+#endif
+    return 0;
+}
+
+unsigned int Schedule_build_from_source(Schedule* skd, const char* path) {
+    return Schedule_build(skd, path, NULL);
+}
+
+unsigned int Schedule_build_from_memory(Schedule* skd, const char* path, char* src) {
+    return Schedule_build(skd, path, src);
+}
+
+// background parse of the $SKED section
+// the worker only writes scan slots at or beyond published, so they're never read early
+struct __SKD_H__ScheduleStream {
+    pthread_t thread;
+    SkedJob job;
+    // private copy used to write the compiled schedule once parsing completes
+    Schedule snapshot;
+    char* path;
+    ScheduleStamp stamp;
+    unsigned int stamped;
+    atomic_size_t published;
+    atomic_uint done, cancel;
+};
+
+static void* stream_worker(void* arg) {
+    ScheduleStream* stream = (ScheduleStream*) arg;
+    SkedJob* job = &(stream->job);
+    size_t batch = pool_thread_count();
+    while(job->chunk_next < job->chunk_count && !atomic_load(&(stream->cancel))) {
+        SkedJob_advance(job, job->chunk_next + batch);
+        atomic_store(&(stream->published), job->merged_scans);
+    }
+#ifndef NO_SKD_CACHE
+    if(stream->stamped && !atomic_load(&(stream->cancel))) {
+        stream->snapshot.scans = job->scans;
+        stream->snapshot.scan_count = job->merged_scans;
+        stream->snapshot.skipped_lines = job->skipped;
+        stream->snapshot.skipped_count = job->skipped_count;
+        // the Schedule's arena isn't thread-safe, so the image's scan index is built in one of its own
+        stream->snapshot.arena = Arena_create(SCHEDULE_ARENA_BYTES);
+        if(stream->snapshot.arena != NULL && !Schedule_index_scans(&(stream->snapshot))) {
+            ScheduleCache_write(stream->snapshot, stream->path, stream->stamp);
+        }
+        Arena_release(stream->snapshot.arena);
+    }
+#endif
+    atomic_store(&(stream->done), 1);
+    return NULL;
+}
+
+static void stream_finish(Schedule* skd) {
+    ScheduleStream* stream = skd->stream;
+    pthread_join(stream->thread, NULL);
+    SkedJob_shrink(&(stream->job));
+    SkedJob_finish(&(stream->job), skd);
+    SkedJob_free(&(stream->job));
+    // a cancelled stream is only finished to be freed
+    unsigned int cancelled = atomic_load(&(stream->cancel));
+    free(stream->snapshot.sections);
+    free(stream->path);
+    free(stream);
+    skd->stream = NULL;
+    // the scans are complete either way, they can still be walked one by one without their index
+    if(!cancelled) Schedule_index_scans(skd);
+}
+
+unsigned int Schedule_build_streaming(Schedule* skd, const char* path) {
+    ScheduleStamp stamp;
+    unsigned int stamped;
+    switch(Schedule_open(skd, path, NULL, &stamp, &stamped)) {
+        case OPEN_FAILED: return 2;
+        case OPEN_CACHED: return 0;
+        case OPEN_TEXT: break;
+        // scans are already parsed as the archive is decoded
+        case OPEN_ARCHIVE: return Schedule_build_from_archive(skd, path);
+    }
+    unsigned int failure = Schedule_build_from_text(skd, 1);
+    if(failure) {
+        Schedule_free(*skd);
+        return failure;
+    }
+    ScheduleStream* stream = (ScheduleStream*) calloc(1, sizeof(ScheduleStream));
+    Section* section = (Section*) Schedule_get_section(*skd, "$SKED");
+    if(stream == NULL) {
+        LOG_ERROR("Unable to allocate schedule stream.");
+        Schedule_free(*skd);
+        return 1;
+    }
+    size_t chunk_count = (section->end - section->beg) / SKED_STREAM_CHUNK_BYTES;
+    if(chunk_count < pool_thread_count()) chunk_count = pool_thread_count();
+    failure = SkedJob_init(&(stream->job), skd, skd->arena,
+        skd->src + section->beg, skd->src + section->end, chunk_count);
+    if(failure) {
+        free(stream);
+        Schedule_free(*skd);
+        return 1;
+    }
+    // the section is claimed by the stream, so it must never be parsed again
+    section->parsed = 1;
+    skd->scans = stream->job.scans;
+    skd->scan_count = 0;
+    stream->stamp = stamp;
+    stream->stamped = stamped;
+    stream->path = strdup(path);
+    stream->snapshot = *skd;
+    stream->snapshot.sections = (Section*) malloc(skd->section_count * sizeof(Section));
+    if(stream->path == NULL || stream->snapshot.sections == NULL) stream->stamped = 0;
+    else memcpy(stream->snapshot.sections, skd->sections, skd->section_count * sizeof(Section));
+    atomic_init(&(stream->published), 0);
+    atomic_init(&(stream->done), 0);
+    atomic_init(&(stream->cancel), 0);
+    skd->stream = stream;
+    if(pthread_create(&(stream->thread), NULL, stream_worker, stream) != 0) {
+        LOG_INFO("Unable to spawn schedule stream. Parsing scans up front.");
+        stream_worker(stream);
+        skd->stream = NULL;
+        SkedJob_shrink(&(stream->job));
+        SkedJob_finish(&(stream->job), skd);
+        SkedJob_free(&(stream->job));
+        free(stream->snapshot.sections);
+        free(stream->path);
+        free(stream);
+        Schedule_index_scans(skd);
+    }
+    return 0;
+}
+
+unsigned int Schedule_poll(Schedule* skd) {
+    if(skd->stream == NULL) return 0;
+    skd->scan_count = atomic_load(&(skd->stream->published));
+    if(!atomic_load(&(skd->stream->done))) return 1;
+    stream_finish(skd);
+    return 0;
+}
+
+// length of the longest common prefix, compared a block at a time
+#define RELOAD_COMPARE_BLOCK 4096
+static size_t common_prefix(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    while(i + RELOAD_COMPARE_BLOCK <= len && memcmp(a + i, b + i, RELOAD_COMPARE_BLOCK) == 0) i += RELOAD_COMPARE_BLOCK;
+    while(i < len && a[i] == b[i]) ++i;
+    return i;
+}
+
+// length of the longest common suffix of the ranges ending at a_end and b_end
+static size_t common_suffix(const char* a_end, const char* b_end, size_t len) {
+    size_t i = 0;
+    while(i + RELOAD_COMPARE_BLOCK <= len && \
+        memcmp(a_end - i - RELOAD_COMPARE_BLOCK, b_end - i - RELOAD_COMPARE_BLOCK, RELOAD_COMPARE_BLOCK) == 0) i += RELOAD_COMPARE_BLOCK;
+    while(i < len && *(a_end - i - 1) == *(b_end - i - 1)) ++i;
+    return i;
+}
+
+#define IS_LINE_START(str, i) ((i) == 0 || (str)[(i) - 1] == '\n')
+
+static unsigned int section_matches(Schedule fst, const Section* fst_section, Schedule snd, const Section* snd_section) {
+    size_t len = fst_section->end - fst_section->beg;
+    if(len != snd_section->end - snd_section->beg) return 0;
+    return memcmp(fst.src + fst_section->beg, snd.src + snd_section->beg, len) == 0;
+}
+
+// number of skipped lines before line
+static size_t skipped_before(Schedule skd, size_t line) {
+    size_t lo = 0, hi = skd.skipped_count, mid;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(skd.skipped_lines[mid] < line) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// kept scans refer to stations by their old index, which is mapped onto the re-parsed table through its key
+static void map_stations(Schedule skd, Schedule next, uint16_t station_map[]) {
+    uint32_t* idx;
+    for(size_t i = 0; i < skd.station_count; ++i) {
+        idx = (uint32_t*) HashMap_get(next.stations_ant, skd.stations[i].key);
+        station_map[i] = (idx == NULL) ? STATION_NONE : (uint16_t) *idx;
+    }
+}
+
+// a kept scan named its source by either the IAU or the common name
+// returns 1 if those two names now resolve to different sources, since the scan can't be mapped then
+static unsigned int map_sources(Schedule skd, Schedule next, uint32_t source_map[]) {
+    uint32_t by_iau, by_name;
+    for(size_t i = 0; i < skd.source_count; ++i) {
+        by_iau = resolve_source(next.sources_iau, next.sources_alias, skd.sources[i].iau);
+        by_name = by_iau;
+        if(skd.sources[i].point.name[0] != '\0') {
+            by_name = resolve_source(next.sources_iau, next.sources_alias, skd.sources[i].point.name);
+        }
+        if(by_iau != by_name) return 1;
+        source_map[i] = by_iau;
+    }
+    return 0;
+}
+
+static inline uint16_t map_station(Schedule skd, const uint16_t* station_map, uint16_t station) {
+    return (station < skd.station_count) ? station_map[station] : STATION_NONE;
+}
+
+static inline uint32_t map_source(Schedule skd, const uint32_t* source_map, uint32_t source) {
+    return (source < skd.source_count) ? source_map[source] : SOURCE_NONE;
+}
+
+// validates the scans in [beg, end) against next's tables, as they'll be once they're mapped
+// a NULL map means that table didn't change
+static unsigned int validate_remapped(Schedule skd, size_t beg, size_t end, Schedule next, const uint16_t* station_map, const uint32_t* source_map) {
+    const ScanTable* scans = &(skd.scans);
+    uint16_t station;
+    size_t i, j;
+    for(i = beg; source_map != NULL && i < end; ++i) {
+        if(map_source(skd, source_map, scans->source[i]) >= next.source_count) {
+            LOG_INFO("Observed source is missing corresponding $SOURCES entry.");
+            return 1;
+        }
+    }
+    for(j = scans->station_beg[beg]; station_map != NULL && j < scans->station_beg[end]; ++j) {
+        station = map_station(skd, station_map, scans->stations[j]);
+        if(station >= next.station_count || next.stations[station].pos.name[0] == '\0') {
+            LOG_INFO("Antenna key in observation lacks matching $STATIONS entry.");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// points the scans in [beg, end) of scans at the re-parsed tables, skd must still hold the old ones
+static void remap_scans(Schedule skd, ScanTable* scans, size_t beg, size_t end, const uint16_t* station_map, const uint32_t* source_map) {
+    size_t i, j;
+    for(i = beg; source_map != NULL && i < end; ++i) scans->source[i] = map_source(skd, source_map, scans->source[i]);
+    if(station_map == NULL) return;
+    for(j = scans->station_beg[beg]; j < scans->station_beg[end]; ++j) {
+        scans->stations[j] = map_station(skd, station_map, scans->stations[j]);
+    }
+    for(i = beg; i < end; ++i) ScanTable_fill_set(scans, i);
+}
+
+// the tables of an unchanged section are copied into next's arena, which needs their names indexed again
+static unsigned int keep_stations(Schedule* next, Schedule skd) {
+    next->stations = (Station*) Arena_alloc(next->arena, (skd.station_count + 1) * sizeof(Station));
+    if(next->stations == NULL) {
+        LOG_ERROR("Unable to allocate station table.");
+        return 1;
+    }
+    memcpy(next->stations, skd.stations, skd.station_count * sizeof(Station));
+    next->station_count = skd.station_count;
+    if(index_stations(next)) {
+        LOG_ERROR("Unable to index stations.");
+        return 1;
+    }
+    return 0;
+}
+
+static unsigned int keep_sources(Schedule* next, Schedule skd) {
+    next->sources = (Source*) Arena_alloc(next->arena, (skd.source_count + 1) * sizeof(Source));
+    if(next->sources == NULL) {
+        LOG_ERROR("Unable to allocate source table.");
+        return 1;
+    }
+    memcpy(next->sources, skd.sources, skd.source_count * sizeof(Source));
+    next->source_count = skd.source_count;
+    if(index_sources(next)) {
+        LOG_ERROR("Unable to index sources.");
+        return 1;
+    }
+    return 0;
+}
+
+// frees everything Schedule_reload built for next before it could be swapped in
+static void discard_reload(Schedule* next, SkedJob* job, Arena* scratch) {
+    if(job != NULL) free(job->skipped);
+    Arena_release(scratch);
+    Arena_release(next->arena);
+    free(next->src);
+}
+
+// compressed schedules don't keep the $SKED text a diff needs, so they're replaced as a whole
+static unsigned int Schedule_reload_archive(Schedule* skd, const char* path, ScheduleDiff* diff) {
+    Schedule next;
+    unsigned int failure = Schedule_build_from_archive(&next, path);
+    if(failure) return failure;
+    if(Schedule_debug_and_validate(next, 0)) {
+        LOG_ERROR("Reloaded schedule contained references to sources/stations which were undefined.");
+        Schedule_free(next);
+        return 1;
+    }
+    *diff = (ScheduleDiff) { .first = 0, .removed = skd->scan_count, .added = next.scan_count, .stations = 1, .sources = 1 };
+    Schedule_free(*skd);
+    *skd = next;
+    return 0;
+}
+
+unsigned int Schedule_reload(Schedule* skd, const char* path, ScheduleDiff* diff) {
+    if(skd->stream != NULL) {
+        LOG_ERROR("Schedule can't be reloaded while it's still streaming.");
+        return 1;
+    }
+    memset(diff, 0, sizeof(ScheduleDiff));
+    ArchiveFormat format;
+    if(archive_format(path, &format)) {
+        LOG_ERROR("Schedule couldn't be opened.");
+        return 2;
+    }
+    if(format != ARCHIVE_PLAIN) return Schedule_reload_archive(skd, path, diff);
+    // next is built in an arena of its own, the old schedule is released as a whole once it's swapped in
+    Schedule next = *skd;
+    next.src = (char*) read_file_contents(path);
+    if(next.src == NULL) {
+        LOG_ERROR("Schedule couldn't be opened.");
+        return 2;
+    }
+    next.src_len = strlen(next.src);
+    next.image = (ScheduleImage) { .addr = NULL, .len = 0 };
+    next.arena = Arena_create(SCHEDULE_ARENA_BYTES);
+    if(next.arena == NULL) {
+        LOG_ERROR("Unable to allocate schedule arena.");
+        free(next.src);
+        return 1;
+    }
+    next.sections = NULL;
+    if(build_section_table(&next)) {
+        discard_reload(&next, NULL, NULL);
+        return 1;
+    }
+    const Section* old_section[3];
+    const Section* new_section[3];
+    size_t i;
+    for(i = 0; i < 3; ++i) {
+        old_section[i] = Schedule_get_section(*skd, SectionParsers[i].name);
+        new_section[i] = Schedule_get_section(next, SectionParsers[i].name);
+        if(old_section[i] == NULL || new_section[i] == NULL) {
+            LOG_ERROR("Schedule is missing a required section.");
+            discard_reload(&next, NULL, NULL);
+            return 1;
+        }
+    }
+    // unchanged sections keep the tables they were parsed into
+    diff->stations = !section_matches(*skd, old_section[0], next, new_section[0]);
+    diff->sources = !section_matches(*skd, old_section[1], next, new_section[1]);
+    unsigned int failure = init_names(&next);
+    failure = failure || (diff->stations ? \
+        parse_section_stations(&next, next.src + new_section[0]->beg, next.src + new_section[0]->end) : keep_stations(&next, *skd));
+    failure = failure || (diff->sources ? \
+        parse_section_sources(&next, next.src + new_section[1]->beg, next.src + new_section[1]->end) : keep_sources(&next, *skd));
+    if(failure) {
+        discard_reload(&next, NULL, NULL);
+        return 1;
+    }
+    // kept scans are pointed at the re-parsed tables
+    // every scan is re-parsed if the skipped lines are unknown or a source can't be mapped
+    uint16_t station_map[STATION_COUNT_MAX];
+    uint32_t* source_map = NULL;
+    unsigned int reparse_all = skd->skipped_count == SIZE_MAX;
+    if(!reparse_all && diff->stations) map_stations(*skd, next, station_map);
+    if(!reparse_all && diff->sources) {
+        source_map = (uint32_t*) malloc((skd->source_count + 1) * sizeof(uint32_t));
+        if(source_map == NULL) {
+            LOG_ERROR("Unable to allocate source map.");
+            discard_reload(&next, NULL, NULL);
+            return 1;
+        }
+        reparse_all = map_sources(*skd, next, source_map);
+    }
+    // find the lines of $SKED which changed
+    const char* old_beg = skd->src + old_section[2]->beg;
+    const char* new_beg = next.src + new_section[2]->beg;
+    size_t old_len = old_section[2]->end - old_section[2]->beg;
+    size_t new_len = new_section[2]->end - new_section[2]->beg;
+    size_t prefix = 0, suffix = 0;
+    if(!reparse_all) {
+        prefix = common_prefix(old_beg, new_beg, (old_len < new_len) ? old_len : new_len);
+        while(prefix > 0 && old_beg[prefix - 1] != '\n') prefix--;
+        suffix = common_suffix(old_beg + old_len, new_beg + new_len, ((old_len < new_len) ? old_len : new_len) - prefix);
+        while(suffix > 0 && !(IS_LINE_START(old_beg, old_len - suffix) && IS_LINE_START(new_beg, new_len - suffix))) suffix--;
+    }
+    size_t prefix_lines = count_lines(old_beg, old_beg + prefix);
+    size_t old_lines = count_lines(old_beg + prefix, old_beg + old_len - suffix);
+    // changed lines are parsed into a scratch arena when the kept scans are spliced around them
+    SkedJob job;
+    Arena* scratch = NULL;
+    if(!reparse_all) {
+        scratch = Arena_create(SCHEDULE_ARENA_BYTES);
+        if(scratch == NULL) {
+            LOG_ERROR("Unable to allocate scan buffer.");
+            free(source_map);
+            discard_reload(&next, NULL, NULL);
+            return 1;
+        }
+    }
+    if(SkedJob_run(&job, &next, reparse_all ? next.arena : scratch, new_beg + prefix, new_beg + new_len - suffix)) {
+        free(source_map);
+        discard_reload(&next, NULL, scratch);
+        return 1;
+    }
+    size_t new_lines = count_lines(new_beg + prefix, new_beg + new_len - suffix);
+    // map the changed lines onto the scans they produced
+    size_t skipped_lo = 0, skipped_hi = 0;
+    if(!reparse_all) {
+        skipped_lo = skipped_before(*skd, prefix_lines);
+        skipped_hi = skipped_before(*skd, prefix_lines + old_lines);
+    }
+    diff->first = prefix_lines - skipped_lo;
+    diff->removed = reparse_all ? skd->scan_count : old_lines - (skipped_hi - skipped_lo);
+    diff->added = job.merged_scans;
+    // validate before anything is replaced
+    // kept scans only need to be checked again if the stations or sources they refer to changed
+    Schedule view = next;
+    view.scans = job.scans;
+    view.scan_count = job.merged_scans;
+    const uint16_t* kept_stations = (!reparse_all && diff->stations) ? station_map : NULL;
+    failure = Schedule_debug_and_validate(view, 0);
+    if(!failure && !reparse_all && (diff->stations || diff->sources)) {
+        failure = validate_remapped(*skd, 0, diff->first, next, kept_stations, source_map) || \
+            validate_remapped(*skd, diff->first + diff->removed, skd->scan_count, next, kept_stations, source_map);
+    }
+    if(failure) {
+        LOG_ERROR("Reloaded schedule contained references to sources/stations which were undefined.");
+        free(source_map);
+        discard_reload(&next, &job, scratch);
+        return 1;
+    }
+    // skipped lines after the change are shifted by the difference in line count
+    size_t skipped_tail = reparse_all ? 0 : skd->skipped_count - skipped_hi;
+    size_t* skipped = NULL;
+    if(job.skipped_count != SIZE_MAX) {
+        skipped = (size_t*) Arena_alloc(next.arena, (skipped_lo + job.skipped_count + skipped_tail + 1) * sizeof(size_t));
+        if(skipped == NULL) {
+            LOG_ERROR("Unable to allocate skipped line table.");
+            free(source_map);
+            discard_reload(&next, &job, scratch);
+            return 1;
+        }
+        if(skipped_lo > 0) memcpy(skipped, skd->skipped_lines, skipped_lo * sizeof(size_t));
+        for(i = 0; i < job.skipped_count; ++i) skipped[skipped_lo + i] = job.skipped[i] + prefix_lines;
+        for(i = 0; i < skipped_tail; ++i) {
+            skipped[skipped_lo + job.skipped_count + i] = skd->skipped_lines[skipped_hi + i] - old_lines + new_lines;
+        }
+    }
+    // splice the new scans in place of the removed ones
+    // the kept scans are copied around them, which also moves them out of a compiled image
+    size_t scan_count = skd->scan_count - diff->removed + diff->added;
+    ScanTable scans = job.scans;
+    if(!reparse_all) {
+        const uint32_t* station_beg = skd->scans.station_beg;
+        size_t member_count = station_beg[skd->scan_count] - station_beg[diff->first + diff->removed] + \
+            station_beg[diff->first] + job.scans.station_beg[diff->added];
+        if(ScanTable_alloc(next.arena, &scans, scan_count, member_count, STATION_SET_WORDS(next.station_count))) {
+            LOG_ERROR("Unable to allocate scan buffer.");
+            free(source_map);
+            discard_reload(&next, &job, scratch);
+            return 1;
+        }
+        ScanTable_copy(&scans, 0, skd->scans, 0, diff->first);
+        ScanTable_copy(&scans, diff->first, job.scans, 0, diff->added);
+        ScanTable_copy(&scans, diff->first + diff->added, skd->scans, diff->first + diff->removed, skd->scan_count);
+        remap_scans(*skd, &scans, 0, diff->first, kept_stations, source_map);
+        remap_scans(*skd, &scans, diff->first + diff->added, scan_count, kept_stations, source_map);
+    }
+    free(source_map);
+    free(job.skipped);
+    Arena_release(scratch);
+    next.scans = scans;
+    next.scan_count = scan_count;
+    next.skipped_lines = skipped;
+    next.skipped_count = (skipped == NULL) ? SIZE_MAX : skipped_lo + job.skipped_count + skipped_tail;
+    if(Schedule_index_scans(&next)) {
+        discard_reload(&next, NULL, NULL);
+        return 1;
+    }
+    mark_eager_sections(&next);
+    // the kept scans were copied out of the old schedule, including a compiled image
+    Schedule_free(*skd);
+    *skd = next;
+    return 0;
+}
+
+void Schedule_free(Schedule skd) {
+    // stop streaming before tearing down the scans it writes to
+    if(skd.stream != NULL) {
+        atomic_store(&(skd.stream->cancel), 1);
+        stream_finish(&skd);
+    }
+    // scans live inside the mapped compiled schedule if there is one
+    ScheduleCache_release(skd.image);
+    Arena_release(skd.arena);
+    free(skd.src);
+}
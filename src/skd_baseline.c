@@ -0,0 +1,135 @@
+#include "skd_baseline.h"
+#include <stdlib.h>
+#include <string.h>
+#include "skd.h"
+#include "util/log.h"
+#include "pool.h"
+
+// scans are split into this many chunks per thread, so a slow chunk doesn't hold up the rest
+#define BASELINE_CHUNKS_PER_THREAD 2
+
+// every chunk counts its scans of each pair, then writes them from its own cursor
+// cursors are laid out chunk by chunk, pair_count per chunk
+typedef struct {
+    Schedule skd;
+    BaselineIndex* index;
+    size_t chunk_count;
+    uint32_t* cursor;
+} BaselineJob;
+
+// distinct stations of scan i with their offsets, in the order they're listed
+static size_t scan_members(const Schedule* skd, size_t i, uint16_t stations[], uint32_t offsets[]) {
+    uint64_t seen[STATION_SET_WORDS_MAX] = {0,};
+    size_t j, count = 0;
+    uint16_t station;
+    for(j = skd->scans.station_beg[i]; j < skd->scans.station_beg[i + 1]; ++j) {
+        station = skd->scans.stations[j];
+        if(station >= skd->station_count) continue;
+        if(seen[station / STATION_SET_WORD_BITS] & ((uint64_t) 1 << (station % STATION_SET_WORD_BITS))) continue;
+        seen[station / STATION_SET_WORD_BITS] |= (uint64_t) 1 << (station % STATION_SET_WORD_BITS);
+        stations[count] = station;
+        offsets[count] = skd->scans.offsets[j];
+        count++;
+    }
+    return count;
+}
+
+static void baseline_chunk(BaselineJob* job, size_t chunk, unsigned int fill) {
+    const Schedule* skd = &(job->skd);
+    BaselineIndex* index = job->index;
+    uint32_t* cursor = &(job->cursor[chunk * index->pair_count]);
+    uint16_t stations[STATION_COUNT_MAX];
+    uint32_t offsets[STATION_COUNT_MAX];
+    size_t i, a, b, pair, count;
+    size_t beg = chunk * skd->scan_count / job->chunk_count;
+    size_t end = (chunk + 1) * skd->scan_count / job->chunk_count;
+    for(i = beg; i < end; ++i) {
+        count = scan_members(skd, i, stations, offsets);
+        for(a = 0; a < count; ++a) for(b = a + 1; b < count; ++b) {
+            pair = (stations[a] < stations[b]) ? \
+                BASELINE_PAIR(stations[a], stations[b], index->station_count) : \
+                BASELINE_PAIR(stations[b], stations[a], index->station_count);
+            if(!fill) {
+                cursor[pair]++;
+                continue;
+            }
+            // the baseline ends once the first of its stations stops
+            index->scans[cursor[pair]] = (uint32_t) i;
+            index->seconds[cursor[pair]] = (offsets[a] < offsets[b]) ? offsets[a] : offsets[b];
+            cursor[pair]++;
+        }
+    }
+}
+
+static void count_chunk(void* ctx, size_t chunk) {
+    baseline_chunk((BaselineJob*) ctx, chunk, 0);
+}
+
+static void fill_chunk(void* ctx, size_t chunk) {
+    baseline_chunk((BaselineJob*) ctx, chunk, 1);
+}
+
+unsigned int BaselineIndex_build(BaselineIndex* index, Schedule skd) {
+    memset(index, 0, sizeof(BaselineIndex));
+    index->station_count = skd.station_count;
+    index->pair_count = (skd.station_count < 2) ? 0 : skd.station_count * (skd.station_count - 1) / 2;
+    BaselineJob job = { .skd = skd, .index = index };
+    job.chunk_count = pool_thread_count() * BASELINE_CHUNKS_PER_THREAD;
+    if(job.chunk_count > skd.scan_count) job.chunk_count = skd.scan_count;
+    if(job.chunk_count == 0) job.chunk_count = 1;
+    job.cursor = (uint32_t*) calloc(job.chunk_count * index->pair_count + 1, sizeof(uint32_t));
+    index->pair_beg = (uint32_t*) malloc((index->pair_count + 1) * sizeof(uint32_t));
+    if(job.cursor == NULL || index->pair_beg == NULL) {
+        LOG_ERROR("Unable to allocate baseline index.");
+        free(job.cursor);
+        BaselineIndex_free(*index);
+        return 1;
+    }
+    pool_run(job.chunk_count, count_chunk, &job);
+    // each chunk's share of a pair follows the previous chunk's, so every pair lists its scans in schedule order
+    size_t pair, chunk, total = 0, count;
+    uint32_t* cursor;
+    for(pair = 0; pair < index->pair_count; ++pair) {
+        index->pair_beg[pair] = (uint32_t) total;
+        for(chunk = 0; chunk < job.chunk_count; ++chunk) {
+            cursor = &(job.cursor[chunk * index->pair_count + pair]);
+            count = *cursor;
+            *cursor = (uint32_t) total;
+            total += count;
+        }
+        if(total > UINT32_MAX) {
+            LOG_ERROR("Schedule has too many baselines to index.");
+            free(job.cursor);
+            BaselineIndex_free(*index);
+            return 1;
+        }
+    }
+    index->pair_beg[index->pair_count] = (uint32_t) total;
+    index->scans = (uint32_t*) malloc((total + 1) * sizeof(uint32_t));
+    index->seconds = (uint32_t*) malloc((total + 1) * sizeof(uint32_t));
+    if(index->scans == NULL || index->seconds == NULL) {
+        LOG_ERROR("Unable to allocate baseline index.");
+        free(job.cursor);
+        BaselineIndex_free(*index);
+        return 1;
+    }
+    pool_run(job.chunk_count, fill_chunk, &job);
+    free(job.cursor);
+    return 0;
+}
+
+size_t BaselineIndex_scans(BaselineIndex index, size_t a, size_t b, const uint32_t** scans, const uint32_t** seconds) {
+    *scans = NULL;
+    *seconds = NULL;
+    if(a == b || a >= index.station_count || b >= index.station_count) return 0;
+    size_t pair = (a < b) ? BASELINE_PAIR(a, b, index.station_count) : BASELINE_PAIR(b, a, index.station_count);
+    *scans = &(index.scans[index.pair_beg[pair]]);
+    *seconds = &(index.seconds[index.pair_beg[pair]]);
+    return index.pair_beg[pair + 1] - index.pair_beg[pair];
+}
+
+void BaselineIndex_free(BaselineIndex index) {
+    free(index.pair_beg);
+    free(index.scans);
+    free(index.seconds);
+}
@@ -0,0 +1,191 @@
+#include "skd_bulk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "skd.h"
+#include "util/log.h"
+#include "util/fio.h"
+#include "util/archive.h"
+#include "pool.h"
+
+typedef struct {
+    // contents of a plain schedule, read ahead on the reader thread
+    char* src;
+    // bytes counted against the memory cap for this schedule
+    size_t charge;
+    Schedule skd;
+    unsigned int failure;
+} BulkItem;
+
+// every schedule passes through the read queue to a worker, then through the parsed queue to the callback
+// both queues hold item indices and each index enters them exactly once, so they never wrap
+typedef struct {
+    const char* const* paths;
+    size_t path_count;
+    BulkItem* items;
+    size_t* read;
+    size_t read_head, read_tail;
+    size_t* parsed;
+    size_t parsed_head, parsed_tail;
+    size_t memory_cap, memory_used;
+    unsigned int reader_done;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} BulkLoad;
+
+static void* bulk_reader(void* arg) {
+    BulkLoad* load = (BulkLoad*) arg;
+    BulkItem* item;
+    struct stat info;
+    ArchiveFormat format;
+    for(size_t i = 0; i < load->path_count; ++i) {
+        item = &(load->items[i]);
+        item->charge = (stat(load->paths[i], &info) == 0) ? (size_t) info.st_size : 0;
+        // a schedule larger than the cap is still read once nothing else is held
+        pthread_mutex_lock(&(load->lock));
+        while(load->memory_used > 0 && load->memory_used + item->charge > load->memory_cap) {
+            pthread_cond_wait(&(load->changed), &(load->lock));
+        }
+        load->memory_used += item->charge;
+        pthread_mutex_unlock(&(load->lock));
+        // compressed schedules are decoded as they're parsed, so their workers read them instead
+        if(archive_format(load->paths[i], &format)) item->failure = 2;
+        else if(format == ARCHIVE_PLAIN) {
+            item->src = (char*) read_file_contents(load->paths[i]);
+            if(item->src == NULL) item->failure = 2;
+        }
+        pthread_mutex_lock(&(load->lock));
+        load->read[(load->read_tail)++] = i;
+        pthread_cond_broadcast(&(load->changed));
+        pthread_mutex_unlock(&(load->lock));
+    }
+    pthread_mutex_lock(&(load->lock));
+    load->reader_done = 1;
+    pthread_cond_broadcast(&(load->changed));
+    pthread_mutex_unlock(&(load->lock));
+    return NULL;
+}
+
+// what a built schedule holds: its tables, its source text and the compiled image they may be mapped from
+static size_t bulk_footprint(Schedule skd) {
+    return Arena_bytes(skd.arena) + skd.src_len + 1 + skd.image.len;
+}
+
+// the file size charged while reading is only an estimate, compressed schedules grow several times once decoded
+// so the charge is replaced by what the schedule actually holds
+static void bulk_recharge(BulkLoad* load, BulkItem* item, size_t charge) {
+    pthread_mutex_lock(&(load->lock));
+    load->memory_used = load->memory_used - item->charge + charge;
+    item->charge = charge;
+    pthread_cond_broadcast(&(load->changed));
+    pthread_mutex_unlock(&(load->lock));
+}
+
+static void bulk_build(BulkLoad* load, size_t i) {
+    BulkItem* item = &(load->items[i]);
+    if(item->failure) {
+        bulk_recharge(load, item, 0);
+        return;
+    }
+    if(item->src == NULL) item->failure = Schedule_build_from_source(&(item->skd), load->paths[i]);
+    else item->failure = Schedule_build_from_memory(&(item->skd), load->paths[i], item->src);
+    // src belongs to the Schedule now, or was freed with it
+    item->src = NULL;
+    if(!(item->failure) && Schedule_debug_and_validate(item->skd, 0)) {
+        LOG_ERROR("Schedule contained references to sources/stations which were undefined.");
+        Schedule_free(item->skd);
+        item->failure = 1;
+    }
+    bulk_recharge(load, item, item->failure ? 0 : bulk_footprint(item->skd));
+}
+
+static void* bulk_worker(void* arg) {
+    BulkLoad* load = (BulkLoad*) arg;
+    size_t i;
+    for(;;) {
+        pthread_mutex_lock(&(load->lock));
+        while(load->read_head == load->read_tail && !(load->reader_done)) pthread_cond_wait(&(load->changed), &(load->lock));
+        if(load->read_head == load->read_tail) {
+            pthread_mutex_unlock(&(load->lock));
+            break;
+        }
+        i = load->read[(load->read_head)++];
+        pthread_mutex_unlock(&(load->lock));
+        bulk_build(load, i);
+        pthread_mutex_lock(&(load->lock));
+        load->parsed[(load->parsed_tail)++] = i;
+        pthread_cond_broadcast(&(load->changed));
+        pthread_mutex_unlock(&(load->lock));
+    }
+    return NULL;
+}
+
+static void bulk_deliver(BulkLoad* load, size_t i, ScheduleBulkCallback callback, void* ctx) {
+    BulkItem* item = &(load->items[i]);
+    callback(ctx, i, load->paths[i], item->failure ? NULL : &(item->skd), item->failure);
+}
+
+unsigned int Schedule_build_bulk(const char* const* paths, size_t path_count, ScheduleBulkConfig config, ScheduleBulkCallback callback, void* ctx) {
+    if(path_count == 0) return 0;
+    BulkLoad load;
+    memset(&load, 0, sizeof(BulkLoad));
+    load.paths = paths;
+    load.path_count = path_count;
+    load.memory_cap = (config.memory_cap == 0) ? SIZE_MAX : config.memory_cap;
+    load.items = (BulkItem*) calloc(path_count, sizeof(BulkItem));
+    load.read = (size_t*) malloc(path_count * sizeof(size_t));
+    load.parsed = (size_t*) malloc(path_count * sizeof(size_t));
+    if(load.items == NULL || load.read == NULL || load.parsed == NULL) {
+        LOG_ERROR("Unable to allocate bulk loader.");
+        free(load.items);
+        free(load.read);
+        free(load.parsed);
+        return 1;
+    }
+    pthread_mutex_init(&(load.lock), NULL);
+    pthread_cond_init(&(load.changed), NULL);
+    size_t i, spawned = 0, worker_count = (config.worker_count == 0) ? pool_thread_count() : config.worker_count;
+    if(worker_count > POOL_THREAD_MAX) worker_count = POOL_THREAD_MAX;
+    if(worker_count > path_count) worker_count = path_count;
+    pthread_t reader, workers[POOL_THREAD_MAX];
+    for(i = 0; i < worker_count; ++i) {
+        if(pthread_create(&(workers[spawned]), NULL, bulk_worker, &load) == 0) spawned++;
+        else LOG_INFO("Failed to spawn bulk loader worker. Continuing with fewer threads.");
+    }
+    unsigned int reading = spawned > 0 && pthread_create(&reader, NULL, bulk_reader, &load) == 0;
+    if(reading) {
+        for(size_t delivered = 0; delivered < path_count; ++delivered) {
+            pthread_mutex_lock(&(load.lock));
+            while(load.parsed_head == load.parsed_tail) pthread_cond_wait(&(load.changed), &(load.lock));
+            i = load.parsed[(load.parsed_head)++];
+            pthread_mutex_unlock(&(load.lock));
+            bulk_deliver(&load, i, callback, ctx);
+            pthread_mutex_lock(&(load.lock));
+            load.memory_used -= load.items[i].charge;
+            pthread_cond_broadcast(&(load.changed));
+            pthread_mutex_unlock(&(load.lock));
+        }
+        pthread_join(reader, NULL);
+    } else {
+        // release any workers, then load everything in order on this thread
+        LOG_INFO("Unable to spawn bulk loader threads. Loading schedules one at a time.");
+        pthread_mutex_lock(&(load.lock));
+        load.reader_done = 1;
+        pthread_cond_broadcast(&(load.changed));
+        pthread_mutex_unlock(&(load.lock));
+    }
+    for(i = 0; i < spawned; ++i) pthread_join(workers[i], NULL);
+    for(i = 0; !reading && i < path_count; ++i) {
+        bulk_build(&load, i);
+        bulk_deliver(&load, i, callback, ctx);
+    }
+    pthread_cond_destroy(&(load.changed));
+    pthread_mutex_destroy(&(load.lock));
+    free(load.items);
+    free(load.read);
+    free(load.parsed);
+    return 0;
+}
@@ -0,0 +1,384 @@
+#include "skd_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "skd.h"
+#include "util/log.h"
+#include "util/hashmap.h"
+
+// bump SKDB_VERSION whenever the layout of any region changes
+#define SKDB_MAGIC "SKDB"
+#define SKDB_VERSION 10
+#define SKDB_BYTE_ORDER 0x01020304u
+#define SKDB_EXT ".skdb"
+#define SKDB_ALIGN 8
+
+// every region is addressed by its byte offset from the start of the image
+// each column of the ScanTable and each table of the ScanIndex is a region of its own
+typedef enum {
+    REGION_STATIONS,
+    REGION_SOURCES,
+    REGION_SECTIONS,
+    REGION_SCAN_TIMESTAMP,
+    REGION_SCAN_CAL_DURATION,
+    REGION_SCAN_OBS_DURATION,
+    REGION_SCAN_SOURCE,
+    REGION_SCAN_STATION_BEG,
+    REGION_SCAN_STATIONS,
+    REGION_SCAN_OFFSETS,
+    REGION_SCAN_STATION_SETS,
+    REGION_INDEX_STATION_BEG,
+    REGION_INDEX_STATION_SCANS,
+    REGION_INDEX_STATION_OFFSETS,
+    REGION_INDEX_SOURCE_BEG,
+    REGION_INDEX_SOURCE_SCANS,
+    REGION_SKIPPED,
+    REGION_COUNT
+} SkdbRegion;
+
+typedef struct {
+    char magic[4];
+    uint32_t version, byte_order;
+    ScheduleStamp stamp;
+    uint64_t count[REGION_COUNT];
+    uint64_t offset[REGION_COUNT];
+} SkdbHeader;
+
+// a Section as stored, without what was parsed from it
+typedef struct {
+    char name[16];
+    uint64_t head, beg, end;
+} SkdbSection;
+
+static const size_t SkdbRegionSize[REGION_COUNT] = {
+    sizeof(Station),
+    sizeof(Source),
+    sizeof(SkdbSection),
+    sizeof(TimeMs),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+    sizeof(uint16_t),
+    sizeof(uint32_t),
+    sizeof(uint64_t),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+    sizeof(uint64_t),
+};
+
+// FNV-1a over 8-byte words (the tail is folded in bytewise)
+// only used to detect changes, so word-at-a-time keeps hashing well below read time
+static uint64_t hash_contents(const char* src, size_t src_len) {
+    uint64_t hash = 0xcbf29ce484222325ULL, word;
+    size_t i;
+    for(i = 0; i + sizeof(uint64_t) <= src_len; i += sizeof(uint64_t)) {
+        memcpy(&word, &(src[i]), sizeof(uint64_t));
+        hash ^= word;
+        hash *= 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+    for(; i < src_len; ++i) {
+        hash ^= (uint64_t) (unsigned char) src[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+unsigned int ScheduleStamp_init(ScheduleStamp* stamp, const char* path, const char* src, size_t src_len) {
+    struct stat info;
+    if(stat(path, &info) != 0) {
+        LOG_INFO("Unable to stat schedule. Compiled schedule cache disabled.");
+        return 1;
+    }
+    memset(stamp, 0, sizeof(ScheduleStamp));
+    stamp->size = (uint64_t) info.st_size;
+    stamp->mtime_sec = (int64_t) info.st_mtim.tv_sec;
+    stamp->mtime_nsec = (int64_t) info.st_mtim.tv_nsec;
+    stamp->hash = hash_contents(src, src_len);
+    return 0;
+}
+
+static char* cache_path(const char* path) {
+    size_t len = strlen(path);
+    char* temp = (char*) malloc(len + sizeof(SKDB_EXT) + 8);
+    if(temp == NULL) return NULL;
+    memcpy(temp, path, len);
+    memcpy(&(temp[len]), SKDB_EXT, sizeof(SKDB_EXT));
+    return temp;
+}
+
+static inline size_t align_up(size_t offset) {
+    return (offset + SKDB_ALIGN - 1) & ~((size_t) SKDB_ALIGN - 1);
+}
+
+static unsigned int write_padding(FILE* stream, size_t* offset) {
+    static const char zeros[SKDB_ALIGN] = {0,};
+    size_t padding = align_up(*offset) - *offset;
+    *offset += padding;
+    return fwrite(zeros, 1, padding, stream) != padding;
+}
+
+static unsigned int write_sections(FILE* stream, Schedule skd) {
+    SkdbSection record;
+    for(size_t i = 0; i < skd.section_count; ++i) {
+        memset(&record, 0, sizeof(SkdbSection));
+        memcpy(record.name, skd.sections[i].name, sizeof(record.name));
+        record.head = skd.sections[i].head;
+        record.beg = skd.sections[i].beg;
+        record.end = skd.sections[i].end;
+        if(fwrite(&record, sizeof(SkdbSection), 1, stream) != 1) return 1;
+    }
+    return 0;
+}
+
+unsigned int ScheduleCache_write(Schedule skd, const char* path, ScheduleStamp stamp) {
+    // an image without its skipped lines couldn't be reloaded incrementally
+    if(skd.skipped_count == SIZE_MAX || skd.scan_index.station_beg == NULL) return 1;
+    char* path_image = cache_path(path);
+    char* path_temp = cache_path(path);
+    if(path_image == NULL || path_temp == NULL) {
+        LOG_INFO("Unable to allocate compiled schedule path.");
+        free(path_image);
+        free(path_temp);
+        return 1;
+    }
+    // the image is renamed into place once complete, so readers never see a partial file
+    // the temporary name is unique, so concurrent writers of the same image can't interleave
+    strcat(path_temp, ".XXXXXX");
+    int fd = mkstemp(path_temp);
+    FILE* stream = (fd < 0) ? NULL : fdopen(fd, "wb");
+    if(fd >= 0) fchmod(fd, 0644);
+    if(stream == NULL) {
+        if(fd >= 0) {
+            close(fd);
+            remove(path_temp);
+        }
+        LOG_INFO("Unable to create compiled schedule. Continuing without it.");
+        free(path_image);
+        free(path_temp);
+        return 1;
+    }
+    SkdbHeader header;
+    memset(&header, 0, sizeof(SkdbHeader));
+    memcpy(header.magic, SKDB_MAGIC, 4);
+    header.version = SKDB_VERSION;
+    header.byte_order = SKDB_BYTE_ORDER;
+    header.stamp = stamp;
+    size_t i, member_count = skd.scans.station_beg[skd.scan_count];
+    // everything but the skipped lines is stored as it is, the name lookups are rebuilt on load
+    const ScanIndex* index = &(skd.scan_index);
+    const void* region[REGION_COUNT] = {
+        skd.stations, skd.sources, NULL, 
+        skd.scans.timestamp, skd.scans.cal_duration, skd.scans.obs_duration, skd.scans.source, 
+        skd.scans.station_beg, skd.scans.stations, skd.scans.offsets, skd.scans.station_sets, 
+        index->station_beg, index->station_scans, index->station_offsets, index->source_beg, index->source_scans, 
+        NULL
+    };
+    header.count[REGION_STATIONS] = skd.station_count;
+    header.count[REGION_SOURCES] = skd.source_count;
+    header.count[REGION_SECTIONS] = skd.section_count;
+    for(i = REGION_SCAN_TIMESTAMP; i <= REGION_SCAN_SOURCE; ++i) header.count[i] = skd.scan_count;
+    header.count[REGION_SCAN_STATION_BEG] = skd.scan_count + 1;
+    header.count[REGION_SCAN_STATIONS] = member_count;
+    header.count[REGION_SCAN_OFFSETS] = member_count;
+    header.count[REGION_SCAN_STATION_SETS] = skd.scan_count * skd.scans.set_words;
+    header.count[REGION_INDEX_STATION_BEG] = skd.station_count + 1;
+    header.count[REGION_INDEX_STATION_SCANS] = index->station_beg[skd.station_count];
+    header.count[REGION_INDEX_STATION_OFFSETS] = index->station_beg[skd.station_count];
+    header.count[REGION_INDEX_SOURCE_BEG] = skd.source_count + 1;
+    header.count[REGION_INDEX_SOURCE_SCANS] = index->source_beg[skd.source_count];
+    header.count[REGION_SKIPPED] = skd.skipped_count;
+    size_t offset = align_up(sizeof(SkdbHeader));
+    for(i = 0; i < REGION_COUNT; ++i) {
+        header.offset[i] = offset;
+        offset += header.count[i] * SkdbRegionSize[i];
+        offset = align_up(offset);
+    }
+    unsigned int failure = fwrite(&header, sizeof(SkdbHeader), 1, stream) != 1;
+    offset = sizeof(SkdbHeader);
+    failure |= write_padding(stream, &offset);
+    for(i = 0; i < REGION_SKIPPED; ++i) {
+        if(i == REGION_SECTIONS) failure |= write_sections(stream, skd);
+        else failure |= fwrite(region[i], SkdbRegionSize[i], header.count[i], stream) != header.count[i];
+        offset += header.count[i] * SkdbRegionSize[i];
+        failure |= write_padding(stream, &offset);
+    }
+    uint64_t skipped;
+    for(i = 0; i < skd.skipped_count; ++i) {
+        skipped = (uint64_t) skd.skipped_lines[i];
+        failure |= fwrite(&skipped, sizeof(uint64_t), 1, stream) != 1;
+    }
+    failure |= fclose(stream) != 0;
+    if(!failure) failure = rename(path_temp, path_image) != 0;
+    if(failure) {
+        LOG_INFO("Failed to write compiled schedule. Continuing without it.");
+        remove(path_temp);
+    }
+    free(path_image);
+    free(path_temp);
+    return failure;
+}
+
+// checks that the list starts of a stored index are ordered and span its entry_count entries, which refer to scans
+static unsigned int index_within(const uint32_t* beg, size_t list_count, const uint32_t* entries, size_t entry_count, size_t scan_count) {
+    size_t i;
+    if(beg[0] != 0 || beg[list_count] != entry_count) return 0;
+    for(i = 0; i < list_count; ++i) if(beg[i + 1] < beg[i]) return 0;
+    for(i = 0; i < entry_count; ++i) if(entries[i] >= scan_count) return 0;
+    return 1;
+}
+
+unsigned int ScheduleCache_load(Schedule* skd, const char* path, ScheduleStamp stamp) {
+    char* path_image = cache_path(path);
+    if(path_image == NULL) return 1;
+    int fd = open(path_image, O_RDONLY);
+    free(path_image);
+    if(fd < 0) return 1;
+    struct stat info;
+    if(fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(SkdbHeader)) {
+        close(fd);
+        return 1;
+    }
+    size_t image_len = (size_t) info.st_size;
+    // the scan columns are used in place, a reload copies them out before changing anything
+    void* image = mmap(NULL, image_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(image == MAP_FAILED) return 1;
+    SkdbHeader* header = (SkdbHeader*) image;
+    unsigned int failure = \
+        memcmp(header->magic, SKDB_MAGIC, 4) != 0 || \
+        header->version != SKDB_VERSION || \
+        header->byte_order != SKDB_BYTE_ORDER || \
+        header->stamp.size != stamp.size || \
+        header->stamp.mtime_sec != stamp.mtime_sec || \
+        header->stamp.mtime_nsec != stamp.mtime_nsec || \
+        header->stamp.hash != stamp.hash || \
+        header->count[REGION_STATIONS] > STATION_COUNT_MAX || header->count[REGION_SOURCES] >= SOURCE_NONE;
+    size_t i;
+    for(i = 0; !failure && i < REGION_COUNT; ++i) {
+        failure = header->offset[i] % SKDB_ALIGN != 0 || header->offset[i] > image_len || \
+            header->count[i] > (image_len - header->offset[i]) / SkdbRegionSize[i];
+    }
+    // every column holds one entry per scan
+    for(i = REGION_SCAN_CAL_DURATION; !failure && i <= REGION_SCAN_SOURCE; ++i) {
+        failure = header->count[i] != header->count[REGION_SCAN_TIMESTAMP];
+    }
+    failure = failure || header->count[REGION_SCAN_STATION_BEG] != header->count[REGION_SCAN_TIMESTAMP] + 1 || \
+        header->count[REGION_SCAN_OFFSETS] != header->count[REGION_SCAN_STATIONS] || \
+        header->count[REGION_SCAN_STATION_SETS] != header->count[REGION_SCAN_TIMESTAMP] * STATION_SET_WORDS(header->count[REGION_STATIONS]) || \
+        header->count[REGION_INDEX_STATION_BEG] != header->count[REGION_STATIONS] + 1 || \
+        header->count[REGION_INDEX_STATION_OFFSETS] != header->count[REGION_INDEX_STATION_SCANS] || \
+        header->count[REGION_INDEX_SOURCE_BEG] != header->count[REGION_SOURCES] + 1;
+    if(failure) {
+        LOG_INFO("Compiled schedule is stale or invalid. Parsing schedule.");
+        munmap(image, image_len);
+        return 1;
+    }
+    char* base = (char*) image;
+    skd->arena = Arena_create(SCHEDULE_ARENA_BYTES);
+    if(skd->arena == NULL) {
+        LOG_INFO("Unable to allocate schedule arena. Parsing schedule.");
+        munmap(image, image_len);
+        return 1;
+    }
+    // Schedule_index_names reserves the lookups for the stored station and source counts
+    failure = HashMap_init_in(&(skd->stations_ant), skd->arena, 0, sizeof(uint32_t)) || \
+        HashMap_init_in(&(skd->stations_pos), skd->arena, 0, sizeof(uint32_t)) || \
+        HashMap_init_in(&(skd->sources_iau), skd->arena, 0, sizeof(uint32_t)) || \
+        HashMap_init_in(&(skd->sources_alias), skd->arena, 0, sizeof(uint32_t));
+    // the tables are copied out, since a reload replaces them independently of the scans
+    skd->station_count = header->count[REGION_STATIONS];
+    skd->stations = (Station*) Arena_alloc(skd->arena, (skd->station_count + 1) * sizeof(Station));
+    skd->source_count = header->count[REGION_SOURCES];
+    skd->sources = (Source*) Arena_alloc(skd->arena, (skd->source_count + 1) * sizeof(Source));
+    if(skd->stations != NULL) {
+        memcpy(skd->stations, base + header->offset[REGION_STATIONS], skd->station_count * sizeof(Station));
+        // names are looked up as strings, so a corrupt image mustn't leave them unterminated
+        for(i = 0; i < skd->station_count; ++i) skd->stations[i].key[2] = skd->stations[i].id[2] = '\0';
+    }
+    if(skd->sources != NULL) memcpy(skd->sources, base + header->offset[REGION_SOURCES], skd->source_count * sizeof(Source));
+    skd->section_count = header->count[REGION_SECTIONS];
+    skd->sections = (Section*) Arena_alloc(skd->arena, (skd->section_count + 1) * sizeof(Section));
+    // every section has to lie within the source text
+    const SkdbSection* record = (const SkdbSection*) (base + header->offset[REGION_SECTIONS]);
+    unsigned int sections_within = 1;
+    for(i = 0; skd->sections != NULL && i < skd->section_count; ++i) {
+        sections_within &= memchr(record[i].name, '\0', sizeof(record[i].name)) != NULL && \
+            record[i].head <= record[i].beg && record[i].beg <= record[i].end && record[i].end <= skd->src_len;
+        memcpy(skd->sections[i].name, record[i].name, sizeof(skd->sections[i].name));
+        skd->sections[i].head = (size_t) record[i].head;
+        skd->sections[i].beg = (size_t) record[i].beg;
+        skd->sections[i].end = (size_t) record[i].end;
+        skd->sections[i].parsed = 0;
+        skd->sections[i].data = NULL;
+    }
+    skd->skipped_count = header->count[REGION_SKIPPED];
+    skd->skipped_lines = (size_t*) Arena_alloc(skd->arena, (skd->skipped_count + 1) * sizeof(size_t));
+    if(skd->skipped_lines != NULL) {
+        uint64_t* skipped = (uint64_t*) (base + header->offset[REGION_SKIPPED]);
+        for(i = 0; i < skd->skipped_count; ++i) skd->skipped_lines[i] = (size_t) skipped[i];
+    }
+    skd->scan_count = header->count[REGION_SCAN_TIMESTAMP];
+    skd->scans = (ScanTable) {
+        .timestamp = (TimeMs*) (base + header->offset[REGION_SCAN_TIMESTAMP]),
+        .cal_duration = (uint32_t*) (base + header->offset[REGION_SCAN_CAL_DURATION]),
+        .obs_duration = (uint32_t*) (base + header->offset[REGION_SCAN_OBS_DURATION]),
+        .source = (uint32_t*) (base + header->offset[REGION_SCAN_SOURCE]),
+        .station_beg = (uint32_t*) (base + header->offset[REGION_SCAN_STATION_BEG]),
+        .stations = (uint16_t*) (base + header->offset[REGION_SCAN_STATIONS]),
+        .offsets = (uint32_t*) (base + header->offset[REGION_SCAN_OFFSETS]),
+        .station_sets = (uint64_t*) (base + header->offset[REGION_SCAN_STATION_SETS]),
+        .set_words = STATION_SET_WORDS(skd->station_count),
+    };
+    skd->scan_index = (ScanIndex) {
+        .station_beg = (uint32_t*) (base + header->offset[REGION_INDEX_STATION_BEG]),
+        .station_scans = (uint32_t*) (base + header->offset[REGION_INDEX_STATION_SCANS]),
+        .station_offsets = (uint32_t*) (base + header->offset[REGION_INDEX_STATION_OFFSETS]),
+        .source_beg = (uint32_t*) (base + header->offset[REGION_INDEX_SOURCE_BEG]),
+        .source_scans = (uint32_t*) (base + header->offset[REGION_INDEX_SOURCE_SCANS]),
+    };
+    skd->image = (ScheduleImage) { .addr = image, .len = image_len };
+    failure = failure || skd->sections == NULL || skd->skipped_lines == NULL || skd->stations == NULL || skd->sources == NULL || !sections_within;
+    if(!failure) failure = Schedule_index_names(skd);
+    // every scan's stations have to lie within the pools, after the previous scan's
+    const uint32_t* station_beg = skd->scans.station_beg;
+    failure = failure || station_beg[0] != 0 || station_beg[skd->scan_count] != header->count[REGION_SCAN_STATIONS];
+    for(i = 0; !failure && i < skd->scan_count; ++i) {
+        failure = station_beg[i + 1] < station_beg[i] || station_beg[i + 1] - station_beg[i] > skd->station_count;
+    }
+    // as must every entry of the scan index
+    failure = failure || !index_within(skd->scan_index.station_beg, skd->station_count, skd->scan_index.station_scans, \
+        header->count[REGION_INDEX_STATION_SCANS], skd->scan_count);
+    failure = failure || !index_within(skd->scan_index.source_beg, skd->source_count, skd->scan_index.source_scans, \
+        header->count[REGION_INDEX_SOURCE_SCANS], skd->scan_count);
+    if(failure) {
+        LOG_INFO("Compiled schedule is corrupt. Parsing schedule.");
+        Arena_release(skd->arena);
+        skd->arena = NULL;
+        skd->stations = NULL;
+        skd->sources = NULL;
+        skd->sections = NULL;
+        skd->skipped_lines = NULL;
+        skd->skipped_count = 0;
+        memset(&(skd->scans), 0, sizeof(ScanTable));
+        memset(&(skd->scan_index), 0, sizeof(ScanIndex));
+        skd->scan_count = 0;
+        skd->image = (ScheduleImage) { .addr = NULL, .len = 0 };
+        munmap(image, image_len);
+        return 1;
+    }
+    return 0;
+}
+
+void ScheduleCache_release(ScheduleImage image) {
+    if(image.addr != NULL) munmap(image.addr, image.len);
+}
@@ -0,0 +1,763 @@
+#include "skd_index.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <limits.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "skd.h"
+#include "util/log.h"
+#include "util/hashmap.h"
+#include "util/archive.h"
+#include "pool.h"
+
+// bump SKDX_VERSION whenever the layout of any region changes
+#define SKDX_MAGIC "SKDX"
+#define SKDX_VERSION 1
+#define SKDX_BYTE_ORDER 0x01020304u
+#define SKDX_NAME "/.skdindex"
+#define SKDX_ALIGN 8
+
+typedef enum {
+    REGION_ENTRIES,
+    REGION_STATIONS,
+    REGION_SOURCES,
+    REGION_REFS,
+    REGION_PATHS,
+    REGION_COUNT
+} SkdxRegion;
+
+typedef struct {
+    char magic[4];
+    uint32_t version, byte_order, reserved;
+    uint64_t count[REGION_COUNT];
+    uint64_t offset[REGION_COUNT];
+} SkdxHeader;
+
+static const size_t SkdxRegionSize[REGION_COUNT] = {
+    sizeof(IndexEntry),
+    sizeof(IndexStation),
+    sizeof(IndexSource),
+    sizeof(uint32_t),
+    sizeof(char),
+};
+
+static void** index_region(ScheduleIndex* index, SkdxRegion region) {
+    switch(region) {
+        case REGION_ENTRIES: return (void**) &(index->entries);
+        case REGION_STATIONS: return (void**) &(index->stations);
+        case REGION_SOURCES: return (void**) &(index->sources);
+        case REGION_REFS: return (void**) &(index->refs);
+        default: return (void**) &(index->paths);
+    }
+}
+
+static size_t* index_count(ScheduleIndex* index, SkdxRegion region) {
+    switch(region) {
+        case REGION_ENTRIES: return &(index->entry_count);
+        case REGION_STATIONS: return &(index->station_count);
+        case REGION_SOURCES: return &(index->source_count);
+        case REGION_REFS: return &(index->ref_count);
+        default: return &(index->path_len);
+    }
+}
+
+static char* index_path(const char* dir, const char* name) {
+    size_t dir_len = strlen(dir), name_len = strlen(name);
+    char* path = (char*) malloc(dir_len + name_len + 2);
+    if(path == NULL) return NULL;
+    memcpy(path, dir, dir_len);
+    memcpy(&(path[dir_len]), name, name_len + 1);
+    return path;
+}
+
+void ScheduleIndex_free(ScheduleIndex index) {
+    free(index.entries);
+    free(index.stations);
+    free(index.sources);
+    free(index.refs);
+    free(index.paths);
+}
+
+// returns 1 if an entry or name points outside the index
+static unsigned int index_check(ScheduleIndex index) {
+    size_t i, j;
+    if(index.path_len > 0 && index.paths[index.path_len - 1] != '\0') return 1;
+    for(i = 0; i < index.station_count; ++i) {
+        if(memchr(index.stations[i].id, '\0', sizeof(index.stations[i].id)) == NULL) return 1;
+        if(memchr(index.stations[i].name, '\0', sizeof(index.stations[i].name)) == NULL) return 1;
+    }
+    for(i = 0; i < index.source_count; ++i) {
+        if(memchr(index.sources[i].iau, '\0', sizeof(index.sources[i].iau)) == NULL) return 1;
+        if(memchr(index.sources[i].name, '\0', sizeof(index.sources[i].name)) == NULL) return 1;
+    }
+    const IndexEntry* entry;
+    for(i = 0; i < index.entry_count; ++i) {
+        entry = &(index.entries[i]);
+        if(entry->path >= index.path_len || memchr(entry->session, '\0', sizeof(entry->session)) == NULL) return 1;
+        if((uint64_t) entry->station_beg + entry->station_count > index.ref_count) return 1;
+        if((uint64_t) entry->source_beg + entry->source_count > index.ref_count) return 1;
+        for(j = 0; j < entry->station_count; ++j) if(index.refs[entry->station_beg + j] >= index.station_count) return 1;
+        for(j = 0; j < entry->source_count; ++j) if(index.refs[entry->source_beg + j] >= index.source_count) return 1;
+    }
+    return 0;
+}
+
+unsigned int ScheduleIndex_load(ScheduleIndex* index, const char* dir) {
+    memset(index, 0, sizeof(ScheduleIndex));
+    char* path = index_path(dir, SKDX_NAME);
+    if(path == NULL) {
+        LOG_ERROR("Unable to allocate index path.");
+        return 1;
+    }
+    FILE* stream = fopen(path, "rb");
+    free(path);
+    // a missing index is built from scratch
+    if(stream == NULL) return 0;
+    SkdxHeader header;
+    if(fread(&header, sizeof(SkdxHeader), 1, stream) != 1 || memcmp(header.magic, SKDX_MAGIC, 4) != 0 || \
+        header.version != SKDX_VERSION || header.byte_order != SKDX_BYTE_ORDER) {
+        LOG_INFO("Schedule index is from another version. Rebuilding it.");
+        fclose(stream);
+        return 0;
+    }
+    void** region;
+    for(size_t i = 0; i < REGION_COUNT; ++i) {
+        region = index_region(index, (SkdxRegion) i);
+        if(header.count[i] > SIZE_MAX / SkdxRegionSize[i] || header.offset[i] > LONG_MAX) {
+            *region = NULL;
+            break;
+        }
+        *region = malloc(header.count[i] == 0 ? 1 : header.count[i] * SkdxRegionSize[i]);
+        if(*region == NULL || fseek(stream, (long) header.offset[i], SEEK_SET) != 0 || \
+            fread(*region, SkdxRegionSize[i], header.count[i], stream) != header.count[i]) {
+            free(*region);
+            *region = NULL;
+            break;
+        }
+        *index_count(index, (SkdxRegion) i) = header.count[i];
+    }
+    fclose(stream);
+    // a damaged index is treated like one from another version
+    if(index->paths == NULL || index_check(*index)) {
+        LOG_INFO("Schedule index is truncated or corrupt. Rebuilding it.");
+        ScheduleIndex_free(*index);
+        memset(index, 0, sizeof(ScheduleIndex));
+    }
+    return 0;
+}
+
+unsigned int ScheduleIndex_write(ScheduleIndex index, const char* dir) {
+    char* path = index_path(dir, SKDX_NAME);
+    char* path_temp = index_path(dir, SKDX_NAME ".tmp");
+    if(path == NULL || path_temp == NULL) {
+        LOG_ERROR("Unable to allocate index path.");
+        free(path);
+        free(path_temp);
+        return 1;
+    }
+    // renamed into place once complete, so readers never see a partial index
+    FILE* stream = fopen(path_temp, "wb");
+    if(stream == NULL) {
+        LOG_ERROR("Unable to create schedule index.");
+        free(path);
+        free(path_temp);
+        return 1;
+    }
+    SkdxHeader header;
+    memset(&header, 0, sizeof(SkdxHeader));
+    memcpy(header.magic, SKDX_MAGIC, 4);
+    header.version = SKDX_VERSION;
+    header.byte_order = SKDX_BYTE_ORDER;
+    size_t i, offset = sizeof(SkdxHeader);
+    for(i = 0; i < REGION_COUNT; ++i) {
+        offset = (offset + SKDX_ALIGN - 1) & ~((size_t) SKDX_ALIGN - 1);
+        header.count[i] = *index_count(&index, (SkdxRegion) i);
+        header.offset[i] = offset;
+        offset += header.count[i] * SkdxRegionSize[i];
+    }
+    static const char zeros[SKDX_ALIGN] = {0,};
+    unsigned int failure = fwrite(&header, sizeof(SkdxHeader), 1, stream) != 1;
+    for(i = 0, offset = sizeof(SkdxHeader); !failure && i < REGION_COUNT; ++i) {
+        failure = fwrite(zeros, 1, header.offset[i] - offset, stream) != header.offset[i] - offset || \
+            fwrite(*index_region(&index, (SkdxRegion) i), SkdxRegionSize[i], header.count[i], stream) != header.count[i];
+        offset = header.offset[i] + header.count[i] * SkdxRegionSize[i];
+    }
+    failure |= (unsigned int) fclose(stream);
+    if(!failure) failure = rename(path_temp, path) != 0;
+    if(failure) {
+        LOG_ERROR("Failed to write schedule index.");
+        remove(path_temp);
+    }
+    free(path);
+    free(path_temp);
+    return failure;
+}
+
+// grows buf to hold at least count elements
+static unsigned int index_reserve(void** buf, size_t* cap, size_t count, size_t size) {
+    if(count <= *cap) return 0;
+    size_t next = (*cap == 0) ? 64 : *cap;
+    while(next < count) next *= 2;
+    void* temp = realloc(*buf, next * size);
+    if(temp == NULL) return 1;
+    *buf = temp;
+    *cap = next;
+    return 0;
+}
+
+// what a single schedule contributes to the index
+typedef struct {
+    char session[16];
+    Datetime beg, end;
+    IndexStation* stations;
+    IndexSource* sources;
+    size_t station_count, station_cap, source_count, source_cap;
+    unsigned int failure;
+} IndexSummary;
+
+typedef enum {
+    SUMMARY_OTHER,
+    SUMMARY_EXPER,
+    SUMMARY_STATIONS,
+    SUMMARY_SOURCES,
+    SUMMARY_SKED
+} SummarySection;
+
+// header lines are read through a window of this size, it only grows to fit a longer line
+#define INDEX_WINDOW_BYTES (1 << 16)
+// the end of plain schedules is read back in spans starting at this size
+#define INDEX_TAIL_BYTES (1 << 16)
+
+typedef struct {
+    IndexSummary* summary;
+    SummarySection section;
+    unsigned int plain, scan_count;
+    // offset just past the first $SKED line
+    size_t sked_lo;
+    // last $SKED line of the current window, compressed schedules have to be read to the end
+    const char* last_beg;
+    const char* last_end;
+} SummaryRead;
+
+static unsigned int is_blank_line(const char* line, const char* end) {
+    for(; line < end; ++line) if(!isspace(*line)) return 0;
+    return 1;
+}
+
+// returns 1 once nothing more has to be read in order
+static unsigned int summary_line(SummaryRead* rd, const char* line, const char* end, size_t offset) {
+    IndexSummary* summary = rd->summary;
+    char buf[64];
+    size_t len = (size_t) (end - line);
+    if(len >= sizeof(buf)) len = sizeof(buf) - 1;
+    if(line[0] == '$') {
+        memcpy(buf, line, len);
+        buf[len] = '\0';
+        rd->section = SUMMARY_OTHER;
+        if(strncmp(buf, "$EXPER", 6) == 0 && (buf[6] == '\0' || isspace(buf[6]))) {
+            rd->section = SUMMARY_EXPER;
+            if(sscanf(buf, "$EXPER %15s", summary->session) != 1) summary->session[0] = '\0';
+        }
+        else if(strncmp(buf, "$STATIONS", 9) == 0 && (buf[9] == '\0' || isspace(buf[9]))) rd->section = SUMMARY_STATIONS;
+        else if(strncmp(buf, "$SOURCES", 8) == 0 && (buf[8] == '\0' || isspace(buf[8]))) rd->section = SUMMARY_SOURCES;
+        else if(strncmp(buf, "$SKED", 5) == 0 && (buf[5] == '\0' || isspace(buf[5]))) rd->section = SUMMARY_SKED;
+        return 0;
+    }
+    switch(rd->section) {
+        case SUMMARY_STATIONS:
+            if(line[0] != 'P') break;
+            memcpy(buf, line, len);
+            buf[len] = '\0';
+            if(index_reserve((void**) &(summary->stations), &(summary->station_cap), summary->station_count + 1, sizeof(IndexStation))) {
+                summary->failure = 1;
+                return 1;
+            }
+            if(sscanf(buf, "P %2s %8s", summary->stations[summary->station_count].id, summary->stations[summary->station_count].name) == 2) {
+                summary->station_count++;
+            }
+            break;
+        case SUMMARY_SOURCES:
+            memcpy(buf, line, len);
+            buf[len] = '\0';
+            if(index_reserve((void**) &(summary->sources), &(summary->source_cap), summary->source_count + 1, sizeof(IndexSource))) {
+                summary->failure = 1;
+                return 1;
+            }
+            IndexSource* source = &(summary->sources[summary->source_count]);
+            if(sscanf(buf, " %8s %8s", source->iau, source->name) == 2) {
+                if(source->name[0] == '$') source->name[0] = '\0';
+                summary->source_count++;
+            }
+            break;
+        case SUMMARY_SKED:
+            if(is_blank_line(line, end)) break;
+            if(rd->scan_count == 0) {
+                if(Schedule_scan_span(line, end, &(summary->beg), &(summary->end))) break;
+                rd->sked_lo = offset + (size_t) (end - line);
+                rd->scan_count = 1;
+                // the end of plain schedules is found by reading back from the end of the file
+                return rd->plain;
+            }
+            rd->last_beg = line;
+            rd->last_end = end;
+            break;
+        default: break;
+    }
+    return 0;
+}
+
+// finds when the last $SKED line of a plain schedule ends by reading back from the end of the file
+// the last line before each section header (or the end of the file) is tried until one parses as a scan
+// nothing before lo, the end of the first $SKED line, is read
+static unsigned int summary_last_scan(FILE* stream, size_t lo, Datetime* stop) {
+    if(fseek(stream, 0L, SEEK_END) != 0) return 1;
+    long tell = ftell(stream);
+    if(tell < 0 || (size_t) tell <= lo) return 1;
+    size_t size = (size_t) tell, span = INDEX_TAIL_BYTES, beg;
+    char* buf = NULL;
+    char* temp;
+    const char* line_beg;
+    const char* line_end;
+    unsigned int candidate;
+    Datetime start;
+    for(;;) {
+        beg = (size - lo > span) ? size - span : lo;
+        temp = (char*) realloc(buf, size - beg);
+        if(temp == NULL || fseek(stream, (long) beg, SEEK_SET) != 0) break;
+        buf = temp;
+        if(fread(buf, 1, size - beg, stream) != size - beg) break;
+        for(line_beg = buf + (size - beg), candidate = 1; line_beg > buf;) {
+            line_end = line_beg;
+            if(*(line_end - 1) == '\n') line_end--;
+            for(line_beg = line_end; line_beg > buf && *(line_beg - 1) != '\n'; --line_beg);
+            // the first line is only complete if it starts at lo
+            if(line_beg == buf && beg != lo) break;
+            if(line_beg[0] == '$') candidate = 1;
+            else if(candidate && !is_blank_line(line_beg, line_end)) {
+                if(!Schedule_scan_span(line_beg, line_end, &start, stop)) {
+                    free(buf);
+                    return 0;
+                }
+                candidate = 0;
+            }
+        }
+        if(beg == lo) break;
+        span *= 2;
+    }
+    free(buf);
+    return 1;
+}
+
+static void summarize(IndexSummary* summary, const char* path) {
+    memset(summary, 0, sizeof(IndexSummary));
+    Archive archive;
+    if(Archive_open(&archive, path)) {
+        summary->failure = 1;
+        return;
+    }
+    SummaryRead rd = { .summary = summary, .section = SUMMARY_OTHER, .plain = archive.format == ARCHIVE_PLAIN };
+    size_t window_cap = INDEX_WINDOW_BYTES, fill = 0, base = 0, len;
+    char* window = (char*) malloc(window_cap);
+    char* temp;
+    char* last = NULL;
+    size_t last_len = 0;
+    const char* line;
+    const char* line_end;
+    unsigned int done = 0;
+    summary->failure = window == NULL;
+    while(!(summary->failure) && !done) {
+        if(fill == window_cap) {
+            temp = (char*) realloc(window, window_cap * 2);
+            if(temp == NULL) {
+                summary->failure = 1;
+                break;
+            }
+            window = temp;
+            window_cap *= 2;
+        }
+        len = Archive_read(&archive, window + fill, window_cap - fill);
+        if(len == 0) {
+            summary->failure = archive.failure;
+            done = 1;
+        }
+        fill += len;
+        // the last line may not be terminated
+        for(line = window, rd.last_beg = NULL; line < window + fill && !(summary->failure);) {
+            line_end = (const char*) memchr(line, '\n', (size_t) (window + fill - line));
+            if(line_end == NULL) {
+                if(!done) break;
+                line_end = window + fill;
+            }
+            if(summary_line(&rd, line, line_end, base + (size_t) (line - window))) {
+                done = 1;
+                break;
+            }
+            line = line_end + 1;
+        }
+        if(rd.last_beg != NULL) {
+            temp = (char*) realloc(last, (size_t) (rd.last_end - rd.last_beg));
+            if(temp == NULL) summary->failure = 1;
+            else {
+                last = temp;
+                last_len = (size_t) (rd.last_end - rd.last_beg);
+                memcpy(last, rd.last_beg, last_len);
+            }
+        }
+        if(line > window + fill) line = window + fill;
+        base += (size_t) (line - window);
+        fill -= (size_t) (line - window);
+        memmove(window, line, fill);
+    }
+    Datetime start;
+    if(!(summary->failure) && rd.scan_count > 0) {
+        if(rd.plain) summary_last_scan(archive.stream, rd.sked_lo, &(summary->end));
+        else if(last != NULL) Schedule_scan_span(last, last + last_len, &start, &(summary->end));
+    }
+    free(last);
+    free(window);
+    Archive_close(&archive);
+}
+
+// schedules found below the indexed directory
+typedef struct {
+    char* rel;
+    uint64_t size;
+    int64_t mtime_sec, mtime_nsec;
+    size_t prev; // matching entry of the previous index, SIZE_MAX if it has to be read
+} IndexFile;
+
+typedef struct {
+    IndexFile* files;
+    size_t count, cap;
+} IndexFileList;
+
+static unsigned int is_schedule_name(const char* name) {
+    static const char* suffixes[] = { ".skd", ".skd.gz", ".skd.zst" };
+    size_t len = strlen(name), suffix_len;
+    for(size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); ++i) {
+        suffix_len = strlen(suffixes[i]);
+        if(len > suffix_len && strcmp(name + len - suffix_len, suffixes[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// collects every schedule below dir/rel, hidden entries are skipped
+static unsigned int index_walk(const char* dir, const char* rel, IndexFileList* list) {
+    size_t dir_len = strlen(dir), rel_len = strlen(rel), name_len;
+    char* path = (char*) malloc(dir_len + rel_len + 2);
+    if(path == NULL) return 1;
+    sprintf(path, (rel_len == 0) ? "%s%s" : "%s/%s", dir, rel);
+    DIR* stream = opendir(path);
+    free(path);
+    if(stream == NULL) {
+        LOG_ERROR("Unable to open schedule directory.");
+        return 1;
+    }
+    struct dirent* ent;
+    struct stat info;
+    char* child;
+    unsigned int failure = 0;
+    while(!failure && (ent = readdir(stream)) != NULL) {
+        if(ent->d_name[0] == '.') continue;
+        name_len = strlen(ent->d_name);
+        child = (char*) malloc(rel_len + name_len + 2);
+        path = (char*) malloc(dir_len + rel_len + name_len + 3);
+        if(child == NULL || path == NULL) {
+            free(child);
+            free(path);
+            failure = 1;
+            break;
+        }
+        sprintf(child, (rel_len == 0) ? "%s%s" : "%s/%s", rel, ent->d_name);
+        sprintf(path, "%s/%s", dir, child);
+        if(stat(path, &info) != 0) {
+            free(child);
+        } else if(S_ISDIR(info.st_mode)) {
+            failure = index_walk(dir, child, list);
+            free(child);
+        } else if(S_ISREG(info.st_mode) && is_schedule_name(ent->d_name)) {
+            if(index_reserve((void**) &(list->files), &(list->cap), list->count + 1, sizeof(IndexFile))) {
+                free(child);
+                failure = 1;
+            } else list->files[(list->count)++] = (IndexFile) {
+                .rel = child,
+                .size = (uint64_t) info.st_size,
+                .mtime_sec = (int64_t) info.st_mtim.tv_sec,
+                .mtime_nsec = (int64_t) info.st_mtim.tv_nsec,
+                .prev = SIZE_MAX,
+            };
+        } else {
+            free(child);
+        }
+        free(path);
+    }
+    closedir(stream);
+    return failure;
+}
+
+static int compare_files(const void* a, const void* b) {
+    return strcmp(((const IndexFile*) a)->rel, ((const IndexFile*) b)->rel);
+}
+
+// previous entry for rel, entries are sorted by path
+static size_t index_find(ScheduleIndex index, const char* rel) {
+    size_t lo = 0, hi = index.entry_count, mid;
+    int order;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        order = strcmp(&(index.paths[index.entries[mid].path]), rel);
+        if(order == 0) return mid;
+        if(order < 0) lo = mid + 1; else hi = mid;
+    }
+    return SIZE_MAX;
+}
+
+typedef struct {
+    const char* dir;
+    IndexFile** pending;
+    IndexSummary* summaries;
+} IndexJob;
+
+static void summarize_task(void* ctx, size_t idx) {
+    IndexJob* job = (IndexJob*) ctx;
+    char* path = (char*) malloc(strlen(job->dir) + strlen(job->pending[idx]->rel) + 2);
+    if(path == NULL) {
+        memset(&(job->summaries[idx]), 0, sizeof(IndexSummary));
+        job->summaries[idx].failure = 1;
+        return;
+    }
+    sprintf(path, "%s/%s", job->dir, job->pending[idx]->rel);
+    summarize(&(job->summaries[idx]), path);
+    free(path);
+}
+
+// index being assembled, stations and sources are deduplicated by code and IAU name
+typedef struct {
+    ScheduleIndex index;
+    size_t cap[REGION_COUNT];
+    HashMap station_ids, source_ids;
+} IndexBuilder;
+
+static unsigned int builder_intern(IndexBuilder* builder, SkdxRegion region, const char* key, const void* val) {
+    HashMap* ids = (region == REGION_STATIONS) ? &(builder->station_ids) : &(builder->source_ids);
+    uint32_t* id = (uint32_t*) HashMap_get(*ids, key);
+    uint32_t next;
+    if(id == NULL) {
+        next = (uint32_t) *index_count(&(builder->index), region);
+        if(index_reserve(index_region(&(builder->index), region), &(builder->cap[region]), next + 1ul, SkdxRegionSize[region])) return 1;
+        memcpy((char*) *index_region(&(builder->index), region) + next * SkdxRegionSize[region], val, SkdxRegionSize[region]);
+        (*index_count(&(builder->index), region))++;
+        if(HashMap_insert(ids, key, &next)) return 1;
+        id = &next;
+    }
+    if(index_reserve((void**) &(builder->index.refs), &(builder->cap[REGION_REFS]), builder->index.ref_count + 1, sizeof(uint32_t))) return 1;
+    builder->index.refs[(builder->index.ref_count)++] = *id;
+    return 0;
+}
+
+static unsigned int builder_add(IndexBuilder* builder, const IndexFile* file, IndexEntry entry,
+    const IndexStation* stations, size_t station_count, const IndexSource* sources, size_t source_count) {
+    ScheduleIndex* index = &(builder->index);
+    size_t i, rel_len = strlen(file->rel) + 1;
+    if(index_reserve((void**) &(index->entries), &(builder->cap[REGION_ENTRIES]), index->entry_count + 1, sizeof(IndexEntry)) || \
+        index_reserve((void**) &(index->paths), &(builder->cap[REGION_PATHS]), index->path_len + rel_len, sizeof(char))) return 1;
+    entry.path = index->path_len;
+    memcpy(&(index->paths[index->path_len]), file->rel, rel_len);
+    index->path_len += rel_len;
+    entry.size = file->size;
+    entry.mtime_sec = file->mtime_sec;
+    entry.mtime_nsec = file->mtime_nsec;
+    entry.station_beg = (uint32_t) index->ref_count;
+    entry.station_count = (uint32_t) station_count;
+    for(i = 0; i < station_count; ++i) if(builder_intern(builder, REGION_STATIONS, stations[i].id, &(stations[i]))) return 1;
+    entry.source_beg = (uint32_t) index->ref_count;
+    entry.source_count = (uint32_t) source_count;
+    for(i = 0; i < source_count; ++i) if(builder_intern(builder, REGION_SOURCES, sources[i].iau, &(sources[i]))) return 1;
+    index->entries[(index->entry_count)++] = entry;
+    return 0;
+}
+
+static unsigned int index_rebuild(IndexBuilder* builder, ScheduleIndex prev, IndexFileList list, IndexSummary* summaries) {
+    IndexStation* stations = NULL;
+    IndexSource* sources = NULL;
+    size_t i, j, k = 0, station_cap = 0, source_cap = 0;
+    unsigned int failure = 0;
+    IndexEntry entry;
+    IndexSummary* summary;
+    for(i = 0; !failure && i < list.count; ++i) {
+        memset(&entry, 0, sizeof(IndexEntry));
+        if(list.files[i].prev != SIZE_MAX) {
+            // unchanged schedules keep their entry, only their refs are translated
+            entry = prev.entries[list.files[i].prev];
+            failure = index_reserve((void**) &stations, &station_cap, entry.station_count + 1ul, sizeof(IndexStation)) || \
+                index_reserve((void**) &sources, &source_cap, entry.source_count + 1ul, sizeof(IndexSource));
+            if(failure) break;
+            for(j = 0; j < entry.station_count; ++j) stations[j] = prev.stations[prev.refs[entry.station_beg + j]];
+            for(j = 0; j < entry.source_count; ++j) sources[j] = prev.sources[prev.refs[entry.source_beg + j]];
+            failure = builder_add(builder, &(list.files[i]), entry, stations, entry.station_count, sources, entry.source_count);
+            continue;
+        }
+        // summaries follow the same order as the list
+        // unreadable schedules are kept as empty entries, so they aren't read again until they change
+        summary = &(summaries[k++]);
+        if(summary->failure) {
+            LOG_INFO("Unable to index schedule. It won't match any query.");
+            failure = builder_add(builder, &(list.files[i]), entry, NULL, 0, NULL, 0);
+            continue;
+        }
+        memcpy(entry.session, summary->session, sizeof(entry.session));
+        entry.beg = summary->beg;
+        entry.end = summary->end;
+        failure = builder_add(builder, &(list.files[i]), entry,
+            summary->stations, summary->station_count, summary->sources, summary->source_count);
+    }
+    free(stations);
+    free(sources);
+    return failure;
+}
+
+unsigned int ScheduleIndex_update(ScheduleIndex* index, const char* dir, size_t* updated) {
+    IndexFileList list = { .files = NULL, .count = 0, .cap = 0 };
+    size_t i, pending_count = 0, kept = 0, stale = 0;
+    unsigned int failure = index_walk(dir, "", &list);
+    if(!failure) qsort(list.files, list.count, sizeof(IndexFile), compare_files);
+    IndexFile** pending = (IndexFile**) malloc((list.count == 0 ? 1 : list.count) * sizeof(IndexFile*));
+    IndexSummary* summaries = (IndexSummary*) malloc((list.count == 0 ? 1 : list.count) * sizeof(IndexSummary));
+    failure |= pending == NULL || summaries == NULL;
+    IndexEntry* entry;
+    for(i = 0; !failure && i < list.count; ++i) {
+        list.files[i].prev = index_find(*index, list.files[i].rel);
+        entry = (list.files[i].prev == SIZE_MAX) ? NULL : &(index->entries[list.files[i].prev]);
+        if(entry != NULL && entry->size == list.files[i].size && \
+            entry->mtime_sec == list.files[i].mtime_sec && entry->mtime_nsec == list.files[i].mtime_nsec) {
+            kept++;
+        } else {
+            if(entry != NULL) stale++;
+            list.files[i].prev = SIZE_MAX;
+            pending[pending_count++] = &(list.files[i]);
+        }
+    }
+    // only new and modified schedules are read
+    IndexJob job = { .dir = dir, .pending = pending, .summaries = summaries };
+    if(!failure && pending_count > 0) pool_run(pending_count, summarize_task, &job);
+    IndexBuilder builder;
+    memset(&builder, 0, sizeof(IndexBuilder));
+    // the lookups are reserved for every station and source the rebuilt index could hold
+    size_t station_total = index->station_count, source_total = index->source_count;
+    for(i = 0; !failure && i < pending_count; ++i) {
+        if(summaries[i].failure) continue;
+        station_total += summaries[i].station_count;
+        source_total += summaries[i].source_count;
+    }
+    failure = failure || HashMap_init(&(builder.station_ids), 0, sizeof(uint32_t)) || HashMap_init(&(builder.source_ids), 0, sizeof(uint32_t)) || \
+        HashMap_reserve(&(builder.station_ids), station_total) || HashMap_reserve(&(builder.source_ids), source_total);
+    if(!failure) failure = index_rebuild(&builder, *index, list, summaries);
+    HashMap_free(builder.station_ids);
+    HashMap_free(builder.source_ids);
+    for(i = 0; summaries != NULL && i < pending_count; ++i) {
+        free(summaries[i].stations);
+        free(summaries[i].sources);
+    }
+    for(i = 0; i < list.count; ++i) free(list.files[i].rel);
+    free(list.files);
+    free(pending);
+    free(summaries);
+    if(failure) {
+        LOG_ERROR("Unable to update schedule index.");
+        ScheduleIndex_free(builder.index);
+        return 1;
+    }
+    // schedules which disappeared count as well
+    *updated = pending_count + (index->entry_count - kept - stale);
+    ScheduleIndex_free(*index);
+    *index = builder.index;
+    return 0;
+}
+
+static int compare_datetime(Datetime a, Datetime b) {
+    if(a.yrs != b.yrs) return (a.yrs < b.yrs) ? -1 : 1;
+    if(a.day != b.day) return (a.day < b.day) ? -1 : 1;
+    if(a.hrs != b.hrs) return (a.hrs < b.hrs) ? -1 : 1;
+    if(a.min != b.min) return (a.min < b.min) ? -1 : 1;
+    if(a.sec != b.sec) return (a.sec < b.sec) ? -1 : 1;
+    return 0;
+}
+
+// marks which query terms each station or source satisfies, one bit per term
+#define INDEX_QUERY_TERMS 32
+static uint32_t* query_masks(const void* dict, size_t dict_count, size_t size, const char** terms, size_t term_count) {
+    uint32_t* masks = (uint32_t*) calloc(dict_count == 0 ? 1 : dict_count, sizeof(uint32_t));
+    if(masks == NULL) return NULL;
+    const char* key;
+    const char* name;
+    for(size_t i = 0; i < dict_count; ++i) {
+        // both dictionaries start with a code followed by a name
+        key = (const char*) dict + i * size;
+        name = key + ((size == sizeof(IndexStation)) ? 3 : 9);
+        for(size_t j = 0; j < term_count; ++j) {
+            if(strcasecmp(key, terms[j]) == 0 || (name[0] != '\0' && strcasecmp(name, terms[j]) == 0)) masks[i] |= 1u << j;
+        }
+    }
+    return masks;
+}
+
+typedef struct {
+    Datetime beg;
+    size_t entry;
+} IndexMatch;
+
+static int compare_matches(const void* a, const void* b) {
+    int order = compare_datetime(((const IndexMatch*) a)->beg, ((const IndexMatch*) b)->beg);
+    if(order != 0) return order;
+    return (((const IndexMatch*) a)->entry < ((const IndexMatch*) b)->entry) ? -1 : 1;
+}
+
+unsigned int ScheduleIndex_query(ScheduleIndex index, IndexQuery query, size_t** matches, size_t* match_count) {
+    *matches = NULL;
+    *match_count = 0;
+    if(query.station_count > INDEX_QUERY_TERMS || query.source_count > INDEX_QUERY_TERMS) {
+        LOG_ERROR("Too many stations or sources in index query.");
+        return 1;
+    }
+    uint32_t* station_masks = query_masks(index.stations, index.station_count, sizeof(IndexStation), query.stations, query.station_count);
+    uint32_t* source_masks = query_masks(index.sources, index.source_count, sizeof(IndexSource), query.sources, query.source_count);
+    IndexMatch* found = (IndexMatch*) malloc((index.entry_count == 0 ? 1 : index.entry_count) * sizeof(IndexMatch));
+    if(station_masks == NULL || source_masks == NULL || found == NULL) {
+        LOG_ERROR("Unable to allocate index query.");
+        free(station_masks);
+        free(source_masks);
+        free(found);
+        return 1;
+    }
+    uint32_t station_all = (uint32_t) ((1ull << query.station_count) - 1);
+    uint32_t source_all = (uint32_t) ((1ull << query.source_count) - 1);
+    uint32_t mask;
+    size_t i, j, count = 0;
+    const IndexEntry* entry;
+    for(i = 0; i < index.entry_count; ++i) {
+        entry = &(index.entries[i]);
+        if(query.bounded_from && compare_datetime(entry->end, query.from) < 0) continue;
+        if(query.bounded_to && compare_datetime(entry->beg, query.to) > 0) continue;
+        for(mask = 0, j = 0; j < entry->station_count; ++j) mask |= station_masks[index.refs[entry->station_beg + j]];
+        if(mask != station_all) continue;
+        for(mask = 0, j = 0; j < entry->source_count; ++j) mask |= source_masks[index.refs[entry->source_beg + j]];
+        if(mask != source_all) continue;
+        found[count++] = (IndexMatch) { .beg = entry->beg, .entry = i };
+    }
+    free(station_masks);
+    free(source_masks);
+    qsort(found, count, sizeof(IndexMatch), compare_matches);
+    *matches = (size_t*) malloc((count == 0 ? 1 : count) * sizeof(size_t));
+    if(*matches == NULL) {
+        LOG_ERROR("Unable to allocate index query.");
+        free(found);
+        return 1;
+    }
+    for(i = 0; i < count; ++i) (*matches)[i] = found[i].entry;
+    *match_count = count;
+    free(found);
+    return 0;
+}
@@ -7,59 +7,271 @@
     #include <time.h>
 #endif
 #include <glenv.h>
+#include <string.h>
 #include "skd.h"
+#include "skd_timeline.h"
 #include "camera.h"
 #include "ui.h"
 #include "util/log.h"
 #include "util/mjd.h"
+#include "pool.h"
 #include "util/shaders.h"
 
 #define CLOCK_SPEED_DEFAULT 5
 #define CLOCK_SPEED_MAX 11
+// the active scans are kept every KEYFRAME_EVENTS events, so a seek replays fewer events than that
+// schedules with more concurrent scans space them as far apart as a keyframe is wide, which bounds their size by the event buffer's
+#define KEYFRAME_EVENTS 1024
+// events are radix sorted on (ms - earliest ms) * 2 + type, EVENT_RADIX_BITS of the key per pass
+#define EVENT_RADIX_BITS 11
+#define EVENT_RADIX (1 << EVENT_RADIX_BITS)
+// below this many events a single thread sorts them faster than the pool can be spun up
+#define EVENT_PARALLEL_MIN (1 << 18)
+#define EVENT_CHUNKS_PER_THREAD 2
 
 typedef enum { EVENT_START, EVENT_FINAL } EventType;
 typedef struct { 
     size_t idx; 
-    double jd;
+    TimeMs ms;
     EventType type;
 } Event;
 
-void sort_event_buffer(Event* const buf, size_t scan_count) {
-    Event temp;
-    for(size_t i = 0, j; i < scan_count * 2 - 1; ++i) {
-        j = i;
-        for(size_t k = i + 1; k < scan_count * 2; ++k) {
-            if(buf[k].jd < buf[j].jd) j = k;
-        }
-        temp = buf[i];
-        buf[i] = buf[j];
-        buf[j] = temp;
-    }
-}
+// scans running at the playback time, kept as a sparse set
+// dense lists them in no particular order and pos[scan] is where scan sits in dense while it's listed
+// both have a slot for every loaded scan, so starting or ending a scan never searches or overflows
+typedef struct {
+    size_t count, cap;
+    uint32_t* dense;
+    uint32_t* pos;
+} ActiveScans;
 
 struct __SKD_PASS_H__SchedulePass {
     GLuint VAO[2], VBO[2], shader_program;
     size_t pts_count;
-    double jd, jd_max;
-    size_t event_idx;
+    // playback time, when the last scan ends and how far scans are loaded
+    TimeMs ms, ms_max;
+    TimeMs ms_loaded;
+    size_t event_idx, event_count, event_cap;
     Event* events;
-    size_t max_active_scans;
-    ssize_t* active_scans;
+    size_t scan_count;
+    size_t max_active_scans; // most scans running at once
+    ActiveScans active;
+    // keyframe k holds active.dense as it was before event k * keyframe_events, its count followed by up to keyframe_width scans
+    // only the first keyframe_valid still match the event buffer, the rest are rebuilt once a seek needs them
+    size_t keyframe_cap, keyframe_valid, keyframe_width, keyframe_events;
+    uint32_t* keyframes;
+    // what every station is doing, built once every scan is indexed by station
+    // it only feeds the overlay's station counts, the lines are still drawn from the active scans
+    // a station can take part in overlapping scans while the timeline follows one scan per station,
+    // and a streamed schedule has no timeline until it's fully loaded
+    StationTimeline timeline;
+    unsigned int timeline_built;
+    // pointing vectors of every active scan, sized for the most stations active at once so far
+    // they're uploaded once and drawn as they are until the active scans change or lines_until, when the next station stops observing
+    size_t scratch_cap, line_count;
+    GLfloat* vec;
+    TimeMs lines_until;
+    unsigned int lines_dirty;
     unsigned int paused, restarted;
     unsigned long long clock, clock_speed;
 };
 
-void update_active_scans(ssize_t* active_scans, size_t count, Event event) {
-    ssize_t fst, snd;
-    fst = (event.type == EVENT_START) ? (ssize_t) event.idx : -1;
-    snd = (event.type == EVENT_START) ? -1 : (ssize_t) event.idx;
-    for(size_t i = 0; i < count; ++i) {
-        if(active_scans[i] == snd) {
-            active_scans[i] = fst;
-            break;
+static unsigned int ActiveScans_reserve(ActiveScans* const set, size_t cap) {
+    if(cap <= set->cap) return 0;
+    if(cap < set->cap * 2) cap = set->cap * 2;
+    uint32_t* dense = (uint32_t*) realloc(set->dense, (cap + 1) * sizeof(uint32_t));
+    if(dense == NULL) {
+        LOG_ERROR("Unable to grow active scans in SchedulePass.");
+        return 1;
+    }
+    set->dense = dense;
+    uint32_t* pos = (uint32_t*) realloc(set->pos, (cap + 1) * sizeof(uint32_t));
+    if(pos == NULL) {
+        LOG_ERROR("Unable to grow active scans in SchedulePass.");
+        return 1;
+    }
+    memset(&(pos[set->cap]), 0, (cap + 1 - set->cap) * sizeof(uint32_t));
+    set->pos = pos;
+    set->cap = cap;
+    return 0;
+}
+
+static unsigned int ActiveScans_contains(const ActiveScans* const set, size_t scan) {
+    return scan < set->cap && set->pos[scan] < set->count && set->dense[set->pos[scan]] == scan;
+}
+
+// a final moves the last listed scan into the slot it frees
+static void ActiveScans_apply(ActiveScans* const set, Event event) {
+    if(event.idx >= set->cap) return;
+    uint32_t scan = (uint32_t) event.idx, last;
+    if(event.type == EVENT_START) {
+        if(ActiveScans_contains(set, scan)) return;
+        set->pos[scan] = (uint32_t) set->count;
+        set->dense[set->count++] = scan;
+        return;
+    }
+    if(!ActiveScans_contains(set, scan)) return;
+    last = set->dense[--(set->count)];
+    set->dense[set->pos[scan]] = last;
+    set->pos[last] = set->pos[scan];
+}
+
+// replaces the listed scans with count scans
+static void ActiveScans_load(ActiveScans* const set, const uint32_t scans[], size_t count) {
+    memcpy(set->dense, scans, count * sizeof(uint32_t));
+    for(size_t i = 0; i < count; ++i) set->pos[scans[i]] = (uint32_t) i;
+    set->count = count;
+}
+
+// a streamed schedule only gets its timeline once it's fully loaded, failing to build it just leaves it out
+static void SchedulePass_build_timeline(SchedulePass* const pass, Schedule skd) {
+    if(pass->timeline_built || skd.stream != NULL || skd.scan_index.station_beg == NULL) return;
+    if(StationTimeline_build(&(pass->timeline), skd)) return;
+    StationTimeline_seek(&(pass->timeline), skd, pass->ms);
+    pass->timeline_built = 1;
+}
+
+// while scans are still streaming in, a later scan can't start before the last loaded one
+// so everything up to its start is final
+static TimeMs SchedulePass_playable_until(const SchedulePass* const pass, Schedule skd) {
+    if(skd.stream == NULL) return pass->ms_max;
+    if(skd.scan_count == 0) return 0;
+    return skd.scans.timestamp[skd.scan_count - 1];
+}
+
+// scan i starts and ends observing, calibration runs on after that
+static void scan_events(const ScanTable* scans, size_t i, Event events[2]) {
+    events[0] = (Event) { .idx = i, .ms = scans->timestamp[i], .type = EVENT_START };
+    events[1] = (Event) { .idx = i, .ms = scans->timestamp[i] + (TimeMs) scans->obs_duration[i] * TIME_MS_PER_SEC, .type = EVENT_FINAL };
+}
+
+static TimeMs scan_end(const ScanTable* scans, size_t i) {
+    return scans->timestamp[i] + ((TimeMs) scans->cal_duration[i] + scans->obs_duration[i]) * TIME_MS_PER_SEC;
+}
+
+// every chunk counts its events per digit, then scatters them from its own cursors
+// cursors are laid out chunk by chunk, EVENT_RADIX per chunk
+typedef struct {
+    const Event* src;
+    Event* dst;
+    size_t count, chunk_count;
+    size_t* cursor;
+    TimeMs ms_min;
+    unsigned int shift;
+} EventSortJob;
+
+// ties put starts first, so a zero-length scan never ends before it begins
+static uint64_t event_key(Event event, TimeMs ms_min) {
+    return (uint64_t) (event.ms - ms_min) * 2 + (event.type == EVENT_START ? 0 : 1);
+}
+
+static void event_sort_chunk(EventSortJob* job, size_t chunk, unsigned int scatter) {
+    size_t* cursor = &(job->cursor[chunk * EVENT_RADIX]);
+    size_t i, digit;
+    size_t beg = chunk * job->count / job->chunk_count;
+    size_t end = (chunk + 1) * job->count / job->chunk_count;
+    for(i = beg; i < end; ++i) {
+        digit = (size_t) (event_key(job->src[i], job->ms_min) >> job->shift) & (EVENT_RADIX - 1);
+        if(scatter) job->dst[cursor[digit]++] = job->src[i];
+        else cursor[digit]++;
+    }
+}
+
+static void count_event_chunk(void* ctx, size_t chunk) {
+    event_sort_chunk((EventSortJob*) ctx, chunk, 0);
+}
+
+static void scatter_event_chunk(void* ctx, size_t chunk) {
+    event_sort_chunk((EventSortJob*) ctx, chunk, 1);
+}
+
+// sorts events by time in O(n) passes, large buffers are split across the pool
+// as events are sorted, max_depth (if given) is set to the most scans they ever have running at once
+static unsigned int sort_events(Event* const events, size_t count, size_t* max_depth) {
+    size_t i, depth = 0;
+    if(max_depth != NULL) *max_depth = 0;
+    if(count == 0) return 0;
+    TimeMs ms_min = events[0].ms, ms_max = events[0].ms;
+    unsigned int sorted = 1;
+    for(i = 1; i < count; ++i) {
+        if(events[i].ms < ms_min) ms_min = events[i].ms;
+        if(events[i].ms > ms_max) ms_max = events[i].ms;
+        if(events[i].ms < events[i - 1].ms || (events[i].ms == events[i - 1].ms && events[i].type < events[i - 1].type)) sorted = 0;
+    }
+    if(!sorted) {
+        EventSortJob job = { .src = events, .count = count, .ms_min = ms_min };
+        job.chunk_count = (count >= EVENT_PARALLEL_MIN) ? pool_thread_count() * EVENT_CHUNKS_PER_THREAD : 1;
+        Event* temp = (Event*) malloc(count * sizeof(Event));
+        job.cursor = (size_t*) malloc(job.chunk_count * EVENT_RADIX * sizeof(size_t));
+        if(temp == NULL || job.cursor == NULL) {
+            LOG_ERROR("Unable to allocate scratch space to sort events.");
+            free(temp);
+            free(job.cursor);
+            return 1;
+        }
+        job.dst = temp;
+        // only as many digits as the latest event's key has
+        uint64_t key_max = (uint64_t) (ms_max - ms_min) * 2 + 1;
+        size_t digit, chunk, total, *cursor;
+        Event* swap;
+        for(job.shift = 0; job.shift < 64 && (key_max >> job.shift) != 0; job.shift += EVENT_RADIX_BITS) {
+            memset(job.cursor, 0, job.chunk_count * EVENT_RADIX * sizeof(size_t));
+            pool_run(job.chunk_count, count_event_chunk, &job);
+            // each chunk's share of a digit follows the previous chunk's, which keeps the passes stable
+            for(digit = 0, total = 0; digit < EVENT_RADIX; ++digit) {
+                for(chunk = 0; chunk < job.chunk_count; ++chunk) {
+                    cursor = &(job.cursor[chunk * EVENT_RADIX + digit]);
+                    i = *cursor;
+                    *cursor = total;
+                    total += i;
+                }
+                // a digit every event shares doesn't reorder anything
+                if(total == count && job.cursor[digit] == 0) break;
+            }
+            if(digit < EVENT_RADIX) continue;
+            pool_run(job.chunk_count, scatter_event_chunk, &job);
+            swap = (Event*) job.src;
+            job.src = job.dst;
+            job.dst = swap;
         }
+        if(job.src != events) memcpy(events, job.src, count * sizeof(Event));
+        free(temp);
+        free(job.cursor);
+    }
+    if(max_depth == NULL) return 0;
+    for(i = 0; i < count; ++i) {
+        depth = (events[i].type == EVENT_START) ? depth + 1 : depth - 1;
+        if(depth > *max_depth) *max_depth = depth;
+    }
+    return 0;
+}
+
+// fills pts with every station (z = 0) followed by every source (z = 1)
+// returns the number of points written
+static size_t fill_points(Schedule skd, GLfloat pts[]) {
+    size_t i, j;
+    const Station* ant;
+    for(i = 0, j = 0; i < skd.station_count; ++i) {
+        ant = &(skd.stations[i]);
+        if(ant->pos.name[0] == '\0') {
+            LOG_INFO("Skipping a station while building SchedulePass. Schedule might not have been validated.");
+            continue;
+        }
+        pts[j * 3 + 0] = (GLfloat) ant->pos.lam;
+        pts[j * 3 + 1] = (GLfloat) ant->pos.phi;
+        pts[j * 3 + 2] = (GLfloat) 0.f;
+        j++;
+    }
+    const Source* src;
+    for(i = 0; i < skd.source_count; ++i, ++j) {
+        src = &(skd.sources[i]);
+        pts[j * 3 + 0] = (GLfloat) src->point.alf;
+        pts[j * 3 + 1] = (GLfloat) src->point.phi;
+        pts[j * 3 + 2] = (GLfloat) 1.f;
     }
+    return j;
 }
+
 SchedulePass* SchedulePass_init_from_schedule(SchedulePassDesc desc, Schedule skd) {
     unsigned int failure;
     // configure shader program and set constant uniforms
@@ -86,43 +298,14 @@ SchedulePass* SchedulePass_init_from_schedule(SchedulePassDesc desc, Schedule sk
     }
     glUniform1f(loc, (GLfloat) desc.shell_radius);
     // build array of stations and sources
-    size_t i, j, pts_count = skd.stations_pos.size + skd.sources.size;
-    GLfloat pts[pts_count * 3];
-    Node* node;
-    char ant_id[3];
-    NamedPoint* ant;
-    for(i = 0, j = 0; i < skd.stations_ant.bucket_count; ++i) {
-        node = skd.stations_ant.buckets[i];
-        for(; node != NULL; node = node->next, ++j) {
-            strcpy(ant_id, (char*) Node_value(node));
-            ant = (NamedPoint*) HashMap_get(skd.stations_pos, ant_id);
-            if(ant == NULL) {
-                LOG_INFO("Skipping a station while building SchedulePass. Schedule might not have been validated.");
-                pts_count--;
-                j--;
-                continue;
-            }
-            pts[j * 3 + 0] = (GLfloat) ant->lam;
-            pts[j * 3 + 1] = (GLfloat) ant->phi;
-            pts[j * 3 + 2] = (GLfloat) 0.f;
-        }
-    }
-    NamedPoint* src;
-    for(i = 0; i < skd.sources.bucket_count; ++i) {
-        node = skd.sources.buckets[i];
-        for(; node != NULL; node = node->next, ++j) {
-            src = (NamedPoint*) HashMap_get(skd.sources, node->contents);
-            if(src == NULL) {
-                LOG_INFO("Skipping a quasar source while building SchedulePass. Schedule might not have been validated.");
-                pts_count--;
-                j--;
-                continue;
-            }
-            pts[j * 3 + 0] = (GLfloat) src->alf;
-            pts[j * 3 + 1] = (GLfloat) src->phi;
-            pts[j * 3 + 2] = (GLfloat) 1.f;
-        }
+    size_t pts_count = skd.station_count + skd.source_count;
+    GLfloat* pts = (GLfloat*) malloc((pts_count * 3 + 1) * sizeof(GLfloat));
+    if(pts == NULL) {
+        LOG_ERROR("Unable to allocate station and source markers in SchedulePass.");
+        glDeleteProgram(shader_program);
+        return NULL;
     }
+    pts_count = fill_points(skd, pts);
     // configure vertex arrays and buffers
     GLuint VAO[2], VBO[2];
     glGenVertexArrays(2, VAO);
@@ -132,6 +315,7 @@ SchedulePass* SchedulePass_init_from_schedule(SchedulePassDesc desc, Schedule sk
     size_t buffer_size;
     buffer_size = pts_count * 3 * sizeof(GLfloat);
     glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) buffer_size, pts, GL_STATIC_DRAW);
+    free(pts);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, (GLvoid*) 0);
     glEnableVertexAttribArray(0);
     glUseProgram(shader_program);
@@ -150,10 +334,11 @@ SchedulePass* SchedulePass_init_from_schedule(SchedulePassDesc desc, Schedule sk
     }
     glUniform3f(loc, desc.color_src[0], desc.color_src[1], desc.color_src[2]);
     glUseProgram(0);
-    // set up Scan pointer vector buffers
+    // set up Scan pointer vector buffers, with room for a scan with every station
+    // the buffer is respecified as each scan is drawn
     glBindVertexArray(VAO[1]);
     glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-    buffer_size *= skd.stations_ant.size * 6 * sizeof(GLfloat);
+    buffer_size = skd.station_count * 6 * sizeof(GLfloat);
     glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) buffer_size, NULL, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, (GLvoid*) 0);
     glEnableVertexAttribArray(0);
@@ -172,65 +357,202 @@ SchedulePass* SchedulePass_init_from_schedule(SchedulePassDesc desc, Schedule sk
     pass->VBO[1] = VBO[1];
     pass->shader_program = shader_program;
     pass->pts_count = pts_count;
-    // find jd_max
-    ScanFAM* current = Schedule_get_scan(skd, 0);
-    pass->jd = Datetime_to_jd(current->timestamp);
-    Datetime last_start = current->timestamp;
-    Datetime last_final = Datetime_add_seconds(last_start, current->cal_duration + current->obs_duration);
-    Datetime temp_start, temp_final;
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wtype-limits"
-    for(size_t i = skd.scan_count; (--i) >= 0;) {
-        current = Schedule_get_scan(skd, i);
-        temp_final = Datetime_add_seconds(current->timestamp, current->cal_duration + current->obs_duration);
-        if(Datetime_to_jd(last_final) < Datetime_to_jd(temp_final)) {
-            last_start = current->timestamp;
-            last_final = temp_final;
-        }
-        if(Datetime_to_jd(temp_final) > Datetime_to_jd(last_start)) break;
-    }
-#pragma GCC diagnostic pop
-    pass->jd_max = Datetime_to_jd(last_final);
-    // build and sort Event buffer
+    pass->scratch_cap = 0;
+    pass->line_count = 0;
+    pass->vec = NULL;
+    pass->lines_until = 0;
+    pass->lines_dirty = 1;
+    pass->keyframe_cap = 0;
+    pass->keyframe_valid = 0;
+    pass->keyframe_width = 0;
+    pass->keyframe_events = KEYFRAME_EVENTS;
+    pass->keyframes = NULL;
+    // build and sort Event buffer for the scans which have been loaded so far
+    pass->ms = 0;
+    pass->ms_max = 0;
     pass->event_idx = 0;
-    pass->events = (Event*) malloc(skd.scan_count * 2 * sizeof(Event));
+    pass->event_count = skd.scan_count * 2;
+    pass->event_cap = pass->event_count;
+    pass->scan_count = skd.scan_count;
+    pass->active = (ActiveScans) { .count = 0, .cap = 0, .dense = NULL, .pos = NULL };
+    pass->events = (Event*) malloc((pass->event_cap + 1) * sizeof(Event));
     if(pass->events == NULL) {
         LOG_ERROR("Unable to allocate Event buffer in SchedulePass.");
-        glDeleteProgram(shader_program);
-        glDeleteVertexArrays(2, VAO);
-        glDeleteBuffers(2, VBO);
-        return NULL;
+        goto fail;
     }
+    const ScanTable* scans = &(skd.scans);
     for(size_t i = 0; i < skd.scan_count; ++i) {
-        current = Schedule_get_scan(skd, i);
-        temp_start = current->timestamp;
-        pass->events[i * 2 + 0] = (Event) { .idx = i, .jd = Datetime_to_jd(temp_start), .type = EVENT_START };
-        temp_final = Datetime_add_seconds(temp_start, current->obs_duration);
-        pass->events[i * 2 + 1] = (Event) { .idx = i, .jd = Datetime_to_jd(temp_final), .type = EVENT_FINAL };
-    }
-    sort_event_buffer(pass->events, skd.scan_count);
-    size_t max_active_scans = 0;
-    for(size_t i = 0, j = 0; i < skd.scan_count * 2; ++i) {
-        j = (pass->events[i].type == EVENT_START) ? j + 1 : j - 1;
-        if(j > max_active_scans) max_active_scans = j;
+        scan_events(scans, i, &(pass->events[i * 2]));
+        if(scan_end(scans, i) > pass->ms_max) pass->ms_max = scan_end(scans, i);
     }
+    if(skd.scan_count > 0) pass->ms = scans->timestamp[0];
+    size_t max_active_scans;
+    if(sort_events(pass->events, pass->event_count, &max_active_scans)) goto fail;
     pass->max_active_scans = max_active_scans;
-    // allocate buffer for active scan indices
-    pass->active_scans = (ssize_t*) malloc(max_active_scans * sizeof(ssize_t));
-    if(pass->active_scans == NULL) {
-        LOG_ERROR("Failed to allocate active scan buffer in SchedulePass.");
-        glDeleteProgram(shader_program);
-        glDeleteVertexArrays(2, VAO);
-        glDeleteBuffers(2, VBO);
-        free(pass->events);
-        return NULL;
-    }
-    for(size_t i = 0; i < max_active_scans; ++i) pass->active_scans[i] = (ssize_t) -1;
+    // allocate the set of active scans
+    if(ActiveScans_reserve(&(pass->active), skd.scan_count)) goto fail;
+    pass->ms_loaded = SchedulePass_playable_until(pass, skd);
+    memset(&(pass->timeline), 0, sizeof(StationTimeline));
+    pass->timeline_built = 0;
+    SchedulePass_build_timeline(pass, skd);
     // tracking program state
     pass->paused = 1;
     pass->restarted = 1;
     pass->clock_speed = CLOCK_SPEED_DEFAULT;
     return pass;
+fail:
+    // everything allocated after pass is released here
+    glDeleteProgram(shader_program);
+    glDeleteVertexArrays(2, VAO);
+    glDeleteBuffers(2, VBO);
+    free(pass->events);
+    free(pass->active.dense);
+    free(pass->active.pos);
+    free(pass);
+    return NULL;
+}
+
+static unsigned int SchedulePass_reserve_events(SchedulePass* const pass, size_t event_cap) {
+    if(event_cap <= pass->event_cap) return 0;
+    if(event_cap < pass->event_cap * 2) event_cap = pass->event_cap * 2;
+    Event* temp = (Event*) realloc(pass->events, (event_cap + 1) * sizeof(Event));
+    if(temp == NULL) {
+        LOG_ERROR("Unable to grow Event buffer in SchedulePass.");
+        return 1;
+    }
+    pass->events = temp;
+    pass->event_cap = event_cap;
+    return 0;
+}
+
+// builds the events of scans [beg, beg + count) and merges them into the sorted event buffer
+// new events before the current playback time are applied to the active scans right away
+static unsigned int SchedulePass_merge_events(SchedulePass* const pass, Schedule skd, size_t beg, size_t count) {
+    if(count == 0) return 0;
+    size_t i;
+    if(SchedulePass_reserve_events(pass, pass->event_count + count * 2)) return 1;
+    // build and sort the new events
+    Event* batch = &(pass->events[pass->event_count]);
+    const ScanTable* scans = &(skd.scans);
+    for(i = 0; i < count; ++i) {
+        scan_events(scans, beg + i, &(batch[i * 2]));
+        if(scan_end(scans, beg + i) > pass->ms_max) pass->ms_max = scan_end(scans, beg + i);
+    }
+    if(sort_events(batch, count * 2, NULL)) return 1;
+    size_t played = 0;
+    while(played < count * 2 && batch[played].ms < pass->ms) played++;
+    // only existing events later than the batch's first need to be merged with it
+    size_t lo = 0, hi = pass->event_count, mid;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(pass->events[mid].ms <= batch[0].ms) lo = mid + 1; else hi = mid;
+    }
+    // scratch space to merge the batch with the tail
+    size_t tail = pass->event_count - lo, depth = 0, max_active_scans = pass->max_active_scans;
+    if(SchedulePass_reserve_events(pass, pass->event_count + count * 4 + tail)) return 1;
+    batch = &(pass->events[pass->event_count]);
+    // the tail's unmatched finals are the scans still active at the merge point
+    for(i = lo; i < pass->event_count; ++i) depth += (pass->events[i].type == EVENT_FINAL) ? 1 : 0;
+    depth -= tail - depth;
+    // ties keep existing events first, so played events still form a prefix of the merged buffer
+    Event* merged = &(batch[count * 2]);
+    size_t a = lo, b = 0, k = 0, event_idx = (pass->event_idx < lo) ? pass->event_idx : lo;
+    while(a < pass->event_count || b < count * 2) {
+        if(b == count * 2 || (a < pass->event_count && pass->events[a].ms <= batch[b].ms)) {
+            if(a < pass->event_idx) event_idx++;
+            merged[k] = pass->events[a++];
+        } else {
+            if(b < played) event_idx++;
+            merged[k] = batch[b++];
+        }
+        depth = (merged[k++].type == EVENT_START) ? depth + 1 : depth - 1;
+        if(depth > max_active_scans) max_active_scans = depth;
+    }
+    // make room for the new scans
+    if(ActiveScans_reserve(&(pass->active), beg + count)) return 1;
+    pass->max_active_scans = max_active_scans;
+    for(i = 0; i < played; ++i) ActiveScans_apply(&(pass->active), batch[i]);
+    if(played > 0) pass->lines_dirty = 1;
+    memmove(&(pass->events[lo]), merged, k * sizeof(Event));
+    pass->event_count = lo + k;
+    pass->event_idx = event_idx;
+    // keyframes only depend on the events before them
+    if(pass->keyframe_valid > lo / pass->keyframe_events + 1) pass->keyframe_valid = lo / pass->keyframe_events + 1;
+    return 0;
+}
+
+unsigned int SchedulePass_sync(SchedulePass* const pass, Schedule skd) {
+    if(skd.scan_count > pass->scan_count) {
+        if(pass->scan_count == 0) pass->ms = skd.scans.timestamp[0];
+        if(SchedulePass_merge_events(pass, skd, pass->scan_count, skd.scan_count - pass->scan_count)) return 1;
+        pass->scan_count = skd.scan_count;
+    }
+    pass->ms_loaded = SchedulePass_playable_until(pass, skd);
+    SchedulePass_build_timeline(pass, skd);
+    return 0;
+}
+
+unsigned int SchedulePass_reload(SchedulePass* const pass, Schedule skd, ScheduleDiff diff) {
+    size_t i, k, played = 0;
+    // station and source markers only need to be rebuilt when their sections changed
+    if(diff.stations || diff.sources) {
+        size_t pts_count = skd.station_count + skd.source_count;
+        GLfloat* pts = (GLfloat*) malloc((pts_count * 3 + 1) * sizeof(GLfloat));
+        if(pts == NULL) {
+            LOG_ERROR("Unable to allocate station and source markers in SchedulePass.");
+            return 1;
+        }
+        pts_count = fill_points(skd, pts);
+        glBindBuffer(GL_ARRAY_BUFFER, pass->VBO[0]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (pts_count * 3 * sizeof(GLfloat)), pts, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        free(pts);
+        pass->pts_count = pts_count;
+    }
+    // drop the events of replaced scans and renumber the scans after them
+    size_t removed_end = diff.first + diff.removed;
+    Event current;
+    for(i = 0, k = 0; i < pass->event_count; ++i) {
+        current = pass->events[i];
+        if(current.idx >= diff.first && current.idx < removed_end) {
+            if(i < pass->event_idx) played++;
+            continue;
+        }
+        if(current.idx >= removed_end) current.idx = current.idx - diff.removed + diff.added;
+        pass->events[k++] = current;
+    }
+    pass->event_count = k;
+    pass->event_idx -= played;
+    // every keyframe may hold renumbered scans, and so might the lines
+    pass->keyframe_valid = 0;
+    pass->lines_dirty = 1;
+    if(ActiveScans_reserve(&(pass->active), skd.scan_count)) return 1;
+    uint32_t* dense = pass->active.dense;
+    size_t idx, count = 0;
+    for(i = 0; i < pass->active.count; ++i) {
+        idx = dense[i];
+        if(idx >= diff.first && idx < removed_end) continue;
+        if(idx >= removed_end) idx = idx - diff.removed + diff.added;
+        pass->active.pos[idx] = (uint32_t) count;
+        dense[count++] = (uint32_t) idx;
+    }
+    pass->active.count = count;
+    // any of the removed scans might have been the last to end
+    const ScanTable* scans = &(skd.scans);
+    pass->ms_max = 0;
+    for(i = 0; i < skd.scan_count; ++i) {
+        if(scan_end(scans, i) > pass->ms_max) pass->ms_max = scan_end(scans, i);
+    }
+    // playback time is kept, unless there was nothing to play before
+    if(pass->scan_count == 0 && skd.scan_count > 0) pass->ms = scans->timestamp[0];
+    if(SchedulePass_merge_events(pass, skd, diff.first, diff.added)) return 1;
+    pass->scan_count = skd.scan_count;
+    pass->ms_loaded = SchedulePass_playable_until(pass, skd);
+    // the stations' scans and downtime may all have moved
+    if(pass->timeline_built) StationTimeline_free(pass->timeline);
+    pass->timeline_built = 0;
+    SchedulePass_build_timeline(pass, skd);
+    return 0;
 }
 
 void SchedulePass_free(const SchedulePass* const pass) { 
@@ -238,42 +560,168 @@ void SchedulePass_free(const SchedulePass* const pass) {
     glDeleteVertexArrays(2, pass->VAO);
     glDeleteBuffers(2, pass->VBO);
     free(pass->events);
-    free(pass->active_scans);
+    free(pass->active.dense);
+    free(pass->active.pos);
+    free(pass->vec);
+    free(pass->keyframes);
+    if(pass->timeline_built) StationTimeline_free(pass->timeline);
     free((SchedulePass*) pass);
 }
 
-unsigned int render_current_scan(Schedule skd, size_t idx, unsigned char mask[]) {
-    ScanFAM* current = Schedule_get_scan(skd, idx);
-    NamedPoint* src;
-    char* id;
-    id = (char*) HashMap_get(skd.sources_alias, current->source);
-    src = (NamedPoint*) ((id == NULL) ? HashMap_get(skd.sources, current->source) : HashMap_get(skd.sources, id));
-    if(src == NULL) return 0;
-    // build observation geometry
-    size_t i, j, ant_count = strlen(current->ids);
-    GLfloat vec[ant_count * 6];
-    NamedPoint* ant;
-    char key[2]; key[1] = '\0';
-    for(i = 0, j = 0; i < ant_count; ++i) {
-        if(mask[i] == (unsigned char) 0) continue;
-        key[0] = current->ids[i];
-        id = (char*) HashMap_get(skd.stations_ant, key);
-        Overlay_add_station(id);
-        // printf("%s\n", id);
-        ant = (NamedPoint*) HashMap_get(skd.stations_pos, id);
-        vec[j++] = (GLfloat) ant->lam;
-        vec[j++] = (GLfloat) ant->phi;
-        vec[j++] = (GLfloat) 0.f;
-        vec[j++] = (GLfloat) src->alf;
-        vec[j++] = (GLfloat) src->phi;
-        vec[j++] = (GLfloat) 1.f;
-    }
-    size_t buffer_size = j * sizeof(GLfloat);
-    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) buffer_size, vec, GL_DYNAMIC_DRAW);
-    glDrawArrays(GL_LINES, 0, (GLsizei) (j / 2));
-    return 1;
+// rebuilds the keyframes which are out of date, up to the one covering event
+// each is replayed from the one before it, so only the stale ones cost anything
+static unsigned int SchedulePass_update_keyframes(SchedulePass* const pass, size_t event) {
+    size_t i, k, width = pass->max_active_scans;
+    // keyframes are laid out width + 1 apart, so they're rebuilt once more scans run at once
+    if(width != pass->keyframe_width) {
+        pass->keyframe_valid = 0;
+        pass->keyframe_width = width;
+        pass->keyframe_events = (width > KEYFRAME_EVENTS) ? width : KEYFRAME_EVENTS;
+        pass->keyframe_cap = 0;
+    }
+    size_t step = pass->keyframe_events, needed = event / step + 1;
+    if(needed > pass->keyframe_cap) {
+        size_t cap = (pass->keyframe_cap * 2 > needed) ? pass->keyframe_cap * 2 : needed;
+        uint32_t* keyframes = (uint32_t*) realloc(pass->keyframes, (cap * (width + 1) + 1) * sizeof(uint32_t));
+        if(keyframes == NULL) {
+            LOG_ERROR("Unable to grow keyframes in SchedulePass.");
+            return 1;
+        }
+        pass->keyframes = keyframes;
+        pass->keyframe_cap = cap;
+    }
+    // the active scans are replayed in place, the seek which asked for the keyframes overwrites them anyway
+    uint32_t *keyframe, *prev;
+    for(k = pass->keyframe_valid; k < needed; ++k) {
+        keyframe = &(pass->keyframes[k * (width + 1)]);
+        if(k == 0) {
+            keyframe[0] = 0;
+            continue;
+        }
+        prev = &(pass->keyframes[(k - 1) * (width + 1)]);
+        ActiveScans_load(&(pass->active), &(prev[1]), prev[0]);
+        for(i = (k - 1) * step; i < k * step; ++i) ActiveScans_apply(&(pass->active), pass->events[i]);
+        keyframe[0] = (uint32_t) pass->active.count;
+        memcpy(&(keyframe[1]), pass->active.dense, pass->active.count * sizeof(uint32_t));
+    }
+    if(needed > pass->keyframe_valid) pass->keyframe_valid = needed;
+    return 0;
 }
 
+// index of the first event later than ms, or at ms too if inclusive is 0
+static size_t SchedulePass_find_event(const SchedulePass* const pass, TimeMs ms, unsigned int inclusive) {
+    size_t lo = 0, hi = pass->event_count, mid;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(pass->events[mid].ms < ms || (inclusive && pass->events[mid].ms == ms)) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+unsigned int SchedulePass_seek(SchedulePass* const pass, Schedule skd, TimeMs ms) {
+    if(pass->event_count == 0) return 0;
+    // playback can't run ahead of the scans loaded so far
+    TimeMs ms_end = (skd.stream != NULL) ? pass->ms_loaded : pass->ms_max;
+    if(ms > ms_end) ms = ms_end;
+    if(ms < pass->events[0].ms) ms = pass->events[0].ms;
+    // events at ms have been played, just as after a frame that ends at ms
+    size_t i, event = SchedulePass_find_event(pass, ms, 1);
+    if(SchedulePass_update_keyframes(pass, event)) return 1;
+    size_t k = event / pass->keyframe_events;
+    const uint32_t* keyframe = &(pass->keyframes[k * (pass->keyframe_width + 1)]);
+    ActiveScans_load(&(pass->active), &(keyframe[1]), keyframe[0]);
+    for(i = k * pass->keyframe_events; i < event; ++i) ActiveScans_apply(&(pass->active), pass->events[i]);
+    pass->event_idx = event;
+    pass->ms = ms;
+    pass->restarted = 0;
+    pass->lines_dirty = 1;
+    if(pass->timeline_built) StationTimeline_seek(&(pass->timeline), skd, ms);
+    return 0;
+}
+
+// seeks to the start of the next scan after the playback time, or of the last one before it
+static unsigned int SchedulePass_step(SchedulePass* const pass, Schedule skd, unsigned int forward) {
+    size_t i;
+    if(forward) {
+        for(i = SchedulePass_find_event(pass, pass->ms, 1); i < pass->event_count; ++i) {
+            if(pass->events[i].type == EVENT_START) return SchedulePass_seek(pass, skd, pass->events[i].ms);
+        }
+    } else {
+        for(i = SchedulePass_find_event(pass, pass->ms, 0); i > 0; --i) {
+            if(pass->events[i - 1].type == EVENT_START) return SchedulePass_seek(pass, skd, pass->events[i - 1].ms);
+        }
+    }
+    return 0;
+}
+
+// grows the pointing vectors to hold count stations
+static unsigned int SchedulePass_reserve_scratch(SchedulePass* const pass, size_t count) {
+    if(count <= pass->scratch_cap) return 0;
+    GLfloat* vec = (GLfloat*) realloc(pass->vec, (count * 6 + 1) * sizeof(GLfloat));
+    if(vec == NULL) return 1;
+    pass->vec = vec;
+    pass->scratch_cap = count;
+    return 0;
+}
+
+// uploads a line from every station which is still observing to its scan's source, and lists both in the Overlay
+// VBO[1] must be bound
+static void SchedulePass_build_lines(SchedulePass* const pass, Schedule skd) {
+    const ScanTable* scans = &(skd.scans);
+    const NamedPoint* src;
+    const Station* ant;
+    size_t i, j, k, idx, count = 0;
+    TimeMs until = INT64_MAX, expiry;
+    for(i = 0; i < pass->active.count; ++i) {
+        idx = pass->active.dense[i];
+        count += scans->station_beg[idx + 1] - scans->station_beg[idx];
+    }
+    pass->line_count = 0;
+    if(SchedulePass_reserve_scratch(pass, count)) {
+        LOG_ERROR("Unable to grow scan buffers in SchedulePass. Skipping scans.");
+        return;
+    }
+#ifndef NO_UI
+    Overlay_clear_lists();
+#endif
+    for(i = 0, k = 0; i < pass->active.count; ++i) {
+        idx = pass->active.dense[i];
+        if(scans->source[idx] >= skd.source_count) continue;
+#ifndef NO_UI
+        Overlay_add_active_scan(skd.sources[scans->source[idx]].iau);
+#endif
+        src = &(skd.sources[scans->source[idx]].point);
+        for(j = scans->station_beg[idx]; j < scans->station_beg[idx + 1]; ++j) {
+            expiry = scans->timestamp[idx] + (TimeMs) scans->offsets[j] * TIME_MS_PER_SEC;
+            if(pass->ms >= expiry) continue;
+            if(expiry < until) until = expiry;
+            ant = &(skd.stations[scans->stations[j]]);
+#ifndef NO_UI
+            Overlay_add_station(ant->id);
+#endif
+            pass->vec[k++] = (GLfloat) ant->pos.lam;
+            pass->vec[k++] = (GLfloat) ant->pos.phi;
+            pass->vec[k++] = (GLfloat) 0.f;
+            pass->vec[k++] = (GLfloat) src->alf;
+            pass->vec[k++] = (GLfloat) src->phi;
+            pass->vec[k++] = (GLfloat) 1.f;
+        }
+    }
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (k * sizeof(GLfloat)), pass->vec, GL_DYNAMIC_DRAW);
+    pass->line_count = k / 3;
+    pass->lines_until = until;
+    pass->lines_dirty = 0;
+}
+
+#ifndef NO_UI
+// how far playback is through the session, from the first event to the end of the last scan
+static float SchedulePass_progress(const SchedulePass* const pass) {
+    if(pass->event_count == 0 || pass->ms_max <= pass->events[0].ms) return 0.f;
+    double progress = (double) (pass->ms - pass->events[0].ms) / (double) (pass->ms_max - pass->events[0].ms);
+    return (float) ((progress > 1.0) ? 1.0 : progress);
+}
+#endif
+
 long long get_time_ms() {
 #ifdef _WIN32
     FILETIME ft;
@@ -290,23 +738,32 @@ long long get_time_ms() {
 }
 
 void SchedulePass_update_and_draw(SchedulePass* const pass, Schedule skd, const Camera* const cam) {
-    // update timestamp and get the change in jd
+    // update timestamp and get the change in playback time
     unsigned long long temp = pass->clock;
-    pass->clock = get_time_ms();
+    pass->clock = (unsigned long long) get_time_ms();
     unsigned long long temp_speed = (1 << pass->clock_speed);
     temp = (pass->clock - temp) * temp_speed;
-    double dt = (double) temp / 86400000.0;
-    // printf("%.15lf\n", dt1);
-    // double dt = 0.000075f;
-    // get current greenwich sidereal time (degrees)
-    double gmst = jd2gmst(pass->jd);
+    TimeMs dt = (TimeMs) temp;
+    // hold playback at the last loaded scan until the rest are streamed in
+    if(skd.stream != NULL && pass->ms + dt > pass->ms_loaded) dt = (pass->ms < pass->ms_loaded) ? pass->ms_loaded - pass->ms : 0;
+    // get current julian date and greenwich sidereal time (degrees)
+    double jd = TimeMs_to_jd(pass->ms);
+    double gmst = jd2gmst(jd);
 #ifndef NO_UI
     // update OverlayControls
     OverlayControls controls = (OverlayControls) {
-        .jd = pass->jd,
+        .jd = jd,
         .gmst = gmst,
         .speed = temp_speed,
         .paused = pass->paused,
+        .scan_count = pass->scan_count,
+        .loading = skd.stream != NULL,
+        .progress = SchedulePass_progress(pass),
+        .observing = pass->timeline.counts[STATION_ON_SOURCE],
+        .calibrating = pass->timeline.counts[STATION_CALIBRATING],
+        .slewing = pass->timeline.counts[STATION_SLEWING],
+        .idle = pass->timeline.counts[STATION_IDLE],
+        .down = pass->timeline.counts[STATION_DOWN],
     };
     Overlay_set_controls(controls);
 #endif
@@ -319,10 +776,8 @@ void SchedulePass_update_and_draw(SchedulePass* const pass, Schedule skd, const
     glUniform1f(glGetUniformLocation(pass->shader_program, "gmst"), (float) gmst);
     glBindVertexArray(pass->VAO[0]);    
     glDrawArrays(GL_POINTS, 0, (GLsizei) pass->pts_count);
-    // forward declare some shared variables
-    ScanFAM* current; size_t i, j, k = 0;
     // check if the entire schedule was rendered
-    if(pass->jd > pass->jd_max) {
+    if(pass->ms > pass->ms_max) {
         glBindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glUseProgram(0);
@@ -333,49 +788,28 @@ void SchedulePass_update_and_draw(SchedulePass* const pass, Schedule skd, const
         // render each set of pointing vectors
         if(!(pass->paused)) {
             Event current;
-            for(; pass->event_idx < (skd.scan_count * 2); ++(pass->event_idx)) {
+            for(; pass->event_idx < pass->event_count; ++(pass->event_idx)) {
                 current = pass->events[pass->event_idx];
-                if(current.jd > (pass->jd + dt)) break;
-                update_active_scans(pass->active_scans, pass->max_active_scans, current);
-            }
-        }
-        unsigned char mask[skd.stations_ant.size];
-        Datetime start_with_offset;
-        for(i = 0, k = 0; i < pass->max_active_scans; ++i) {
-            if(pass->active_scans[i] == -1) continue;
-            current = Schedule_get_scan(skd, (size_t) pass->active_scans[i]);
-            for(j = 0; j < strlen(current->ids); ++j) {
-                start_with_offset = Datetime_add_seconds(current->timestamp, current->scan_offsets[j]);
-                mask[j] = (pass->jd < Datetime_to_jd(start_with_offset)) ? 1 : 0;
+                if(current.ms > (pass->ms + dt)) break;
+                ActiveScans_apply(&(pass->active), current);
+                pass->lines_dirty = 1;
             }
-            render_current_scan(skd, (size_t) pass->active_scans[i], mask);
-            k++;
+            if(pass->timeline_built) StationTimeline_advance(&(pass->timeline), skd, pass->ms + dt);
         }
+        // between changes the uploaded lines are drawn as they are
+        if(pass->lines_dirty || pass->ms >= pass->lines_until) SchedulePass_build_lines(pass, skd);
+        if(pass->line_count > 0) glDrawArrays(GL_LINES, 0, (GLsizei) pass->line_count);
         // restore OpenGL state 
         glBindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glUseProgram(0);
         glDisable(GL_DEPTH_TEST);
     }
-#ifndef NO_UI
-    // push currently active sources to OverlayState
-    NamedPoint* src;
-    char* id;
-    for(size_t i = 0; i < pass->max_active_scans; ++i) {
-        if(pass->active_scans[i] == -1) continue;
-        current = Schedule_get_scan(skd, (size_t) pass->active_scans[i]);
-        id = (char*) HashMap_get(skd.sources_alias, current->source);
-        src = (NamedPoint*) ((id == NULL) ? HashMap_get(skd.sources, current->source) : HashMap_get(skd.sources, id));
-        if(src == NULL) continue;
-        Overlay_add_active_scan((id == NULL) ? current->source : id);
-    }
-#endif
-    // increment current julian date timestamp
-    if(!(pass->paused) && pass->jd <= pass->jd_max) pass->jd += dt;
+    // advance playback time
+    if(!(pass->paused) && pass->ms <= pass->ms_max) pass->ms += dt;
 }
 
 void SchedulePass_handle_action(SchedulePass* const pass, Schedule skd, const OverlayAction act) {
-    ScanFAM* current;
     switch(act) {
         case ACTION_SKD_PASS_FASTER:
             if(pass->clock_speed < CLOCK_SPEED_MAX) pass->clock_speed += 1;
@@ -389,12 +823,26 @@ void SchedulePass_handle_action(SchedulePass* const pass, Schedule skd, const Ov
             break;
         case ACTION_SKD_PASS_RESET:
             pass->event_idx = 0;
-            for(size_t i = 0; i < pass->max_active_scans; ++i) pass->active_scans[i] = -1;
-            current = Schedule_get_scan(skd, 0);
-            pass->jd = Datetime_to_jd(current->timestamp);
+            pass->active.count = 0;
+            pass->lines_dirty = 1;
+            if(skd.scan_count > 0) pass->ms = skd.scans.timestamp[0];
+            if(pass->timeline_built) StationTimeline_seek(&(pass->timeline), skd, pass->ms);
             pass->paused = 1;
             pass->restarted = 1;
             break;
+        case ACTION_SKD_PASS_NEXT:
+            SchedulePass_step(pass, skd, 1);
+            break;
+        case ACTION_SKD_PASS_PREV:
+            SchedulePass_step(pass, skd, 0);
+            break;
+#ifndef NO_UI
+        case ACTION_SKD_PASS_SEEK:
+            if(pass->event_count == 0) break;
+            SchedulePass_seek(pass, skd, pass->events[0].ms + \
+                (TimeMs) ((double) Overlay_get_seek() * (double) (pass->ms_max - pass->events[0].ms)));
+            break;
+#endif
         default: return;
     }
 }
@@ -417,6 +865,12 @@ void SchedulePass_handle_input(SchedulePass* const pass, Schedule skd, const RGF
                 break;
             case RGFW_r:
                 SchedulePass_handle_action(pass, skd, ACTION_SKD_PASS_RESET);
+                break;
+            case RGFW_comma:
+                SchedulePass_handle_action(pass, skd, ACTION_SKD_PASS_PREV);
+                break;
+            case RGFW_period:
+                SchedulePass_handle_action(pass, skd, ACTION_SKD_PASS_NEXT);
             default: break;
         }
     }
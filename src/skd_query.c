@@ -0,0 +1,111 @@
+#include "skd_query.h"
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void StationSet_clear(StationSet* set) {
+    memset(set, 0, sizeof(StationSet));
+}
+
+unsigned int StationSet_add(StationSet* set, Schedule skd, const char* name) {
+    const Station* station = Schedule_find_station(skd, name);
+    if(station == NULL) return 1;
+    size_t idx = (size_t) (station - skd.stations);
+    set->words[idx / STATION_SET_WORD_BITS] |= (uint64_t) 1 << (idx % STATION_SET_WORD_BITS);
+    return 0;
+}
+
+// a scan matches if ((set & mask) ^ want) is zero in every word
+#define MATCH_EMIT(idx) do { if(matches != NULL) matches[found] = (idx); found++; } while(0)
+static size_t match_station_sets(ScanTable scans, size_t scan_count, const uint64_t mask[], const uint64_t want[], size_t* matches) {
+    const uint64_t* sets = scans.station_sets;
+    size_t i = 0, w, words = scans.set_words, found = 0;
+    uint64_t diff;
+#ifdef __SSE2__
+    // schedules with up to 128 stations compare one vector per step, which holds two scans while they fit in a word
+    if(words == 1 || words == 2) {
+        __m128i vmask = (words == 1) ? _mm_set1_epi64x((long long) mask[0]) : _mm_set_epi64x((long long) mask[1], (long long) mask[0]);
+        __m128i vwant = (words == 1) ? _mm_set1_epi64x((long long) want[0]) : _mm_set_epi64x((long long) want[1], (long long) want[0]);
+        __m128i zero = _mm_setzero_si128(), x;
+        int equal;
+        size_t step = 2 / words;
+        for(; i + step <= scan_count; i += step) {
+            x = _mm_loadu_si128((const __m128i*) &(sets[i * words]));
+            equal = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_xor_si128(_mm_and_si128(x, vmask), vwant), zero));
+            if(step == 1) {
+                if(equal == 0xFFFF) MATCH_EMIT(i);
+            } else {
+                if((equal & 0xFF) == 0xFF) MATCH_EMIT(i);
+                if((equal >> 8) == 0xFF) MATCH_EMIT(i + 1);
+            }
+        }
+    }
+#endif
+    for(; i < scan_count; ++i) {
+        for(diff = 0, w = 0; w < words; ++w) diff |= (sets[i * words + w] & mask[w]) ^ want[w];
+        if(diff == 0) MATCH_EMIT(i);
+    }
+    return found;
+}
+#undef MATCH_EMIT
+
+// scans of the set's least busy station which every other station of the set takes part in too
+static size_t match_station_timeline(Schedule skd, const StationSet* set, size_t* matches) {
+    const uint32_t* beg = skd.scan_index.station_beg;
+    const uint64_t* sets = skd.scans.station_sets;
+    const uint64_t* scan_set;
+    size_t i, w, station = SIZE_MAX, words = skd.scans.set_words, found = 0;
+    uint64_t diff;
+    for(i = 0; i < skd.station_count; ++i) {
+        if(!(set->words[i / STATION_SET_WORD_BITS] & ((uint64_t) 1 << (i % STATION_SET_WORD_BITS)))) continue;
+        if(station == SIZE_MAX || beg[i + 1] - beg[i] < beg[station + 1] - beg[station]) station = i;
+    }
+    // only undefined stations are set, none of which take part in a scan
+    if(station == SIZE_MAX) return 0;
+    for(i = beg[station]; i < beg[station + 1]; ++i) {
+        // a station listed twice in a scan appears twice in its timeline
+        if(i > beg[station] && skd.scan_index.station_scans[i] == skd.scan_index.station_scans[i - 1]) continue;
+        scan_set = &(sets[(size_t) skd.scan_index.station_scans[i] * words]);
+        for(diff = 0, w = 0; w < words; ++w) diff |= (scan_set[w] & set->words[w]) ^ set->words[w];
+        if(diff != 0) continue;
+        if(matches != NULL) matches[found] = skd.scan_index.station_scans[i];
+        found++;
+    }
+    return found;
+}
+
+size_t Schedule_scans_with(Schedule skd, const StationSet* set, size_t* matches) {
+    // stations past the schedule's set width can't take part in any scan
+    size_t w;
+    uint64_t any = 0;
+    for(w = skd.scans.set_words; w < STATION_SET_WORDS_MAX; ++w) if(set->words[w] != 0) return 0;
+    for(w = 0; w < skd.scans.set_words; ++w) any |= set->words[w];
+    // an empty set matches every scan
+    if(any != 0 && skd.scan_index.station_beg != NULL) return match_station_timeline(skd, set, matches);
+    return match_station_sets(skd.scans, skd.scan_count, set->words, set->words, matches);
+}
+
+size_t Schedule_scans_within(Schedule skd, const StationSet* set, size_t* matches) {
+    uint64_t outside[STATION_SET_WORDS_MAX], none[STATION_SET_WORDS_MAX] = {0,};
+    for(size_t w = 0; w < STATION_SET_WORDS_MAX; ++w) outside[w] = ~(set->words[w]);
+    return match_station_sets(skd.scans, skd.scan_count, outside, none, matches);
+}
+
+size_t Schedule_station_timeline(Schedule skd, size_t station, const uint32_t** scans, const uint32_t** offsets) {
+    const ScanIndex* index = &(skd.scan_index);
+    *scans = NULL;
+    *offsets = NULL;
+    if(index->station_beg == NULL || station >= skd.station_count) return 0;
+    *scans = &(index->station_scans[index->station_beg[station]]);
+    *offsets = &(index->station_offsets[index->station_beg[station]]);
+    return index->station_beg[station + 1] - index->station_beg[station];
+}
+
+size_t Schedule_source_scans(Schedule skd, size_t source, const uint32_t** scans) {
+    const ScanIndex* index = &(skd.scan_index);
+    *scans = NULL;
+    if(index->source_beg == NULL || source >= skd.source_count) return 0;
+    *scans = &(index->source_scans[index->source_beg[source]]);
+    return index->source_beg[source + 1] - index->source_beg[source];
+}
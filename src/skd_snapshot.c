@@ -0,0 +1,327 @@
+#include "skd_snapshot.h"
+#include <string.h>
+#include "util/arena.h"
+#include "util/log.h"
+
+// tables of a chunk
+#define SNAPSHOT_TIMESTAMP 1
+#define SNAPSHOT_SOURCE 2
+#define SNAPSHOT_MEMBERS 4 // station_beg, stations, offsets and station_sets
+// halves of the scan index
+#define SNAPSHOT_INDEX_STATIONS 1
+#define SNAPSHOT_INDEX_SOURCES 2
+// a copied chunk of up to a quarter of this shares a block with others
+#define SNAPSHOT_ARENA_BYTES (1 << 16)
+
+static size_t chunk_scans(size_t scan_count, size_t chunk) {
+    size_t beg = chunk * SNAPSHOT_CHUNK_SCANS;
+    return (scan_count - beg < SNAPSHOT_CHUNK_SCANS) ? scan_count - beg : SNAPSHOT_CHUNK_SCANS;
+}
+
+static TimeMs scan_timestamp(const ScheduleSnapshot* snap, size_t scan) {
+    return snap->chunks[scan / SNAPSHOT_CHUNK_SCANS].timestamp[scan % SNAPSHOT_CHUNK_SCANS];
+}
+
+// tables of a chunk which no longer point into the base, whichever snapshot copied them
+static unsigned int chunk_changed(const ScheduleSnapshot* snap, size_t chunk) {
+    const ScanChunk* sub = &(snap->chunks[chunk]);
+    const ScanTable* scans = &(snap->base.scans);
+    size_t first = chunk * SNAPSHOT_CHUNK_SCANS;
+    unsigned int changed = 0;
+    if(sub->timestamp != &(scans->timestamp[first])) changed |= SNAPSHOT_TIMESTAMP;
+    if(sub->source != &(scans->source[first])) changed |= SNAPSHOT_SOURCE;
+    if(sub->stations != scans->stations) changed |= SNAPSHOT_MEMBERS;
+    return changed;
+}
+
+unsigned int ScheduleSnapshot_init(ScheduleSnapshot* snap, Schedule base) {
+    memset(snap, 0, sizeof(ScheduleSnapshot));
+    if(base.stream != NULL) {
+        LOG_ERROR("Unable to snapshot a Schedule which is still streaming.");
+        return 1;
+    }
+    snap->base = base;
+    snap->chunk_count = (base.scan_count + SNAPSHOT_CHUNK_SCANS - 1) / SNAPSHOT_CHUNK_SCANS;
+    snap->arena = Arena_create(SNAPSHOT_ARENA_BYTES);
+    if(snap->arena != NULL) snap->chunks = (ScanChunk*) Arena_alloc(snap->arena, (snap->chunk_count + 1) * sizeof(ScanChunk));
+    if(snap->chunks == NULL) {
+        LOG_ERROR("Unable to allocate Schedule snapshot.");
+        if(snap->arena != NULL) Arena_release(snap->arena);
+        return 1;
+    }
+    const ScanTable* scans = &(base.scans);
+    size_t c, first;
+    for(c = 0; c < snap->chunk_count; ++c) {
+        first = c * SNAPSHOT_CHUNK_SCANS;
+        snap->chunks[c] = (ScanChunk) {
+            .timestamp = &(scans->timestamp[first]),
+            .source = &(scans->source[first]),
+            .station_beg = &(scans->station_beg[first]),
+            .stations = scans->stations,
+            .offsets = scans->offsets,
+            .station_sets = &(scans->station_sets[first * scans->set_words]),
+            .owned = 0,
+        };
+    }
+    if(base.scan_index.station_beg == NULL) snap->stale |= SNAPSHOT_INDEX_STATIONS;
+    if(base.scan_index.source_beg == NULL) snap->stale |= SNAPSHOT_INDEX_SOURCES;
+    return 0;
+}
+
+// the fork shares every chunk of its parent, the parent's copies included
+unsigned int ScheduleSnapshot_fork(ScheduleSnapshot* snap, const ScheduleSnapshot* parent) {
+    if(ScheduleSnapshot_init(snap, parent->base)) return 1;
+    memcpy(snap->chunks, parent->chunks, parent->chunk_count * sizeof(ScanChunk));
+    for(size_t c = 0; c < snap->chunk_count; ++c) snap->chunks[c].owned = 0;
+    snap->dirty_beg = parent->dirty_beg;
+    snap->dirty_end = parent->dirty_end;
+    snap->stale = parent->stale;
+    return 0;
+}
+
+// copies count entries of a table into the snapshot's arena, with room for one more like the Schedule's own tables
+static void* copy_table(ScheduleSnapshot* snap, const void* table, size_t count, size_t bytes_per_elem) {
+    void* copy = Arena_alloc(snap->arena, (count + 1) * bytes_per_elem);
+    if(copy == NULL) {
+        LOG_ERROR("Unable to copy Schedule chunk into snapshot.");
+        return NULL;
+    }
+    memcpy(copy, table, count * bytes_per_elem);
+    return copy;
+}
+
+// a chunk's members are copied together, since every member after a removed one moves
+static unsigned int own_chunk(ScheduleSnapshot* snap, size_t chunk, unsigned int tables) {
+    ScanChunk* sub = &(snap->chunks[chunk]);
+    size_t i, count = chunk_scans(snap->base.scan_count, chunk), words = snap->base.scans.set_words;
+    tables &= ~(sub->owned);
+    if(tables & SNAPSHOT_TIMESTAMP) {
+        TimeMs* timestamp = (TimeMs*) copy_table(snap, sub->timestamp, count, sizeof(TimeMs));
+        if(timestamp == NULL) return 1;
+        sub->timestamp = timestamp;
+    }
+    if(tables & SNAPSHOT_SOURCE) {
+        uint32_t* source = (uint32_t*) copy_table(snap, sub->source, count, sizeof(uint32_t));
+        if(source == NULL) return 1;
+        sub->source = source;
+    }
+    if(tables & SNAPSHOT_MEMBERS) {
+        uint32_t first = sub->station_beg[0], member_count = sub->station_beg[count] - first;
+        uint32_t* station_beg = (uint32_t*) copy_table(snap, sub->station_beg, count + 1, sizeof(uint32_t));
+        uint16_t* stations = (uint16_t*) copy_table(snap, &(sub->stations[first]), member_count, sizeof(uint16_t));
+        uint32_t* offsets = (uint32_t*) copy_table(snap, &(sub->offsets[first]), member_count, sizeof(uint32_t));
+        uint64_t* station_sets = (uint64_t*) copy_table(snap, sub->station_sets, count * words, sizeof(uint64_t));
+        if(station_beg == NULL || stations == NULL || offsets == NULL || station_sets == NULL) return 1;
+        for(i = 0; i <= count; ++i) station_beg[i] -= first;
+        sub->station_beg = station_beg;
+        sub->stations = stations;
+        sub->offsets = offsets;
+        sub->station_sets = station_sets;
+    }
+    sub->owned |= tables;
+    return 0;
+}
+
+static void mark_dirty(ScheduleSnapshot* snap, size_t beg, size_t end) {
+    if(snap->dirty_beg == snap->dirty_end) {
+        snap->dirty_beg = beg;
+        snap->dirty_end = end;
+        return;
+    }
+    if(beg < snap->dirty_beg) snap->dirty_beg = beg;
+    if(end > snap->dirty_end) snap->dirty_end = end;
+}
+
+// the first scan of chunk to list station, or the chunk's scan count if none does
+static size_t first_with_station(const ScheduleSnapshot* snap, size_t chunk, size_t station) {
+    const ScanChunk* sub = &(snap->chunks[chunk]);
+    size_t i, count = chunk_scans(snap->base.scan_count, chunk), words = snap->base.scans.set_words;
+    uint64_t bit = (uint64_t) 1 << (station % STATION_SET_WORD_BITS);
+    for(i = 0; i < count && !(sub->station_sets[i * words + station / STATION_SET_WORD_BITS] & bit); ++i);
+    return i;
+}
+
+// every chunk that lists the station is copied before any is changed, so running out of memory leaves the snapshot as it was
+unsigned int ScheduleSnapshot_drop_station(ScheduleSnapshot* snap, size_t station) {
+    size_t c, i, j, count, first, last, words = snap->base.scans.set_words, word = station / STATION_SET_WORD_BITS;
+    if(station >= snap->base.station_count) {
+        LOG_ERROR("Unable to drop station from snapshot, it isn't defined.");
+        return 1;
+    }
+    uint64_t bit = (uint64_t) 1 << (station % STATION_SET_WORD_BITS);
+    for(c = 0; c < snap->chunk_count; ++c) {
+        if(first_with_station(snap, c, station) == chunk_scans(snap->base.scan_count, c)) continue;
+        if(own_chunk(snap, c, SNAPSHOT_MEMBERS)) return 1;
+    }
+    for(c = 0; c < snap->chunk_count; ++c) {
+        ScanChunk* sub = &(snap->chunks[c]);
+        count = chunk_scans(snap->base.scan_count, c);
+        first = first_with_station(snap, c, station);
+        if(first == count) continue;
+        // members only ever move towards the front, so the chunk is compacted in place
+        uint32_t at = sub->station_beg[first], beg = at, end;
+        for(i = first, last = first; i < count; ++i) {
+            end = sub->station_beg[i + 1];
+            for(j = beg; j < end; ++j) {
+                if(sub->stations[j] == station) continue;
+                sub->stations[at] = sub->stations[j];
+                sub->offsets[at] = sub->offsets[j];
+                at++;
+            }
+            sub->station_beg[i + 1] = at;
+            if(sub->station_sets[i * words + word] & bit) last = i;
+            sub->station_sets[i * words + word] &= ~bit;
+            beg = end;
+        }
+        mark_dirty(snap, c * SNAPSHOT_CHUNK_SCANS + first, c * SNAPSHOT_CHUNK_SCANS + last + 1);
+        snap->stale |= SNAPSHOT_INDEX_STATIONS;
+    }
+    return 0;
+}
+
+// scans are kept in time order rather than re-sorted, so no scan changes its index and the scan index stays valid
+unsigned int ScheduleSnapshot_shift_scans(ScheduleSnapshot* snap, size_t beg, size_t end, TimeMs ms) {
+    size_t c, i, scan_count = snap->base.scan_count;
+    if(beg > end || end > scan_count) {
+        LOG_ERROR("Unable to shift scans in snapshot, they're out of range.");
+        return 1;
+    }
+    if(beg == end || ms == 0) return 0;
+    if((beg > 0 && scan_timestamp(snap, beg) + ms < scan_timestamp(snap, beg - 1)) ||
+        (end < scan_count && scan_timestamp(snap, end - 1) + ms > scan_timestamp(snap, end))) {
+        LOG_ERROR("Unable to shift scans in snapshot, they would pass the scans around them.");
+        return 1;
+    }
+    for(c = beg / SNAPSHOT_CHUNK_SCANS; c * SNAPSHOT_CHUNK_SCANS < end; ++c) {
+        if(own_chunk(snap, c, SNAPSHOT_TIMESTAMP)) return 1;
+    }
+    for(i = beg; i < end; ++i) snap->chunks[i / SNAPSHOT_CHUNK_SCANS].timestamp[i % SNAPSHOT_CHUNK_SCANS] += ms;
+    mark_dirty(snap, beg, end);
+    return 0;
+}
+
+unsigned int ScheduleSnapshot_set_source(ScheduleSnapshot* snap, size_t scan, size_t source) {
+    if(scan >= snap->base.scan_count || source >= snap->base.source_count) {
+        LOG_ERROR("Unable to set source in snapshot, the scan or source isn't defined.");
+        return 1;
+    }
+    size_t chunk = scan / SNAPSHOT_CHUNK_SCANS;
+    if(snap->chunks[chunk].source[scan % SNAPSHOT_CHUNK_SCANS] == source) return 0;
+    if(own_chunk(snap, chunk, SNAPSHOT_SOURCE)) return 1;
+    snap->chunks[chunk].source[scan % SNAPSHOT_CHUNK_SCANS] = (uint32_t) source;
+    snap->stale |= SNAPSHOT_INDEX_SOURCES;
+    mark_dirty(snap, scan, scan + 1);
+    return 0;
+}
+
+void ScheduleSnapshot_free(ScheduleSnapshot snap) {
+    // the chunks it didn't copy belong to the base or to the snapshot it was forked from
+    Arena_release(snap.arena);
+}
+
+void ScheduleView_init(ScheduleView* view, Schedule base) {
+    memset(view, 0, sizeof(ScheduleView));
+    view->skd = base;
+    view->base = base;
+}
+
+// the snapshot's chunks laid out flat in next's arena, for every table which differs from the base
+static unsigned int assemble_tables(Schedule* next, const ScheduleSnapshot* snap, unsigned int changed) {
+    const ScanChunk* sub;
+    ScanTable* scans = &(next->scans);
+    size_t c, i, count, first, member_count = 0, words = scans->set_words, scan_count = next->scan_count;
+    if(changed & SNAPSHOT_TIMESTAMP) {
+        scans->timestamp = (TimeMs*) Arena_alloc(next->arena, (scan_count + 1) * sizeof(TimeMs));
+        if(scans->timestamp == NULL) return 1;
+        for(c = 0; c < snap->chunk_count; ++c) {
+            memcpy(&(scans->timestamp[c * SNAPSHOT_CHUNK_SCANS]), snap->chunks[c].timestamp, chunk_scans(scan_count, c) * sizeof(TimeMs));
+        }
+    }
+    if(changed & SNAPSHOT_SOURCE) {
+        scans->source = (uint32_t*) Arena_alloc(next->arena, (scan_count + 1) * sizeof(uint32_t));
+        if(scans->source == NULL) return 1;
+        for(c = 0; c < snap->chunk_count; ++c) {
+            memcpy(&(scans->source[c * SNAPSHOT_CHUNK_SCANS]), snap->chunks[c].source, chunk_scans(scan_count, c) * sizeof(uint32_t));
+        }
+    }
+    if(!(changed & SNAPSHOT_MEMBERS)) return 0;
+    for(c = 0; c < snap->chunk_count; ++c) {
+        sub = &(snap->chunks[c]);
+        member_count += sub->station_beg[chunk_scans(scan_count, c)] - sub->station_beg[0];
+    }
+    scans->station_beg = (uint32_t*) Arena_alloc(next->arena, (scan_count + 1) * sizeof(uint32_t));
+    scans->stations = (uint16_t*) Arena_alloc(next->arena, (member_count + 1) * sizeof(uint16_t));
+    scans->offsets = (uint32_t*) Arena_alloc(next->arena, (member_count + 1) * sizeof(uint32_t));
+    scans->station_sets = (uint64_t*) Arena_alloc(next->arena, (scan_count * words + 1) * sizeof(uint64_t));
+    if(scans->station_beg == NULL || scans->stations == NULL || scans->offsets == NULL || scans->station_sets == NULL) return 1;
+    uint32_t at = 0;
+    for(c = 0; c < snap->chunk_count; ++c) {
+        sub = &(snap->chunks[c]);
+        count = chunk_scans(scan_count, c);
+        first = c * SNAPSHOT_CHUNK_SCANS;
+        for(i = 0; i < count; ++i) scans->station_beg[first + i] = at + sub->station_beg[i] - sub->station_beg[0];
+        member_count = sub->station_beg[count] - sub->station_beg[0];
+        memcpy(&(scans->stations[at]), &(sub->stations[sub->station_beg[0]]), member_count * sizeof(uint16_t));
+        memcpy(&(scans->offsets[at]), &(sub->offsets[sub->station_beg[0]]), member_count * sizeof(uint32_t));
+        memcpy(&(scans->station_sets[first * words]), sub->station_sets, count * words * sizeof(uint64_t));
+        at += (uint32_t) member_count;
+    }
+    scans->station_beg[scan_count] = at;
+    return 0;
+}
+
+// the scans of unchanged chunks are the base's, which were validated when it was built
+static unsigned int assemble_view(Schedule* next, const ScheduleSnapshot* snap) {
+    size_t c;
+    unsigned int changed = 0;
+    for(c = 0; c < snap->chunk_count; ++c) changed |= chunk_changed(snap, c);
+    // sections parsed on demand are parsed into the view's own table, so nothing in base points into its arena
+    next->arena = Arena_create(SNAPSHOT_ARENA_BYTES);
+    if(next->arena != NULL) next->sections = (Section*) Arena_alloc(next->arena, (next->section_count + 1) * sizeof(Section));
+    if(next->arena == NULL || next->sections == NULL || assemble_tables(next, snap, changed)) {
+        LOG_ERROR("Unable to lay out Schedule snapshot.");
+        return 1;
+    }
+    memcpy(next->sections, snap->base.sections, next->section_count * sizeof(Section));
+    if((snap->stale & SNAPSHOT_INDEX_STATIONS) && Schedule_index_station_scans(next)) return 1;
+    if((snap->stale & SNAPSHOT_INDEX_SOURCES) && Schedule_index_source_scans(next)) return 1;
+    for(c = 0; c < snap->chunk_count; ++c) {
+        if(chunk_changed(snap, c) == 0) continue;
+        if(Schedule_debug_and_validate_range(*next, c * SNAPSHOT_CHUNK_SCANS, c * SNAPSHOT_CHUNK_SCANS + chunk_scans(next->scan_count, c), 0)) return 1;
+    }
+    return 0;
+}
+
+unsigned int ScheduleView_show(ScheduleView* view, const ScheduleSnapshot* snap, ScheduleDiff* diff) {
+    Schedule next = view->base;
+    size_t dirty_beg = 0, dirty_end = 0, first, last;
+    if(snap != NULL) {
+        if(assemble_view(&next, snap)) {
+            if(next.arena != NULL) Arena_release(next.arena);
+            return 1;
+        }
+        dirty_beg = snap->dirty_beg;
+        dirty_end = snap->dirty_end;
+    }
+    // only the scans either variant changed can differ between them
+    first = view->dirty_beg;
+    last = view->dirty_end;
+    if(first == last) {
+        first = dirty_beg;
+        last = dirty_end;
+    } else if(dirty_beg != dirty_end) {
+        if(dirty_beg < first) first = dirty_beg;
+        if(dirty_end > last) last = dirty_end;
+    }
+    *diff = (ScheduleDiff) { .first = first, .removed = last - first, .added = last - first, .stations = 0, .sources = 0 };
+    if(view->arena != NULL) Arena_release(view->arena);
+    view->skd = next;
+    view->arena = (snap != NULL) ? next.arena : NULL;
+    view->dirty_beg = dirty_beg;
+    view->dirty_end = dirty_end;
+    return 0;
+}
+
+void ScheduleView_free(ScheduleView view) {
+    if(view.arena != NULL) Arena_release(view.arena);
+}
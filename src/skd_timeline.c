@@ -0,0 +1,144 @@
+#include "skd_timeline.h"
+#include <stdlib.h>
+#include <string.h>
+#include "skd_query.h"
+#include "util/log.h"
+
+// the station's cursors only ever move forward, so ms can't be earlier than when they were last moved
+static StationStatus station_status(StationTimeline* timeline, Schedule skd, size_t station, TimeMs ms) {
+    const ScanTable* scans = &(skd.scans);
+    const uint32_t* own;
+    const uint32_t* offsets;
+    StationStatus status = { .state = STATION_IDLE, .scan = SCAN_NONE, .until = TIMELINE_NEVER };
+    uint32_t* k = &(timeline->cursor[station]);
+    uint32_t end = (uint32_t) Schedule_station_timeline(skd, station, &own, &offsets);
+    if(*k < end) {
+        // the station is in the last of its scans to have started
+        while(*k + 1 < end && scans->timestamp[own[*k + 1]] <= ms) (*k)++;
+        uint32_t scan = own[*k];
+        TimeMs next = (*k + 1 < end) ? scans->timestamp[own[*k + 1]] : TIMELINE_NEVER;
+        TimeMs start = scans->timestamp[scan];
+        TimeMs observed = start + (TimeMs) offsets[*k] * TIME_MS_PER_SEC;
+        TimeMs calibrated = observed + (TimeMs) scans->cal_duration[scan] * TIME_MS_PER_SEC;
+        if(ms < start) {
+            status = (StationStatus) { .state = STATION_IDLE, .scan = scan, .until = start };
+        } else if(ms < observed) {
+            status = (StationStatus) { .state = STATION_ON_SOURCE, .scan = scan, .until = (observed < next) ? observed : next };
+        } else if(ms < calibrated) {
+            status = (StationStatus) { .state = STATION_CALIBRATING, .scan = scan, .until = (calibrated < next) ? calibrated : next };
+        } else if(next != TIMELINE_NEVER) {
+            status.scan = own[*k + 1];
+            status.state = (scans->source[status.scan] != scans->source[scan]) ? STATION_SLEWING : STATION_IDLE;
+            status.until = next;
+        }
+    }
+    // downtime overrides whatever the station would be doing
+    const StationDowntime* down = timeline->downtime;
+    if(down == NULL) return status;
+    uint32_t* d = &(timeline->down_cursor[station]);
+    uint32_t down_end = down->beg[station + 1];
+    while(*d < down_end && down->until[*d] <= ms) (*d)++;
+    if(*d < down_end) {
+        if(down->from[*d] <= ms) {
+            status.state = STATION_DOWN;
+            status.scan = SCAN_NONE;
+            status.until = down->until[*d];
+        } else if(down->from[*d] < status.until) {
+            status.until = down->from[*d];
+        }
+    }
+    return status;
+}
+
+static void sift_down(StationEvent queue[], size_t count, size_t i) {
+    StationEvent event = queue[i];
+    size_t child;
+    while((child = i * 2 + 1) < count) {
+        if(child + 1 < count && queue[child + 1].ms < queue[child].ms) child++;
+        if(queue[child].ms >= event.ms) break;
+        queue[i] = queue[child];
+        i = child;
+    }
+    queue[i] = event;
+}
+
+unsigned int StationTimeline_build(StationTimeline* timeline, Schedule skd) {
+    memset(timeline, 0, sizeof(StationTimeline));
+    if(skd.scan_index.station_beg == NULL) {
+        LOG_ERROR("Unable to build station timeline, the scans aren't indexed by station.");
+        return 1;
+    }
+    timeline->station_count = skd.station_count;
+    timeline->stations = (StationStatus*) malloc((skd.station_count + 1) * sizeof(StationStatus));
+    timeline->cursor = (uint32_t*) malloc((skd.station_count + 1) * sizeof(uint32_t));
+    timeline->down_cursor = (uint32_t*) malloc((skd.station_count + 1) * sizeof(uint32_t));
+    timeline->queue = (StationEvent*) malloc((skd.station_count + 1) * sizeof(StationEvent));
+    if(timeline->stations == NULL || timeline->cursor == NULL || timeline->down_cursor == NULL || timeline->queue == NULL) {
+        LOG_ERROR("Unable to allocate station timeline.");
+        StationTimeline_free(*timeline);
+        return 1;
+    }
+    // a schedule without $DOWNTIME has stations which are never down
+    if(Schedule_get_section(skd, "$DOWNTIME") != NULL) {
+        timeline->downtime = Schedule_get_downtime(skd);
+        if(timeline->downtime == NULL) {
+            StationTimeline_free(*timeline);
+            return 1;
+        }
+    }
+    StationTimeline_seek(timeline, skd, (skd.scan_count > 0) ? skd.scans.timestamp[0] : 0);
+    return 0;
+}
+
+void StationTimeline_seek(StationTimeline* timeline, Schedule skd, TimeMs ms) {
+    const uint32_t* own;
+    const uint32_t* offsets;
+    size_t i;
+    uint32_t lo, hi, mid;
+    memset(timeline->counts, 0, sizeof(timeline->counts));
+    timeline->queue_count = 0;
+    for(i = 0; i < timeline->station_count; ++i) {
+        // the last scan to have started at ms, or the first if none has
+        lo = 0;
+        hi = (uint32_t) Schedule_station_timeline(skd, i, &own, &offsets);
+        while(lo < hi) {
+            mid = lo + (hi - lo) / 2;
+            if(skd.scans.timestamp[own[mid]] <= ms) lo = mid + 1; else hi = mid;
+        }
+        timeline->cursor[i] = (lo > 0) ? lo - 1 : 0;
+        timeline->down_cursor[i] = (timeline->downtime == NULL) ? 0 : timeline->downtime->beg[i];
+        timeline->stations[i] = station_status(timeline, skd, i, ms);
+        timeline->counts[timeline->stations[i].state]++;
+        if(timeline->stations[i].until == TIMELINE_NEVER) continue;
+        timeline->queue[timeline->queue_count++] = (StationEvent) { .ms = timeline->stations[i].until, .station = (uint16_t) i };
+    }
+    for(i = timeline->queue_count / 2; i > 0; --i) sift_down(timeline->queue, timeline->queue_count, i - 1);
+    timeline->ms = ms;
+}
+
+// the station at the front of the queue changes and takes its place again with its next change
+size_t StationTimeline_advance(StationTimeline* timeline, Schedule skd, TimeMs ms) {
+    StationEvent* queue = timeline->queue;
+    StationStatus status;
+    size_t applied = 0, station;
+    while(timeline->queue_count > 0 && queue[0].ms <= ms) {
+        station = queue[0].station;
+        status = station_status(timeline, skd, station, queue[0].ms);
+        timeline->counts[timeline->stations[station].state]--;
+        timeline->counts[status.state]++;
+        timeline->stations[station] = status;
+        if(status.until == TIMELINE_NEVER) queue[0] = queue[--(timeline->queue_count)];
+        else queue[0].ms = status.until;
+        sift_down(queue, timeline->queue_count, 0);
+        applied++;
+    }
+    if(ms > timeline->ms) timeline->ms = ms;
+    return applied;
+}
+
+void StationTimeline_free(StationTimeline timeline) {
+    free(timeline.stations);
+    free(timeline.cursor);
+    free(timeline.down_cursor);
+    free(timeline.queue);
+}
@@ -1,18 +1,13 @@
 #include "ui.h"
 #include <glenv.h>
 #include <math.h>
+#include <string.h>
 
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
 #define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
 
-// I want to avoid allocations for OverlayState,
-// so I've initialized it with enough space for every
-// station to scan a different source at the same time.
-// This will NEVER happen in practice, so it's "safe"
-#define MAX_STATION_COUNT 57
-
-#define SIZE_NAME_SRC 8
-#define SIZE_NAME_STA 2
+// the time slider's resolution, as a fraction of the session
+#define SEEK_STEP 0.0001f
 
 #ifndef NO_UI
 static struct {
@@ -20,9 +15,8 @@ static struct {
     const char* path;
     OverlayControls controls;
     OverlayAction act;
+    float seek;
     float row_height;
-    char active_scans[MAX_STATION_COUNT * SIZE_NAME_SRC + 1];
-    char stations[MAX_STATION_COUNT * SIZE_NAME_STA + 1];
 } Overlay;
 
 void Overlay_init(const char* path, RGFW_window* const win) {
@@ -30,9 +24,8 @@ void Overlay_init(const char* path, RGFW_window* const win) {
     Overlay.ctx = ctx;
     Overlay.path = path;
     Overlay.act = ACTION_NONE;
+    Overlay.seek = 0.f;
     Overlay.row_height = ctx->style.font->height + ctx->style.window.padding.y;
-    Overlay.active_scans[0] = '\0';
-    Overlay.stations[0] = '\0';
 }
 
 OverlayAction Overlay_get_action() {
@@ -41,36 +34,12 @@ OverlayAction Overlay_get_action() {
     return act;
 }
 
-void Overlay_set_controls(const OverlayControls controls) {
-    Overlay.controls = controls;
-}
-
-void Overlay_add_active_scan(const char* const name) {
-    size_t len = strlen(Overlay.active_scans);
-    memcpy(&(Overlay.active_scans[len]), name, SIZE_NAME_SRC + 1);
-}
-
-const char* Overlay_pop_active_scan() {
-    static char curr[SIZE_NAME_SRC + 1] = "";
-    size_t len = strlen(Overlay.active_scans);
-    if(len == 0) return NULL;
-    memcpy(curr, &(Overlay.active_scans[len - SIZE_NAME_SRC]), SIZE_NAME_SRC);
-    Overlay.active_scans[len - SIZE_NAME_SRC] = '\0';
-    return curr;
-}
-
-void Overlay_add_station(const char* const name) {
-    size_t len = strlen(Overlay.stations);
-    memcpy(&(Overlay.stations[len]), name, SIZE_NAME_STA + 1);
+float Overlay_get_seek() {
+    return Overlay.seek;
 }
 
-const char* Overlay_pop_station() {
-    static char curr[SIZE_NAME_STA + 1] = "";
-    size_t len = strlen(Overlay.stations);
-    if(len == 0) return NULL;
-    memcpy(curr, &(Overlay.stations[len - SIZE_NAME_STA]), SIZE_NAME_STA);
-    Overlay.stations[len - SIZE_NAME_STA] = '\0';
-    return curr;
+void Overlay_set_controls(const OverlayControls controls) {
+    Overlay.controls = controls;
 }
 
 typedef enum {
@@ -162,6 +131,9 @@ void prepare_widgets_info(const nk_bool collapsed) {
     nk_layout_row_dynamic(Overlay.ctx, Overlay.row_height, 1);
     nk_labelf(Overlay.ctx, NK_TEXT_LEFT, "jd: %lf", Overlay.controls.jd);
     nk_labelf(Overlay.ctx, NK_TEXT_LEFT, "gmst: %lf", Overlay.controls.gmst);
+    nk_labelf(Overlay.ctx, NK_TEXT_LEFT, Overlay.controls.loading ? "scans: %zu (loading)" : "scans: %zu", Overlay.controls.scan_count);
+    nk_labelf(Overlay.ctx, NK_TEXT_LEFT, "observing: %zu calibrating: %zu", Overlay.controls.observing, Overlay.controls.calibrating);
+    nk_labelf(Overlay.ctx, NK_TEXT_LEFT, "slewing: %zu idle: %zu down: %zu", Overlay.controls.slewing, Overlay.controls.idle, Overlay.controls.down);
 }
 
 void prepare_widgets_controls(const nk_bool collapsed) {
@@ -177,28 +149,29 @@ void prepare_widgets_controls(const nk_bool collapsed) {
         Overlay.act = ACTION_SKD_PASS_PAUSE;
     if(nk_button_label(Overlay.ctx, "Reset")) 
         Overlay.act = ACTION_SKD_PASS_RESET;
+    // the slider follows playback, dragging it seeks
+    nk_layout_row_dynamic(Overlay.ctx, Overlay.row_height, 1);
+    float seek = Overlay.controls.progress;
+    if(nk_slider_float(Overlay.ctx, 0.f, &seek, 1.f, SEEK_STEP)) {
+        Overlay.seek = seek;
+        Overlay.act = ACTION_SKD_PASS_SEEK;
+    }
 }
 
 void prepare_widgets_active_scans(const nk_bool collapsed) {
     const char* source;
-    if(collapsed) {
-        while((source = Overlay_pop_active_scan()));
-        return;
-    }
+    if(collapsed) return;
     nk_layout_row_dynamic(Overlay.ctx, Overlay.row_height, 1);
-    if(!strlen(Overlay.active_scans)) nk_label(Overlay.ctx, "No active scans", NK_TEXT_ALIGN_LEFT);
-    while((source = Overlay_pop_active_scan())) nk_label(Overlay.ctx, source, NK_TEXT_ALIGN_LEFT);
+    if(Overlay_get_active_scan(0) == NULL) nk_label(Overlay.ctx, "No active scans", NK_TEXT_ALIGN_LEFT);
+    for(size_t i = 0; (source = Overlay_get_active_scan(i)); ++i) nk_label(Overlay.ctx, source, NK_TEXT_ALIGN_LEFT);
 }
 
 void prepare_widgets_stations(const nk_bool collapsed) {
     const char* station;
-    if(collapsed) {
-        while((station = Overlay_pop_station()));
-        return;
-    }
+    if(collapsed) return;
     nk_layout_row_dynamic(Overlay.ctx, Overlay.row_height, 1);
-    if(!strlen(Overlay.stations)) nk_label(Overlay.ctx, "All stations idle", NK_TEXT_ALIGN_LEFT);
-    while((station = Overlay_pop_station())) nk_label(Overlay.ctx, station, NK_TEXT_ALIGN_LEFT);
+    if(Overlay_get_station(0) == NULL) nk_label(Overlay.ctx, "All stations idle", NK_TEXT_ALIGN_LEFT);
+    for(size_t i = 0; (station = Overlay_get_station(i)); ++i) nk_label(Overlay.ctx, station, NK_TEXT_ALIGN_LEFT);
 }
 
 static Panel OverlayPanels[] = {
@@ -212,14 +185,14 @@ static Panel OverlayPanels[] = {
     {
         .title = "info",
         .parent = "banner",
-        .bounds = PANEL_BOUNDS_LEFT_RATIO(0.3f, 2),
+        .bounds = PANEL_BOUNDS_LEFT_RATIO(0.3f, 5),
         .flags = NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_MINIMIZABLE | NK_WINDOW_NO_SCROLLBAR,
         .prepare_widgets = prepare_widgets_info,
     },
     {
         .title = "controls",
         .parent = "info",
-        .bounds = PANEL_BOUNDS_LEFT_RATIO(0.3f, 2),
+        .bounds = PANEL_BOUNDS_LEFT_RATIO(0.3f, 3),
         .flags = NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_MINIMIZABLE | NK_WINDOW_NO_SCROLLBAR,
         .prepare_widgets = prepare_widgets_controls,
     },
@@ -0,0 +1,78 @@
+#include "ui.h"
+#include <stdlib.h>
+#include <string.h>
+#include "util/log.h"
+
+#define SIZE_NAME_SRC 8
+#define SIZE_NAME_STA 2
+// names are kept from one frame to the next, the lists are only cleared and refilled when they change
+// a list grows to hold the most names pushed at once, so it's rarely reallocated after the first few changes
+#define OVERLAY_LIST_MIN_CAP 256
+
+// the name lists don't depend on nuklear, so they're built without a window
+#ifndef NO_UI
+typedef struct {
+    char* names; // fixed-width names, one after another
+    size_t len, cap;
+} OverlayList;
+
+static struct {
+    OverlayList active_scans;
+    OverlayList stations;
+} OverlayLists;
+
+void Overlay_free() {
+    free(OverlayLists.active_scans.names);
+    free(OverlayLists.stations.names);
+    OverlayLists.active_scans = (OverlayList) { .names = NULL, .len = 0, .cap = 0 };
+    OverlayLists.stations = (OverlayList) { .names = NULL, .len = 0, .cap = 0 };
+}
+
+// the name is dropped if the list can't grow
+static void OverlayList_push(OverlayList* list, const char* const name, size_t width) {
+    if(list->len + width > list->cap) {
+        size_t cap = (list->cap == 0) ? OVERLAY_LIST_MIN_CAP : list->cap * 2;
+        while(cap < list->len + width) cap *= 2;
+        char* names = (char*) realloc(list->names, cap);
+        if(names == NULL) {
+            LOG_ERROR("Unable to grow Overlay list.");
+            return;
+        }
+        list->names = names;
+        list->cap = cap;
+    }
+    memcpy(&(list->names[list->len]), name, width);
+    list->len += width;
+}
+
+// names are read back to front, curr holds width + 1 bytes
+static const char* OverlayList_get(const OverlayList* list, size_t i, size_t width, char* curr) {
+    if((i + 1) * width > list->len) return NULL;
+    memcpy(curr, &(list->names[list->len - (i + 1) * width]), width);
+    curr[width] = '\0';
+    return curr;
+}
+
+void Overlay_add_active_scan(const char* const name) {
+    OverlayList_push(&(OverlayLists.active_scans), name, SIZE_NAME_SRC);
+}
+
+void Overlay_clear_lists() {
+    OverlayLists.active_scans.len = 0;
+    OverlayLists.stations.len = 0;
+}
+
+const char* Overlay_get_active_scan(size_t i) {
+    static char curr[SIZE_NAME_SRC + 1] = "";
+    return OverlayList_get(&(OverlayLists.active_scans), i, SIZE_NAME_SRC, curr);
+}
+
+void Overlay_add_station(const char* const name) {
+    OverlayList_push(&(OverlayLists.stations), name, SIZE_NAME_STA);
+}
+
+const char* Overlay_get_station(size_t i) {
+    static char curr[SIZE_NAME_STA + 1] = "";
+    return OverlayList_get(&(OverlayLists.stations), i, SIZE_NAME_STA, curr);
+}
+#endif /* not NO_UI */
@@ -0,0 +1,24 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdio.h>
+#include <time.h>
+
+// benchmarks are run from the repository's root by make bench, every benchmark is a single executable
+// they're built with the same flags as vis, so they time what it runs
+#define BENCH_RUNS 3
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static double bench_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// rate of the fastest of BENCH_RUNS
+#pragma GCC diagnostic ignored "-Wunused-function"
+static void bench_report(const char* name, double best, double count, const char* unit) {
+    printf("%-40s %10.6f s %12.0f %s/s\n", name, best, count / best, unit);
+}
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util/hashmap.h"
+#include "bench.h"
+#include "synth.h"
+
+// inserts and lookups per second on an ICRF3-sized catalog, for the Robin Hood HashMap and the chained map it replaced
+#define CATALOG_SIZE 4536
+#define LOOKUP_ROUNDS 20
+// the chained map was always created with this many buckets
+#define CHAINED_BUCKET_COUNT 10
+
+typedef struct ChainedNode ChainedNode;
+struct ChainedNode {
+    ChainedNode* next;
+    char contents[];
+};
+
+// the chained map as it was, hashing with bucket_count - 1 as the mask and appending to the end of every chain
+typedef struct {
+    size_t size;
+    size_t bytes_per_elem;
+    size_t bucket_count;
+    ChainedNode** buckets;
+} ChainedMap;
+
+static unsigned int ChainedMap_init(ChainedMap* hm, size_t bucket_count, size_t bytes_per_elem) {
+    hm->size = 0;
+    hm->bytes_per_elem = bytes_per_elem;
+    hm->bucket_count = bucket_count;
+    hm->buckets = (ChainedNode**) calloc(bucket_count, sizeof(ChainedNode*));
+    return hm->buckets == NULL;
+}
+
+static size_t ChainedMap_hash(size_t bucket_count, const char* key) {
+    size_t initial = 0x811c9dc5;
+    while(*key) {
+        initial ^= (size_t) (unsigned char) *key++;
+        initial *= 0x01000193;
+    }
+    return initial & (bucket_count - 1);
+}
+
+static unsigned int ChainedMap_insert(ChainedMap* hm, const char* key, const void* val) {
+    size_t bytes_per_key = strlen(key) + 1;
+    ChainedNode* node = (ChainedNode*) malloc(sizeof(ChainedNode) + bytes_per_key + hm->bytes_per_elem);
+    if(node == NULL) return 1;
+    node->next = NULL;
+    strcpy(node->contents, key);
+    memcpy(&(node->contents[bytes_per_key]), val, hm->bytes_per_elem);
+    hm->size++;
+    ChainedNode** tail = &(hm->buckets[ChainedMap_hash(hm->bucket_count, key)]);
+    while(*tail != NULL) tail = &((*tail)->next);
+    *tail = node;
+    return 0;
+}
+
+static void* ChainedMap_get(ChainedMap hm, const char* key) {
+    for(ChainedNode* node = hm.buckets[ChainedMap_hash(hm.bucket_count, key)]; node != NULL; node = node->next) {
+        if(strcmp(node->contents, key) == 0) return &(node->contents[strlen(node->contents) + 1]);
+    }
+    return NULL;
+}
+
+static void ChainedMap_free(ChainedMap hm) {
+    ChainedNode* temp;
+    for(size_t i = 0; i < hm.bucket_count; ++i) {
+        for(ChainedNode* node = hm.buckets[i]; node != NULL; node = temp) {
+            temp = node->next;
+            free(node);
+        }
+    }
+    free(hm.buckets);
+}
+
+// every name is looked up LOOKUP_ROUNDS times, then as many names which aren't in the catalog
+static char (*names)[9];
+static char (*missing)[9];
+
+static size_t check_lookups(size_t found, size_t expected) {
+    if(found != expected) {
+        fprintf(stderr, "Found %zu of %zu names.\n", found, expected);
+        exit(1);
+    }
+    return found;
+}
+
+static void bench_chained(const char* name, size_t bucket_count) {
+    double beg, insert = 0.0, lookup = 0.0;
+    size_t found;
+    uint32_t i;
+    int run, round;
+    for(run = 0; run < BENCH_RUNS; ++run) {
+        ChainedMap hm;
+        if(ChainedMap_init(&hm, bucket_count, sizeof(uint32_t))) exit(1);
+        beg = bench_seconds();
+        for(i = 0; i < CATALOG_SIZE; ++i) if(ChainedMap_insert(&hm, names[i], &i)) exit(1);
+        beg = bench_seconds() - beg;
+        if(run == 0 || beg < insert) insert = beg;
+        beg = bench_seconds();
+        for(round = 0, found = 0; round < LOOKUP_ROUNDS; ++round) {
+            for(i = 0; i < CATALOG_SIZE; ++i) found += ChainedMap_get(hm, names[i]) != NULL;
+            for(i = 0; i < CATALOG_SIZE; ++i) found += ChainedMap_get(hm, missing[i]) != NULL;
+        }
+        beg = bench_seconds() - beg;
+        check_lookups(found, (size_t) CATALOG_SIZE * LOOKUP_ROUNDS);
+        if(run == 0 || beg < lookup) lookup = beg;
+        ChainedMap_free(hm);
+    }
+    printf("%s\n", name);
+    bench_report("  insert", insert, CATALOG_SIZE, "keys");
+    bench_report("  lookup, half missing", lookup, 2.0 * CATALOG_SIZE * LOOKUP_ROUNDS, "keys");
+}
+
+static void bench_robin_hood(const char* name, unsigned int reserve) {
+    double beg, insert = 0.0, lookup = 0.0;
+    size_t found;
+    uint32_t i;
+    int run, round;
+    for(run = 0; run < BENCH_RUNS; ++run) {
+        HashMap hm;
+        if(HashMap_init(&hm, 0, sizeof(uint32_t))) exit(1);
+        beg = bench_seconds();
+        if(reserve && HashMap_reserve(&hm, CATALOG_SIZE)) exit(1);
+        for(i = 0; i < CATALOG_SIZE; ++i) if(HashMap_insert(&hm, names[i], &i)) exit(1);
+        beg = bench_seconds() - beg;
+        if(run == 0 || beg < insert) insert = beg;
+        beg = bench_seconds();
+        for(round = 0, found = 0; round < LOOKUP_ROUNDS; ++round) {
+            for(i = 0; i < CATALOG_SIZE; ++i) found += HashMap_get(hm, names[i]) != NULL;
+            for(i = 0; i < CATALOG_SIZE; ++i) found += HashMap_get(hm, missing[i]) != NULL;
+        }
+        beg = bench_seconds() - beg;
+        check_lookups(found, (size_t) CATALOG_SIZE * LOOKUP_ROUNDS);
+        if(run == 0 || beg < lookup) lookup = beg;
+        HashMap_free(hm);
+    }
+    printf("%s\n", name);
+    bench_report("  insert", insert, CATALOG_SIZE, "keys");
+    bench_report("  lookup, half missing", lookup, 2.0 * CATALOG_SIZE * LOOKUP_ROUNDS, "keys");
+}
+
+int main(void) {
+    names = (char (*)[9]) malloc(CATALOG_SIZE * 9);
+    missing = (char (*)[9]) malloc(CATALOG_SIZE * 9);
+    if(names == NULL || missing == NULL) return 1;
+    for(size_t i = 0; i < CATALOG_SIZE; ++i) {
+        synth_source_name(i, names[i]);
+        synth_source_name(i + CATALOG_SIZE, missing[i]);
+    }
+    printf("%d ICRF3-style source names\n", CATALOG_SIZE);
+    bench_chained("chained, 10 buckets", CHAINED_BUCKET_COUNT);
+    bench_chained("chained, 8192 buckets", 8192);
+    bench_robin_hood("Robin Hood, grown", 0);
+    bench_robin_hood("Robin Hood, reserved", 1);
+    free(names);
+    free(missing);
+    return 0;
+}
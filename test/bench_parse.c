@@ -0,0 +1,150 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "skd.h"
+#include "bench.h"
+#include "synth.h"
+
+// $SKED scans per second, for the tokenizer and for the sscanf parser it replaced, on schedules of over a million lines
+static const SynthDesc PARSE = {
+    .station_count = 256,
+    .source_count = 4500,
+    .scan_count = (1 << 20) + 1000,
+    .span = 7 * 86400,
+    .start = { .yrs = 2025, .day = 358, .hrs = 0, .min = 0, .sec = 0 },
+    .seed = 3,
+};
+
+typedef struct {
+    char source[9];
+    uint32_t cal_duration, obs_duration;
+    Datetime timestamp;
+    char ids[2 * SYNTH_MAX_IDS + 1];
+    uint32_t* scan_offsets;
+} LegacyScan;
+
+// Datetime_parse_from_scan, which built a sscanf format from "y2d3h2m2s2" for every scan
+static unsigned int legacy_parse_datetime(Datetime* dt, const char* format, const char* line) {
+    char ord[6] = {'\0',}, fmt[16] = {'\0',};
+    size_t i, j;
+    for(i = 0; i < strlen(format) / 2; ++i) {
+        j = strlen(ord);
+        ord[j] = format[i * 2];
+        ord[j + 1] = '\0';
+        j = strlen(fmt);
+        strcpy(&(fmt[j]), "%*u");
+        fmt[j + 1] = format[i * 2 + 1];
+    }
+    unsigned int val[5];
+    if(strlen(ord) != 5 || sscanf(line, fmt, &(val[0]), &(val[1]), &(val[2]), &(val[3]), &(val[4])) != 5) return 1;
+    dt->yrs = (uint16_t) val[0];
+    dt->day = (uint16_t) val[1];
+    dt->hrs = (uint8_t) val[2];
+    dt->min = (uint8_t) val[3];
+    dt->sec = (uint16_t) val[4];
+    return 0;
+}
+
+// the scan line parser before the tokenizer, with the cable wrap read with 2-character keys
+static unsigned int legacy_parse_scan_line(LegacyScan* current, const char* line) {
+    char timestamp_raw[12];
+    char cable_wrap[strlen(line) + 1];
+    size_t j, k = 0;
+    int ret = sscanf(line, " %8s %u %*c%*c %*s %11s %u %*s %*u %*s %s %*s \n",
+        current->source, &(current->cal_duration), timestamp_raw, &(current->obs_duration), cable_wrap);
+    if(ret != 5 || legacy_parse_datetime(&(current->timestamp), "y2d3h2m2s2", timestamp_raw)) return 1;
+    if(strlen(cable_wrap) % 3 != 0 || strlen(cable_wrap) / 3 > SYNTH_MAX_IDS) return 1;
+    for(j = 0; j < strlen(cable_wrap) / 3; ++j) memcpy(&(current->ids[j * 2]), &(cable_wrap[j * 3]), 2);
+    current->ids[j * 2] = '\0';
+    current->scan_offsets = (uint32_t*) malloc(j * sizeof(uint32_t) + 1);
+    if(current->scan_offsets == NULL) return 1;
+    const char* line_offset = &(line[4]);
+    while(line_offset[0] != '\n' && line_offset[0] != '\0') {
+        if(((line_offset - 4)[0] == 'Y' || (line_offset - 4)[0] == 'N') && \
+            ((line_offset - 3)[0] == 'Y' || (line_offset - 3)[0] == 'N') && \
+            ((line_offset - 2)[0] == 'Y' || (line_offset - 2)[0] == 'N') && \
+            ((line_offset - 1)[0] == 'Y' || (line_offset - 1)[0] == 'N')) break;
+        line_offset += 1;
+    }
+    while(k < j && sscanf(line_offset, " %u", &(current->scan_offsets[k])) == 1) {
+        while(isspace(line_offset[0])) line_offset++;
+        while(isdigit(line_offset[0])) line_offset++;
+        k++;
+    }
+    for(; k < j; ++k) current->scan_offsets[k] = 0;
+    return 0;
+}
+
+// every line was copied out of the section before it was parsed
+static size_t legacy_parse_sked(const char* beg, const char* end) {
+    char* line = NULL;
+    size_t line_cap = 0, len, scan_count = 0;
+    LegacyScan scan;
+    while(beg < end) {
+        const char* line_end = (const char*) memchr(beg, '\n', (size_t) (end - beg));
+        if(line_end == NULL) line_end = end;
+        len = (size_t) (line_end - beg);
+        if(len + 2 > line_cap) {
+            line_cap = len + 2;
+            line = (char*) realloc(line, line_cap);
+            if(line == NULL) return 0;
+        }
+        memcpy(line, beg, len);
+        line[len] = '\n';
+        line[len + 1] = '\0';
+        if(!legacy_parse_scan_line(&scan, line)) {
+            free(scan.scan_offsets);
+            scan_count++;
+        }
+        beg = line_end + 1;
+    }
+    free(line);
+    return scan_count;
+}
+
+int main(void) {
+    char* text = synth_schedule(PARSE);
+    if(text == NULL) {
+        fprintf(stderr, "Unable to generate the schedule.\n");
+        return 1;
+    }
+    const char* sked = strstr(text, "$SKED\n") + 6;
+    const char* end = text + strlen(text);
+    double beg, legacy = 0.0, tokenizer = 0.0;
+    size_t scan_count = 0;
+    for(int run = 0; run < BENCH_RUNS; ++run) {
+        beg = bench_seconds();
+        scan_count = legacy_parse_sked(sked, end);
+        beg = bench_seconds() - beg;
+        if(run == 0 || beg < legacy) legacy = beg;
+    }
+    if(scan_count != PARSE.scan_count) {
+        fprintf(stderr, "sscanf parser read %zu of %zu scans.\n", scan_count, PARSE.scan_count);
+        return 1;
+    }
+    // the whole build, stations, sources and the scan index included
+    Schedule skd;
+    for(int run = 0; run < BENCH_RUNS; ++run) {
+        char* src = strdup(text);
+        beg = bench_seconds();
+        if(src == NULL || Schedule_build_from_memory(&skd, "test/no_such_file.skd", src)) {
+            fprintf(stderr, "Unable to build the schedule.\n");
+            return 1;
+        }
+        beg = bench_seconds() - beg;
+        scan_count = skd.scan_count;
+        Schedule_free(skd);
+        if(run == 0 || beg < tokenizer) tokenizer = beg;
+    }
+    if(scan_count != PARSE.scan_count) {
+        fprintf(stderr, "Schedule holds %zu of %zu scans.\n", scan_count, PARSE.scan_count);
+        return 1;
+    }
+    printf("%zu $SKED lines, %zu stations, %zu sources\n", PARSE.scan_count, PARSE.station_count, PARSE.source_count);
+    bench_report("sscanf scan lines", legacy, (double) PARSE.scan_count, "scans");
+    bench_report("Schedule_build_from_memory", tokenizer, (double) PARSE.scan_count, "scans");
+    printf("%.1fx the scans per second\n", legacy / tokenizer);
+    free(text);
+    return 0;
+}
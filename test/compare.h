@@ -0,0 +1,36 @@
+#ifndef __COMPARE_H__
+#define __COMPARE_H__
+
+#include <string.h>
+#include "skd.h"
+
+// two Schedules hold the same stations, sources and scans, no matter how either was built
+#pragma GCC diagnostic ignored "-Wunused-function"
+static unsigned int same_schedule(Schedule fst, Schedule snd) {
+    size_t i, members;
+    if(fst.station_count != snd.station_count || fst.source_count != snd.source_count || fst.scan_count != snd.scan_count) return 0;
+    for(i = 0; i < fst.station_count; ++i) {
+        const Station* a = &(fst.stations[i]);
+        const Station* b = &(snd.stations[i]);
+        if(strcmp(a->key, b->key) != 0 || strcmp(a->id, b->id) != 0 || strcmp(a->pos.name, b->pos.name) != 0) return 0;
+        if(a->pos.lam != b->pos.lam || a->pos.phi != b->pos.phi) return 0;
+    }
+    for(i = 0; i < fst.source_count; ++i) {
+        const Source* a = &(fst.sources[i]);
+        const Source* b = &(snd.sources[i]);
+        if(strcmp(a->iau, b->iau) != 0 || strcmp(a->point.name, b->point.name) != 0) return 0;
+        if(a->point.alf != b->point.alf || a->point.phi != b->point.phi) return 0;
+    }
+    members = fst.scans.station_beg[fst.scan_count];
+    return fst.scans.set_words == snd.scans.set_words && members == snd.scans.station_beg[snd.scan_count] &&
+        memcmp(fst.scans.timestamp, snd.scans.timestamp, fst.scan_count * sizeof(TimeMs)) == 0 &&
+        memcmp(fst.scans.cal_duration, snd.scans.cal_duration, fst.scan_count * sizeof(uint32_t)) == 0 &&
+        memcmp(fst.scans.obs_duration, snd.scans.obs_duration, fst.scan_count * sizeof(uint32_t)) == 0 &&
+        memcmp(fst.scans.source, snd.scans.source, fst.scan_count * sizeof(uint32_t)) == 0 &&
+        memcmp(fst.scans.station_beg, snd.scans.station_beg, (fst.scan_count + 1) * sizeof(uint32_t)) == 0 &&
+        memcmp(fst.scans.stations, snd.scans.stations, members * sizeof(uint16_t)) == 0 &&
+        memcmp(fst.scans.offsets, snd.scans.offsets, members * sizeof(uint32_t)) == 0 &&
+        memcmp(fst.scans.station_sets, snd.scans.station_sets, fst.scan_count * fst.scans.set_words * sizeof(uint64_t)) == 0;
+}
+
+#endif /* __COMPARE_H__ */
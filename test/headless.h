@@ -0,0 +1,86 @@
+#ifndef __HEADLESS_H__
+#define __HEADLESS_H__
+
+#include <glenv.h>
+#include "camera.h"
+#include "skd_pass.h"
+#include "ui.h"
+
+// stands in for the OpenGL context, the camera and the Overlay panels so a SchedulePass can run without a window
+// include it in a single file of a test, since it defines the GLEW function pointers and the GL entry points
+// only the draw calls are recorded, every object is handle 1 and every uniform is found
+static struct {
+    GLsizei points, lines; // vertices drawn by the last glDrawArrays of either mode
+    size_t line_draws;
+    OverlayControls controls;
+    float seek;
+} Headless;
+
+static GLuint headless_create(void) { return 1; }
+static GLuint headless_create_shader(GLenum type) { (void) type; return 1; }
+static void headless_id(GLuint id) { (void) id; }
+static void headless_attach(GLuint program, GLuint shader) { (void) program; (void) shader; }
+static GLint headless_uniform(GLuint program, const GLchar* name) { (void) program; (void) name; return 1; }
+static void headless_uniform1f(GLint loc, GLfloat v) { (void) loc; (void) v; }
+static void headless_uniform3f(GLint loc, GLfloat a, GLfloat b, GLfloat c) { (void) loc; (void) a; (void) b; (void) c; }
+static void headless_gen(GLsizei count, GLuint* ids) { for(GLsizei i = 0; i < count; ++i) ids[i] = 1; }
+static void headless_delete(GLsizei count, const GLuint* ids) { (void) count; (void) ids; }
+static void headless_bind(GLenum target, GLuint id) { (void) target; (void) id; }
+static void headless_data(GLenum target, GLsizeiptr size, const void* data, GLenum usage) { (void) target; (void) size; (void) data; (void) usage; }
+static void headless_attrib(GLuint idx, GLint size, GLenum type, GLboolean norm, GLsizei stride, const void* ptr) {
+    (void) idx; (void) size; (void) type; (void) norm; (void) stride; (void) ptr;
+}
+static void headless_status(GLuint id, GLenum name, GLint* v) { (void) id; (void) name; *v = GL_TRUE; }
+static void headless_log(GLuint id, GLsizei cap, GLsizei* len, GLchar* log) { (void) id; (void) cap; (void) len; (void) log; }
+static void headless_source(GLuint id, GLsizei count, const GLchar* const* str, const GLint* len) { (void) id; (void) count; (void) str; (void) len; }
+
+PFNGLATTACHSHADERPROC __glewAttachShader = headless_attach;
+PFNGLBINDBUFFERPROC __glewBindBuffer = headless_bind;
+PFNGLBINDVERTEXARRAYPROC __glewBindVertexArray = headless_id;
+PFNGLBUFFERDATAPROC __glewBufferData = headless_data;
+PFNGLCOMPILESHADERPROC __glewCompileShader = headless_id;
+PFNGLCREATEPROGRAMPROC __glewCreateProgram = headless_create;
+PFNGLCREATESHADERPROC __glewCreateShader = headless_create_shader;
+PFNGLDELETEBUFFERSPROC __glewDeleteBuffers = headless_delete;
+PFNGLDELETEPROGRAMPROC __glewDeleteProgram = headless_id;
+PFNGLDELETESHADERPROC __glewDeleteShader = headless_id;
+PFNGLDELETEVERTEXARRAYSPROC __glewDeleteVertexArrays = headless_delete;
+PFNGLENABLEVERTEXATTRIBARRAYPROC __glewEnableVertexAttribArray = headless_id;
+PFNGLGENBUFFERSPROC __glewGenBuffers = headless_gen;
+PFNGLGENVERTEXARRAYSPROC __glewGenVertexArrays = headless_gen;
+PFNGLGETPROGRAMIVPROC __glewGetProgramiv = headless_status;
+PFNGLGETSHADERINFOLOGPROC __glewGetShaderInfoLog = headless_log;
+PFNGLGETSHADERIVPROC __glewGetShaderiv = headless_status;
+PFNGLGETUNIFORMLOCATIONPROC __glewGetUniformLocation = headless_uniform;
+PFNGLLINKPROGRAMPROC __glewLinkProgram = headless_id;
+PFNGLSHADERSOURCEPROC __glewShaderSource = headless_source;
+PFNGLUNIFORM1FPROC __glewUniform1f = headless_uniform1f;
+PFNGLUNIFORM3FPROC __glewUniform3f = headless_uniform3f;
+PFNGLUSEPROGRAMPROC __glewUseProgram = headless_id;
+PFNGLVERTEXATTRIBPOINTERPROC __glewVertexAttribPointer = headless_attrib;
+
+void glEnable(GLenum cap) { (void) cap; }
+void glDisable(GLenum cap) { (void) cap; }
+void glPointSize(GLfloat size) { (void) size; }
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    (void) first;
+    if(mode == GL_LINES) {
+        Headless.lines = count;
+        Headless.line_draws++;
+    } else {
+        Headless.points = count;
+    }
+}
+
+RGFW_bool RGFW_isPressed(RGFW_window* win, RGFW_key key) { (void) win; (void) key; return 0; }
+unsigned int Camera_update_uniforms(const Camera* const cam, GLuint shader_program) { (void) cam; (void) shader_program; return 0; }
+void Overlay_set_controls(const OverlayControls controls) { Headless.controls = controls; }
+float Overlay_get_seek() { return Headless.seek; }
+
+// a fragment shader with a fixed id, so assemble_shader_program has nothing to compile
+static SchedulePassDesc headless_pass_desc(Shader* frag) {
+    *frag = (Shader) { .loc = SHADER_LOC_ID, .type = GL_FRAGMENT_SHADER, .inner = { .id = 1 } };
+    return (SchedulePassDesc) { .globe_radius = 1.f, .shell_radius = 4.f, .vert = NULL, .frag = frag };
+}
+
+#endif /* __HEADLESS_H__ */
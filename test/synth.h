@@ -0,0 +1,165 @@
+#ifndef __SYNTH_H__
+#define __SYNTH_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util/mjd.h"
+#include "skd.h"
+
+// generates synthetic sked schedules far larger than any real session, for stress tests and benchmarks
+// scans start evenly over the span and are drawn from a seeded generator, so SynthGen_next can replay the schedule
+// that was written to check what it parsed into
+#define SYNTH_MAX_STATIONS 1024
+#define SYNTH_MAX_IDS 6
+// one scan in every SYNTH_LONG_EVERY runs longer than UINT16_MAX seconds
+#define SYNTH_LONG_EVERY 5000
+#define SYNTH_CAL_DURATION 10
+// scans of the day synth_build lays out
+#define SYNTH_BUILD_SCANS 20000
+
+typedef struct {
+    size_t station_count, source_count, scan_count;
+    uint32_t span; // seconds
+    Datetime start;
+    uint64_t seed;
+} SynthDesc;
+
+typedef struct {
+    SynthDesc desc;
+    uint64_t state;
+    size_t scan;
+} SynthGen;
+
+typedef struct {
+    size_t source;
+    Datetime start;
+    uint32_t obs_duration;
+    size_t id_count;
+    size_t stations[SYNTH_MAX_IDS];
+    uint32_t offsets[SYNTH_MAX_IDS];
+} SynthScan;
+
+static uint64_t SynthGen_rand(SynthGen* gen) {
+    // xorshift64*
+    gen->state ^= gen->state >> 12;
+    gen->state ^= gen->state << 25;
+    gen->state ^= gen->state >> 27;
+    return gen->state * 2685821657736338717ull;
+}
+
+static SynthGen SynthGen_init(SynthDesc desc) {
+    return (SynthGen) { .desc = desc, .state = desc.seed | 1, .scan = 0 };
+}
+
+// ICRF3-style B1950 name, hhmm+ddd, unique for the first 14400 sources
+static void synth_source_name(size_t i, char name[9]) {
+    snprintf(name, 9, "%02u%02u%c%03u", (unsigned int) (i % 24), (unsigned int) (i / 24 % 60),
+        (i % 97 % 2 == 0) ? '+' : '-', (unsigned int) ((i / 1440 % 10 * 100 + i % 97) % 1000));
+}
+
+// 2-character keys skip whitespace, '-' (the cable wrap) and '$' (sections)
+static void synth_station_key(size_t i, char key[3]) {
+    static const char* alphabet = "!\"#%&'()*+,./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
+    size_t len = strlen(alphabet);
+    key[0] = alphabet[i / len % len];
+    key[1] = alphabet[i % len];
+    key[2] = '\0';
+}
+
+static void synth_station_id(size_t i, char id[3]) {
+    id[0] = (char) ('A' + i / 26 % 26);
+    id[1] = (char) ('a' + i % 26);
+    id[2] = '\0';
+}
+
+static unsigned int SynthGen_next(SynthGen* gen, SynthScan* scan) {
+    const SynthDesc* desc = &(gen->desc);
+    if(gen->scan >= desc->scan_count) return 0;
+    size_t i, j, max_ids = (desc->station_count < SYNTH_MAX_IDS) ? desc->station_count : SYNTH_MAX_IDS;
+    uint32_t secs = (uint32_t) ((uint64_t) gen->scan * desc->span / desc->scan_count);
+    scan->start = Datetime_add_seconds(desc->start, secs);
+    scan->source = (size_t) (SynthGen_rand(gen) % desc->source_count);
+    scan->obs_duration = 30 + (uint32_t) (SynthGen_rand(gen) % 571);
+    if(gen->scan % SYNTH_LONG_EVERY == SYNTH_LONG_EVERY - 1) scan->obs_duration = 70000 + (uint32_t) (SynthGen_rand(gen) % 130000);
+    scan->id_count = (max_ids < 2) ? max_ids : 2 + (size_t) (SynthGen_rand(gen) % (max_ids - 1));
+    for(i = 0; i < scan->id_count; ++i) {
+        // stations of a scan are distinct
+        do {
+            scan->stations[i] = (size_t) (SynthGen_rand(gen) % desc->station_count);
+            for(j = 0; j < i && scan->stations[j] != scan->stations[i]; ++j);
+        } while(j < i);
+        scan->offsets[i] = 1 + (uint32_t) (SynthGen_rand(gen) % scan->obs_duration);
+    }
+    gen->scan++;
+    return 1;
+}
+
+// text of the whole schedule, NULL if it couldn't be allocated
+// recorder codes are left out of the $SKED lines, they're skipped when parsing anyway
+static char* synth_schedule(SynthDesc desc) {
+    size_t i, len = 0, cap = 4096 + desc.station_count * 256 + desc.source_count * 128 + desc.scan_count * (96 + SYNTH_MAX_IDS * 16);
+    char* text = (char*) malloc(cap);
+    if(text == NULL || desc.station_count > SYNTH_MAX_STATIONS || desc.source_count == 0) {
+        free(text);
+        return NULL;
+    }
+    char key[3], id[3], name[9];
+    len += (size_t) snprintf(&(text[len]), cap - len, "$EXPER synth\n$STATIONS\n");
+    for(i = 0; i < desc.station_count; ++i) {
+        synth_station_key(i, key);
+        synth_station_id(i, id);
+        len += (size_t) snprintf(&(text[len]), cap - len,
+            "A %s ST%05zu  AZEL  0.00250    60.0  40  278.0  802.0   30.0  40   12.0   80.0  32.0   %s  %s  %s \n", key, i, id, id, id);
+    }
+    for(i = 0; i < desc.station_count; ++i) {
+        synth_station_id(i, id);
+        len += (size_t) snprintf(&(text[len]), cap - len,
+            "P %s ST%05zu     -838201.2872    3865751.5522    4987670.8647  00000000   %.2f  %.2f 2020c \n",
+            id, i, (double) (i * 137 % 360), (double) (i * 53 % 140) - 60.0);
+    }
+    len += (size_t) snprintf(&(text[len]), cap - len, "$SOURCES\n");
+    for(i = 0; i < desc.source_count; ++i) {
+        synth_source_name(i, name);
+        len += (size_t) snprintf(&(text[len]), cap - len,
+            " %s $          %02zu %02zu %02zu.000000    %c%02zu %02zu  00.00000 2000.0 0.0 ICRF3 def \n",
+            name, i % 24, i / 24 % 60, i % 60, (name[4] == '+') ? '+' : '-', i % 90, i % 60);
+    }
+    len += (size_t) snprintf(&(text[len]), cap - len, "$SKED\n");
+    SynthGen gen = SynthGen_init(desc);
+    SynthScan scan;
+    while(SynthGen_next(&gen, &scan)) {
+        synth_source_name(scan.source, name);
+        len += (size_t) snprintf(&(text[len]), cap - len, "%-8s  %2u SX PREOB  %02u%03u%02u%02u%02u %9u MIDOB         0 POSTOB ",
+            name, SYNTH_CAL_DURATION, (unsigned int) (scan.start.yrs % 100), (unsigned int) scan.start.day,
+            (unsigned int) scan.start.hrs, (unsigned int) scan.start.min, (unsigned int) scan.start.sec, scan.obs_duration);
+        for(i = 0; i < scan.id_count; ++i) {
+            synth_station_key(scan.stations[i], key);
+            len += (size_t) snprintf(&(text[len]), cap - len, "%s-", key);
+        }
+        len += (size_t) snprintf(&(text[len]), cap - len, " YYNN");
+        for(i = 0; i < scan.id_count; ++i) len += (size_t) snprintf(&(text[len]), cap - len, " %5u", scan.offsets[i]);
+        text[len++] = '\n';
+    }
+    text[len] = '\0';
+    return text;
+}
+
+// parses a day of SYNTH_BUILD_SCANS scans over 300 sources and station_count stations
+// returns what Schedule_build_from_memory does, or 1 if the text couldn't be generated
+static unsigned int synth_build(Schedule* skd, size_t station_count, uint64_t seed) {
+    SynthDesc desc = {
+        .station_count = station_count,
+        .source_count = 300,
+        .scan_count = SYNTH_BUILD_SCANS,
+        .span = 86400,
+        .start = { .yrs = 2025, .day = 30, .hrs = 18, .min = 30, .sec = 0 },
+        .seed = seed,
+    };
+    char* text = synth_schedule(desc);
+    if(text == NULL) return 1;
+    return Schedule_build_from_memory(skd, "test/no_such_file.skd", text);
+}
+
+#endif /* __SYNTH_H__ */
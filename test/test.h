@@ -0,0 +1,32 @@
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// tests are run from the repository's root by make test, every test is a single executable
+// a failed CHECK is reported and counted, the test keeps going so one run shows every failure
+static unsigned int test_failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while(0)
+
+// a failed REQUIRE stops the test, for checks which everything after them relies on
+#define REQUIRE(cond) do { \
+    if(!(cond)) { \
+        fprintf(stderr, "%s:%d: REQUIRE(%s) failed\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while(0)
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+static int test_result(const char* name) {
+    printf("%s: %s\n", name, (test_failures == 0) ? "passed" : "FAILED");
+    return (test_failures == 0) ? 0 : 1;
+}
+
+#endif /* __TEST_H__ */
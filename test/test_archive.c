@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "skd.h"
+#include "util/fio.h"
+#include "util/archive.h"
+#include "compare.h"
+#include "test.h"
+
+// the example compressed by zlib and zstd, every stream has to decode to the example itself
+// fixed: a single member of fixed-Huffman blocks
+// dynamic: gzip -9, with the original file name in its header
+// members: the first half in a dynamic-Huffman member, the second half in a fixed-Huffman one
+#define EXAMPLE "examples/r41192.skd"
+#define FIXED "test/data/r41192_fixed.skd.gz"
+#define DYNAMIC "test/data/r41192_dynamic.skd.gz"
+#define MEMBERS "test/data/r41192_members.skd.gz"
+#define ZSTD "test/data/r41192.skd.zst"
+// largest stored block
+#define STORED_MAX 65535
+
+typedef struct {
+    unsigned char* data;
+    size_t len;
+} Bytes;
+
+static Bytes read_bytes(const char* path) {
+    FILE* stream = fopen(path, "rb");
+    REQUIRE(stream != NULL);
+    REQUIRE(fseek(stream, 0, SEEK_END) == 0);
+    long len = ftell(stream);
+    REQUIRE(len > 0);
+    rewind(stream);
+    Bytes bytes = { .data = (unsigned char*) malloc((size_t) len), .len = (size_t) len };
+    REQUIRE(bytes.data != NULL && fread(bytes.data, 1, bytes.len, stream) == bytes.len);
+    fclose(stream);
+    return bytes;
+}
+
+// archives are written to a temporary file, so the compiled image a build leaves behind never lands in the tree
+static void write_temp(char path[32], const unsigned char* data, size_t len) {
+    strcpy(path, "/tmp/vis_test_XXXXXX");
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    FILE* stream = fdopen(fd, "wb");
+    REQUIRE(stream != NULL && fwrite(data, 1, len, stream) == len);
+    fclose(stream);
+}
+
+static void remove_temp(const char* path) {
+    char image[64];
+    snprintf(image, sizeof(image), "%s.skdb", path);
+    remove(image);
+    remove(path);
+}
+
+static uint32_t crc32_of(const unsigned char* data, size_t len) {
+    uint32_t crc = 0xffffffffu;
+    for(size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for(int k = 0; k < 8; ++k) crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320u : crc >> 1;
+    }
+    return crc ^ 0xffffffffu;
+}
+
+static void put_le(unsigned char* out, uint32_t value, size_t bytes) {
+    for(size_t i = 0; i < bytes; ++i) out[i] = (unsigned char) (value >> (8 * i));
+}
+
+// a gzip member of stored blocks, which zlib only writes at level 0
+// an empty block leads, so a stored block ending right where the next one starts is covered too
+static Bytes stored_gzip(const char* src, size_t len) {
+    size_t block_count = len / STORED_MAX + 2, i, at, piece;
+    Bytes bytes = { .data = (unsigned char*) malloc(10 + block_count * 5 + len + 8), .len = 0 };
+    REQUIRE(bytes.data != NULL);
+    static const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+    memcpy(bytes.data, header, sizeof(header));
+    bytes.len = sizeof(header);
+    for(i = 0, at = 0; i < block_count; ++i) {
+        piece = (i == 0) ? 0 : len - at;
+        if(piece > STORED_MAX) piece = STORED_MAX;
+        bytes.data[bytes.len++] = (i + 1 == block_count) ? 1 : 0;
+        put_le(&(bytes.data[bytes.len]), (uint32_t) piece, 2);
+        put_le(&(bytes.data[bytes.len + 2]), (uint32_t) ~piece & 0xffff, 2);
+        bytes.len += 4;
+        memcpy(&(bytes.data[bytes.len]), &(src[at]), piece);
+        bytes.len += piece;
+        at += piece;
+    }
+    REQUIRE(at == len);
+    put_le(&(bytes.data[bytes.len]), crc32_of((const unsigned char*) src, len), 4);
+    put_le(&(bytes.data[bytes.len + 4]), (uint32_t) len, 4);
+    bytes.len += 8;
+    return bytes;
+}
+
+// decodes all of path in pieces of uneven sizes, returns whether the archive failed
+static unsigned int decode(const char* path, char** out, size_t* out_len) {
+    static const size_t pieces[] = { 1, 7, 4093, 65536, 3 };
+    Archive archive;
+    REQUIRE(!Archive_open(&archive, path));
+    size_t cap = 1 << 16, len = 0, got, k = 0;
+    char* text = (char*) malloc(cap);
+    REQUIRE(text != NULL);
+    for(;;) {
+        if(len + 65536 > cap) {
+            cap *= 2;
+            text = (char*) realloc(text, cap);
+            REQUIRE(text != NULL);
+        }
+        got = Archive_read(&archive, &(text[len]), pieces[k++ % (sizeof(pieces) / sizeof(pieces[0]))]);
+        if(got == 0) break;
+        len += got;
+    }
+    unsigned int failure = archive.failure;
+    Archive_close(&archive);
+    *out = text;
+    *out_len = len;
+    return failure;
+}
+
+// the archive decodes to the example and parses into the same Schedule as the plain text
+static void check_archive(const char* name, const unsigned char* data, size_t len, const char* plain, Schedule want) {
+    char path[32], *text;
+    size_t text_len;
+    write_temp(path, data, len);
+    if(decode(path, &text, &text_len) || text_len != strlen(plain) || memcmp(text, plain, text_len) != 0) {
+        fprintf(stderr, "%s: decoded %zu bytes which differ from the example\n", name, text_len);
+        test_failures++;
+    }
+    free(text);
+    Schedule skd;
+    if(Schedule_build_from_source(&skd, path)) {
+        fprintf(stderr, "%s: failed to build\n", name);
+        test_failures++;
+    } else {
+        if(!same_schedule(skd, want)) {
+            fprintf(stderr, "%s: parsed differently from the example\n", name);
+            test_failures++;
+        }
+        Schedule_free(skd);
+    }
+    remove_temp(path);
+}
+
+// a damaged archive fails to decode and to build, instead of passing on what it decoded so far
+static void check_damaged(const char* name, const unsigned char* data, size_t len) {
+    char path[32], *text;
+    size_t text_len;
+    write_temp(path, data, len);
+    if(!decode(path, &text, &text_len)) {
+        fprintf(stderr, "%s: decoded without failing\n", name);
+        test_failures++;
+    }
+    free(text);
+    Schedule skd;
+    if(!Schedule_build_from_source(&skd, path)) {
+        fprintf(stderr, "%s: built without failing\n", name);
+        test_failures++;
+        Schedule_free(skd);
+    }
+    remove_temp(path);
+}
+
+int main(void) {
+    const char* plain = read_file_contents(EXAMPLE);
+    REQUIRE(plain != NULL);
+    Schedule want;
+    REQUIRE(!Schedule_build_from_memory(&want, "test/no_such_file.skd", strdup(plain)));
+    Bytes stored = stored_gzip(plain, strlen(plain));
+    Bytes fixed = read_bytes(FIXED), dynamic = read_bytes(DYNAMIC), members = read_bytes(MEMBERS), zstd = read_bytes(ZSTD);
+    check_archive("stored", stored.data, stored.len, plain, want);
+    check_archive("fixed", fixed.data, fixed.len, plain, want);
+    check_archive("dynamic", dynamic.data, dynamic.len, plain, want);
+    check_archive("members", members.data, members.len, plain, want);
+    check_archive("zstd", zstd.data, zstd.len, plain, want);
+    // cut inside the compressed data, then inside the trailer
+    check_damaged("truncated gzip", dynamic.data, dynamic.len / 2);
+    check_damaged("truncated gzip trailer", dynamic.data, dynamic.len - 3);
+    check_damaged("truncated second member", members.data, members.len - members.len / 4);
+    check_damaged("truncated zstd", zstd.data, zstd.len / 2);
+    // a flipped bit of the CRC, then of the stored data, which only the CRC can catch
+    dynamic.data[dynamic.len - 8] ^= 1;
+    check_damaged("gzip with a wrong CRC", dynamic.data, dynamic.len);
+    stored.data[stored.len / 2] ^= 1;
+    check_damaged("stored gzip with corrupt data", stored.data, stored.len);
+    free(stored.data);
+    free(fixed.data);
+    free(dynamic.data);
+    free(members.data);
+    free(zstd.data);
+    Schedule_free(want);
+    free((void*) plain);
+    return test_result("archive");
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util/hashmap.h"
+#include "synth.h"
+#include "test.h"
+
+// ICRF3 has 4536 sources
+#define CATALOG_SIZE 4536
+
+// an entry is never further from its home slot than one more than the entry before it, or 0 after an empty slot
+// the table is walked twice so the entries which wrapped around are checked against the ones before them
+static unsigned int probes_are_ordered(const HashMap* hm) {
+    size_t mask = hm->cap - 1, i, dist, max_dist = 0;
+    const HashSlot* slot;
+    for(i = 0; i < hm->cap * 2; ++i) {
+        slot = HASHMAP_SLOT(hm, i & mask);
+        if(slot->hash == 0) {
+            max_dist = 0;
+            continue;
+        }
+        dist = ((i & mask) - (slot->hash & mask)) & mask;
+        if(i >= hm->cap && dist > max_dist) return 0;
+        max_dist = dist + 1;
+    }
+    return 1;
+}
+
+// a key which is already present is refused and keeps its value
+static void test_duplicate(void) {
+    HashMap hm;
+    uint32_t val = 1, dup = 2;
+    REQUIRE(!HashMap_init(&hm, 0, sizeof(uint32_t)));
+    CHECK(HashMap_insert(&hm, "0003-066", &val) == 0);
+    CHECK(HashMap_insert(&hm, "0003-066", &dup) == HASHMAP_DUPLICATE);
+    CHECK(hm.size == 1);
+    CHECK(*(uint32_t*) HashMap_get(hm, "0003-066") == 1);
+    // keys are compared in full, not by a prefix or by their hash
+    CHECK(HashMap_insert(&hm, "0003-06", &dup) == 0);
+    CHECK(HashMap_insert(&hm, "0003-0660", &dup) == 0);
+    CHECK(hm.size == 3);
+    // keys don't fit past HASHMAP_KEY_BYTES - 1 characters
+    CHECK(HashMap_insert(&hm, "0123456789abcdef", &val) == 1);
+    CHECK(HashMap_get(hm, "0123456789abcdef") == NULL);
+    CHECK(hm.size == 3);
+    HashMap_free(hm);
+}
+
+// a catalog's worth of names, inserted twice, which leaves the map as it was after the first pass
+static void test_catalog_duplicates(Arena* arena) {
+    HashMap hm;
+    char name[9];
+    uint32_t i, dup = UINT32_MAX;
+    size_t duplicates = 0, wrong = 0;
+    REQUIRE(!HashMap_init_in(&hm, arena, 0, sizeof(uint32_t)));
+    for(i = 0; i < CATALOG_SIZE; ++i) {
+        synth_source_name(i, name);
+        CHECK(HashMap_insert(&hm, name, &i) == 0);
+    }
+    for(i = 0; i < CATALOG_SIZE; ++i) {
+        synth_source_name(i, name);
+        if(HashMap_insert(&hm, name, &dup) == HASHMAP_DUPLICATE) duplicates++;
+    }
+    CHECK(duplicates == CATALOG_SIZE);
+    CHECK(hm.size == CATALOG_SIZE);
+    for(i = 0; i < CATALOG_SIZE; ++i) {
+        synth_source_name(i, name);
+        const uint32_t* val = (const uint32_t*) HashMap_get(hm, name);
+        if(val == NULL || *val != i) wrong++;
+    }
+    CHECK(wrong == 0);
+    CHECK(probes_are_ordered(&hm));
+    HashMap_free(hm);
+}
+
+// the table keeps growing past its load factor, while a reserved table takes as many entries without moving
+static void test_growth(void) {
+    HashMap hm;
+    char name[9];
+    uint32_t i;
+    size_t wrong = 0, grown = 0, cap;
+    REQUIRE(!HashMap_init(&hm, 1, sizeof(uint32_t)));
+    CHECK(hm.cap == HASHMAP_MIN_CAP);
+    for(i = 0; i < CATALOG_SIZE; ++i) {
+        cap = hm.cap;
+        synth_source_name(i, name);
+        CHECK(HashMap_insert(&hm, name, &i) == 0);
+        if(hm.cap != cap) {
+            grown++;
+            // it doubles only once the entries would pass the load factor
+            CHECK(hm.cap == cap * 2);
+            CHECK(i * HASHMAP_LOAD_DEN >= cap * HASHMAP_LOAD_NUM);
+        }
+        CHECK(hm.size * HASHMAP_LOAD_DEN <= hm.cap * HASHMAP_LOAD_NUM);
+    }
+    CHECK(grown > 0);
+    for(i = 0; i < CATALOG_SIZE; ++i) {
+        synth_source_name(i, name);
+        const uint32_t* val = (const uint32_t*) HashMap_get(hm, name);
+        if(val == NULL || *val != i) wrong++;
+    }
+    CHECK(wrong == 0);
+    CHECK(probes_are_ordered(&hm));
+    // reserving less than the size leaves the table alone
+    const unsigned char* slots = hm.slots;
+    cap = hm.cap;
+    CHECK(!HashMap_reserve(&hm, 1));
+    CHECK(hm.slots == slots && hm.cap == cap);
+    // growing keeps every entry
+    CHECK(!HashMap_reserve(&hm, hm.cap * 4));
+    CHECK(hm.cap > cap && hm.size == CATALOG_SIZE);
+    for(i = 0, wrong = 0; i < CATALOG_SIZE; ++i) {
+        synth_source_name(i, name);
+        const uint32_t* val = (const uint32_t*) HashMap_get(hm, name);
+        if(val == NULL || *val != i) wrong++;
+    }
+    CHECK(wrong == 0);
+    CHECK(probes_are_ordered(&hm));
+    HashMap_free(hm);
+    // once reserved, the whole catalog is inserted without the table moving
+    REQUIRE(!HashMap_init(&hm, 0, sizeof(uint32_t)));
+    REQUIRE(!HashMap_reserve(&hm, CATALOG_SIZE));
+    slots = hm.slots;
+    cap = hm.cap;
+    for(i = 0; i < CATALOG_SIZE; ++i) {
+        synth_source_name(i, name);
+        CHECK(HashMap_insert(&hm, name, &i) == 0);
+    }
+    CHECK(hm.slots == slots && hm.cap == cap);
+    CHECK(HashMap_get(hm, "9999+999") == NULL);
+    HashMap_free(hm);
+}
+
+int main(void) {
+    test_duplicate();
+    test_catalog_duplicates(NULL);
+    Arena* arena = Arena_create(1 << 16);
+    REQUIRE(arena != NULL);
+    test_catalog_duplicates(arena);
+    Arena_release(arena);
+    test_growth();
+    return test_result("hashmap");
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "skd.h"
+#include "skd_query.h"
+#include "skd_timeline.h"
+#include "util/fio.h"
+#include "synth.h"
+#include "test.h"
+
+#define EXAMPLE "examples/r41192.skd"
+#define TIMELINE_STEPS 50
+
+// the scans station takes part in and its offset into each, found by walking every scan
+static size_t linear_station_scans(Schedule skd, size_t station, uint32_t* scans, uint32_t* offsets) {
+    size_t i, j, found = 0;
+    for(i = 0; i < skd.scan_count; ++i) {
+        for(j = skd.scans.station_beg[i]; j < skd.scans.station_beg[i + 1]; ++j) {
+            if(skd.scans.stations[j] != station) continue;
+            scans[found] = (uint32_t) i;
+            offsets[found++] = skd.scans.offsets[j];
+        }
+    }
+    return found;
+}
+
+static size_t linear_source_scans(Schedule skd, size_t source, uint32_t* scans) {
+    size_t i, found = 0;
+    for(i = 0; i < skd.scan_count; ++i) if(skd.scans.source[i] == source) scans[found++] = (uint32_t) i;
+    return found;
+}
+
+// every station's and every source's slice of the index matches a walk over the whole scan list
+static void compare_index(const char* name, Schedule skd) {
+    uint32_t* want = (uint32_t*) malloc((skd.scan_count + 1) * sizeof(uint32_t));
+    uint32_t* want_offsets = (uint32_t*) malloc((skd.scan_count + 1) * sizeof(uint32_t));
+    REQUIRE(want != NULL && want_offsets != NULL);
+    const uint32_t* scans;
+    const uint32_t* offsets;
+    size_t i, count, total = 0, wrong_stations = 0, wrong_sources = 0;
+    for(i = 0; i < skd.station_count; ++i) {
+        count = linear_station_scans(skd, i, want, want_offsets);
+        total += count;
+        if(Schedule_station_timeline(skd, i, &scans, &offsets) != count) wrong_stations++;
+        else if(count > 0 && (memcmp(scans, want, count * sizeof(uint32_t)) != 0 || memcmp(offsets, want_offsets, count * sizeof(uint32_t)) != 0)) wrong_stations++;
+    }
+    CHECK(total == skd.scans.station_beg[skd.scan_count]);
+    for(i = 0, total = 0; i < skd.source_count; ++i) {
+        count = linear_source_scans(skd, i, want);
+        total += count;
+        if(Schedule_source_scans(skd, i, &scans) != count) wrong_sources++;
+        else if(count > 0 && memcmp(scans, want, count * sizeof(uint32_t)) != 0) wrong_sources++;
+    }
+    CHECK(total == skd.scan_count);
+    if(wrong_stations > 0 || wrong_sources > 0) fprintf(stderr, "%s: %zu stations and %zu sources differ\n", name, wrong_stations, wrong_sources);
+    CHECK(wrong_stations == 0);
+    CHECK(wrong_sources == 0);
+    // past the schedule's own stations and sources there is nothing
+    CHECK(Schedule_station_timeline(skd, skd.station_count, &scans, &offsets) == 0 && scans == NULL && offsets == NULL);
+    CHECK(Schedule_source_scans(skd, skd.source_count, &scans) == 0 && scans == NULL);
+    free(want);
+    free(want_offsets);
+}
+
+// a timeline advanced step by step through the session ends up where seeking directly puts it
+// and every station is in the last of its scans to have started, or heading to its first
+static void compare_timeline(const char* name, Schedule skd) {
+    StationTimeline walked, sought;
+    REQUIRE(!StationTimeline_build(&walked, skd));
+    REQUIRE(!StationTimeline_build(&sought, skd));
+    // every station's scans, walked once up front
+    size_t member_count = skd.scans.station_beg[skd.scan_count];
+    size_t* beg = (size_t*) malloc((skd.station_count + 1) * sizeof(size_t));
+    uint32_t* want = (uint32_t*) malloc((member_count + 1) * sizeof(uint32_t));
+    uint32_t* want_offsets = (uint32_t*) malloc((member_count + 1) * sizeof(uint32_t));
+    REQUIRE(beg != NULL && want != NULL && want_offsets != NULL);
+    size_t step, i, k, count, wrong = 0;
+    for(i = 0, beg[0] = 0; i < skd.station_count; ++i) beg[i + 1] = beg[i] + linear_station_scans(skd, i, &(want[beg[i]]), &(want_offsets[beg[i]]));
+    REQUIRE(beg[skd.station_count] == member_count);
+    TimeMs first = skd.scans.timestamp[0], last = skd.scans.timestamp[skd.scan_count - 1], ms;
+    for(step = 1; step <= TIMELINE_STEPS; ++step) {
+        ms = first + (last - first) * (TimeMs) step / TIMELINE_STEPS;
+        StationTimeline_advance(&walked, skd, ms);
+        StationTimeline_seek(&sought, skd, ms);
+        if(memcmp(walked.counts, sought.counts, sizeof(walked.counts)) != 0) wrong++;
+        for(i = 0; i < skd.station_count; ++i) {
+            if(walked.stations[i].state != sought.stations[i].state || walked.stations[i].scan != sought.stations[i].scan) wrong++;
+            const uint32_t* own = &(want[beg[i]]);
+            count = beg[i + 1] - beg[i];
+            if(count == 0 || sought.stations[i].scan == SCAN_NONE) continue;
+            for(k = 0; k + 1 < count && skd.scans.timestamp[own[k + 1]] <= ms; ++k);
+            // between two scans the station is already heading to the next one
+            if(sought.stations[i].scan != own[k] && (k + 1 >= count || sought.stations[i].scan != own[k + 1])) wrong++;
+        }
+    }
+    if(wrong > 0) fprintf(stderr, "%s: %zu timeline stations differ\n", name, wrong);
+    CHECK(wrong == 0);
+    free(beg);
+    free(want);
+    free(want_offsets);
+    StationTimeline_free(walked);
+    StationTimeline_free(sought);
+}
+
+// the index is stored in a compiled image and mapped back with it
+static void test_cached_index(const char* src) {
+    char path[] = "/tmp/vis_test_XXXXXX", image[64];
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    FILE* stream = fdopen(fd, "wb");
+    REQUIRE(stream != NULL);
+    fputs(src, stream);
+    fclose(stream);
+    snprintf(image, sizeof(image), "%s.skdb", path);
+    Schedule skd;
+    for(int pass = 0; pass < 2; ++pass) {
+        REQUIRE(!Schedule_build_from_source(&skd, path));
+        CHECK((skd.image.addr != NULL) == (pass == 1));
+        compare_index((pass == 0) ? "parsed" : "mapped", skd);
+        Schedule_free(skd);
+    }
+    remove(image);
+    remove(path);
+}
+
+// 100 and 300 stations, each taking part in a few hundred of the scans
+static void test_synthetic(size_t station_count) {
+    Schedule skd;
+    char name[32];
+    REQUIRE(!synth_build(&skd, station_count, station_count + 1));
+    REQUIRE(skd.station_count == station_count && skd.scan_count == SYNTH_BUILD_SCANS);
+    snprintf(name, sizeof(name), "%zu stations", station_count);
+    compare_index(name, skd);
+    compare_timeline(name, skd);
+    Schedule_free(skd);
+}
+
+int main(void) {
+    Schedule skd;
+    char* src = (char*) read_file_contents(EXAMPLE);
+    REQUIRE(src != NULL);
+    test_cached_index(src);
+    REQUIRE(!Schedule_build_from_memory(&skd, "test/no_such_file.skd", src));
+    compare_index(EXAMPLE, skd);
+    compare_timeline(EXAMPLE, skd);
+    Schedule_free(skd);
+    test_synthetic(100);
+    test_synthetic(300);
+    return test_result("index");
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "skd.h"
+#include "skd_query.h"
+#include "util/fio.h"
+#include "synth.h"
+#include "test.h"
+
+#define EXAMPLE "examples/r41192.skd"
+#define QUERY_ROUNDS 100
+
+static uint64_t rand_state = 13;
+
+static size_t next_rand(size_t bound) {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    return (size_t) (rand_state % bound);
+}
+
+static unsigned int in_set(const StationSet* set, size_t station) {
+    return (set->words[station / STATION_SET_WORD_BITS] >> (station % STATION_SET_WORD_BITS)) & 1;
+}
+
+// the scans' ids compared one by one with every station of the set
+static size_t naive_scans_with(Schedule skd, const StationSet* set, size_t* matches) {
+    size_t members[STATION_COUNT_MAX], member_count = 0, i, j, k, found = 0;
+    for(k = 0; k < STATION_COUNT_MAX; ++k) if(in_set(set, k)) members[member_count++] = k;
+    for(i = 0; i < skd.scan_count; ++i) {
+        for(k = 0; k < member_count; ++k) {
+            for(j = skd.scans.station_beg[i]; j < skd.scans.station_beg[i + 1] && skd.scans.stations[j] != members[k]; ++j);
+            if(j == skd.scans.station_beg[i + 1]) break;
+        }
+        if(k == member_count) matches[found++] = i;
+    }
+    return found;
+}
+
+static size_t naive_scans_within(Schedule skd, const StationSet* set, size_t* matches) {
+    size_t i, j, found = 0;
+    for(i = 0; i < skd.scan_count; ++i) {
+        for(j = skd.scans.station_beg[i]; j < skd.scans.station_beg[i + 1] && in_set(set, skd.scans.stations[j]); ++j);
+        if(j == skd.scans.station_beg[i + 1]) matches[found++] = i;
+    }
+    return found;
+}
+
+static void random_set(StationSet* set, size_t station_count, size_t member_count) {
+    StationSet_clear(set);
+    for(size_t i = 0; i < member_count; ++i) {
+        size_t station = next_rand(station_count);
+        set->words[station / STATION_SET_WORD_BITS] |= (uint64_t) 1 << (station % STATION_SET_WORD_BITS);
+    }
+}
+
+// both queries agree with the naive loops, through the scan index and through the station sets alone
+static void compare_queries(const char* name, Schedule skd) {
+    size_t* got = (size_t*) malloc((skd.scan_count + 1) * sizeof(size_t));
+    size_t* want = (size_t*) malloc((skd.scan_count + 1) * sizeof(size_t));
+    REQUIRE(got != NULL && want != NULL);
+    Schedule unindexed = skd;
+    unindexed.scan_index.station_beg = NULL;
+    StationSet set;
+    size_t i, count, wrong_with = 0, wrong_within = 0, total = 0;
+    for(i = 0; i < skd.station_count + QUERY_ROUNDS * 3; ++i) {
+        // every single station, then pairs, triples and subnets of up to half the stations
+        if(i < skd.station_count) {
+            StationSet_clear(&set);
+            REQUIRE(!StationSet_add(&set, skd, skd.stations[i].key));
+        } else {
+            random_set(&set, skd.station_count, (i % 3 == 0) ? 2 : (i % 3 == 1) ? 3 : 1 + next_rand(skd.station_count / 2 + 1));
+        }
+        count = naive_scans_with(skd, &set, want);
+        total += count;
+        if(Schedule_scans_with(skd, &set, got) != count || memcmp(got, want, count * sizeof(size_t)) != 0) wrong_with++;
+        if(Schedule_scans_with(unindexed, &set, got) != count || memcmp(got, want, count * sizeof(size_t)) != 0) wrong_with++;
+        if(Schedule_scans_with(skd, &set, NULL) != count) wrong_with++;
+        // subnets covering most of the network, so that a good share of the scans fit
+        random_set(&set, skd.station_count, skd.station_count * 2);
+        count = naive_scans_within(skd, &set, want);
+        if(Schedule_scans_within(skd, &set, got) != count || memcmp(got, want, count * sizeof(size_t)) != 0) wrong_within++;
+        if(Schedule_scans_within(skd, &set, NULL) != count) wrong_within++;
+    }
+    if(wrong_with > 0 || wrong_within > 0) fprintf(stderr, "%s: %zu with and %zu within queries differ\n", name, wrong_with, wrong_within);
+    CHECK(wrong_with == 0);
+    CHECK(wrong_within == 0);
+    CHECK(total > 0);
+    // an empty set is in every scan, and every scan is within the whole network
+    StationSet_clear(&set);
+    CHECK(Schedule_scans_with(skd, &set, NULL) == skd.scan_count);
+    for(i = 0; i < skd.station_count; ++i) set.words[i / STATION_SET_WORD_BITS] |= (uint64_t) 1 << (i % STATION_SET_WORD_BITS);
+    CHECK(Schedule_scans_within(skd, &set, NULL) == skd.scan_count);
+    // stations past the schedule's own can't be in any scan
+    StationSet_clear(&set);
+    set.words[STATION_SET_WORDS_MAX - 1] = (uint64_t) 1 << (STATION_SET_WORD_BITS - 1);
+    CHECK(Schedule_scans_with(skd, &set, NULL) == 0);
+    CHECK(Schedule_scans_with(unindexed, &set, NULL) == 0);
+    CHECK(StationSet_add(&set, skd, "??") == 1);
+    free(got);
+    free(want);
+}
+
+// 100 stations fill two words per set, 300 stations five
+static void test_synthetic(size_t station_count) {
+    Schedule skd;
+    char name[32];
+    REQUIRE(!synth_build(&skd, station_count, station_count));
+    REQUIRE(skd.station_count == station_count && skd.scan_count == SYNTH_BUILD_SCANS);
+    CHECK(skd.scans.set_words == STATION_SET_WORDS(station_count));
+    snprintf(name, sizeof(name), "%zu stations", station_count);
+    compare_queries(name, skd);
+    Schedule_free(skd);
+}
+
+int main(void) {
+    Schedule skd;
+    char* src = (char*) read_file_contents(EXAMPLE);
+    REQUIRE(src != NULL);
+    REQUIRE(!Schedule_build_from_memory(&skd, "test/no_such_file.skd", src));
+    compare_queries(EXAMPLE, skd);
+    Schedule_free(skd);
+    test_synthetic(100);
+    test_synthetic(300);
+    return test_result("query");
+}
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "skd.h"
+#include "util/fio.h"
+#include "compare.h"
+#include "test.h"
+
+#define EXAMPLE "examples/r41192.skd"
+// a source of the example, which scans are switched to so that they differ from the original
+#define OTHER_SOURCE "0003-066"
+
+// start of line (counted from 0) of the section opened by header
+static char* section_line(char* text, const char* header, size_t line) {
+    char* at = strstr(text, header);
+    REQUIRE(at != NULL);
+    at = strchr(at, '\n');
+    for(size_t i = 0; at != NULL && i < line; ++i) at = strchr(at + 1, '\n');
+    REQUIRE(at != NULL);
+    return at + 1;
+}
+
+static size_t line_len(const char* line) {
+    const char* end = strchr(line, '\n');
+    return (end == NULL) ? strlen(line) : (size_t) (end - line) + 1;
+}
+
+// copy of text with count lines of $SKED from line on replaced by with
+static char* splice_sked(char* text, size_t line, size_t count, const char* with) {
+    char* beg = section_line(text, "$SKED", line);
+    char* end = beg;
+    for(size_t i = 0; i < count; ++i) end += line_len(end);
+    size_t head = (size_t) (beg - text), with_len = strlen(with), tail = strlen(end);
+    char* out = (char*) malloc(head + with_len + tail + 1);
+    REQUIRE(out != NULL);
+    memcpy(out, text, head);
+    memcpy(out + head, with, with_len);
+    memcpy(out + head + with_len, end, tail + 1);
+    return out;
+}
+
+// line of $SKED observing OTHER_SOURCE instead, at the same time and with the same stations
+static char* switched_line(char* text, size_t line) {
+    const char* beg = section_line(text, "$SKED", line);
+    size_t len = line_len(beg), name_len = strlen(OTHER_SOURCE);
+    char* out = (char*) malloc(len + 1);
+    REQUIRE(out != NULL && len > name_len && strncmp(beg, OTHER_SOURCE, name_len) != 0);
+    memcpy(out, beg, len);
+    memcpy(out, OTHER_SOURCE, name_len);
+    out[len] = '\0';
+    return out;
+}
+
+// copy of text with the first two antennas of $STATIONS in swapped order, so every station index moves
+static char* swap_stations(char* text) {
+    char* fst = section_line(text, "$STATIONS", 0);
+    char* snd = fst + line_len(fst);
+    REQUIRE(fst[0] == 'A' && snd[0] == 'A');
+    size_t fst_len = line_len(fst), snd_len = line_len(snd);
+    char* out = strdup(text);
+    REQUIRE(out != NULL);
+    char* at = out + (fst - text);
+    memcpy(at, snd, snd_len);
+    memcpy(at + snd_len, fst, fst_len);
+    return out;
+}
+
+// scans are told apart by what they observe, not by the indices which a reordered $STATIONS changes
+static unsigned int same_scan(Schedule fst, size_t i, Schedule snd, size_t j) {
+    const ScanTable* a = &(fst.scans);
+    const ScanTable* b = &(snd.scans);
+    if(a->timestamp[i] != b->timestamp[j] || a->cal_duration[i] != b->cal_duration[j] || a->obs_duration[i] != b->obs_duration[j]) return 0;
+    if(strcmp(fst.sources[a->source[i]].iau, snd.sources[b->source[j]].iau) != 0) return 0;
+    size_t count = a->station_beg[i + 1] - a->station_beg[i];
+    if(count != b->station_beg[j + 1] - b->station_beg[j]) return 0;
+    for(size_t k = 0; k < count; ++k) {
+        if(strcmp(fst.stations[a->stations[a->station_beg[i] + k]].key, snd.stations[b->stations[b->station_beg[j] + k]].key) != 0) return 0;
+        if(a->offsets[a->station_beg[i] + k] != b->offsets[b->station_beg[j] + k]) return 0;
+    }
+    return 1;
+}
+
+// the scans which differ between prev and next, after their longest common head and tail
+static ScheduleDiff expected_diff(Schedule prev, Schedule next) {
+    size_t shorter = (prev.scan_count < next.scan_count) ? prev.scan_count : next.scan_count, head = 0, tail = 0;
+    while(head < shorter && same_scan(prev, head, next, head)) head++;
+    while(tail < shorter - head && same_scan(prev, prev.scan_count - 1 - tail, next, next.scan_count - 1 - tail)) tail++;
+    return (ScheduleDiff) { .first = head, .removed = prev.scan_count - head - tail, .added = next.scan_count - head - tail };
+}
+
+// writes text over path and reloads skd from it, which has to come out as a fresh parse of text would
+// prev is the fresh parse of what skd held before, it's replaced by the fresh parse of text
+static void reload(const char* name, Schedule* skd, Schedule* prev, const char* path, char* text, unsigned int stations) {
+    FILE* stream = fopen(path, "wb");
+    REQUIRE(stream != NULL);
+    fputs(text, stream);
+    fclose(stream);
+    Schedule fresh;
+    REQUIRE(!Schedule_build_from_memory(&fresh, "test/no_such_file.skd", text));
+    ScheduleDiff diff, want = expected_diff(*prev, fresh);
+    if(Schedule_reload(skd, path, &diff)) {
+        fprintf(stderr, "%s: failed to reload\n", name);
+        test_failures++;
+    } else {
+        if(!same_schedule(*skd, fresh)) {
+            fprintf(stderr, "%s: reloaded schedule differs from a fresh parse\n", name);
+            test_failures++;
+        }
+        // where nothing was removed or added doesn't matter
+        if(want.removed == 0 && want.added == 0) want.first = diff.first;
+        if(diff.first != want.first || diff.removed != want.removed || diff.added != want.added) {
+            fprintf(stderr, "%s: diff is %zu -%zu +%zu instead of %zu -%zu +%zu\n", name,
+                diff.first, diff.removed, diff.added, want.first, want.removed, want.added);
+            test_failures++;
+        }
+        CHECK(diff.stations == stations && !diff.sources);
+        CHECK(skd->skipped_count == fresh.skipped_count);
+        if(skd->skipped_count == fresh.skipped_count && skd->skipped_count != SIZE_MAX) {
+            CHECK(memcmp(skd->skipped_lines, fresh.skipped_lines, skd->skipped_count * sizeof(size_t)) == 0);
+        }
+        CHECK(!Schedule_debug_and_validate(*skd, 0));
+    }
+    Schedule_free(*prev);
+    *prev = fresh;
+}
+
+// every edit is reloaded on top of the last one, starting either from a parse or from the compiled image
+static void test_edits(const char* plain, unsigned int cached) {
+    char path[] = "/tmp/vis_test_XXXXXX", image[64];
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    FILE* stream = fdopen(fd, "wb");
+    REQUIRE(stream != NULL);
+    fputs(plain, stream);
+    fclose(stream);
+    snprintf(image, sizeof(image), "%s.skdb", path);
+    Schedule skd, prev;
+    REQUIRE(!Schedule_build_from_source(&skd, path));
+    if(cached) {
+        Schedule_free(skd);
+        REQUIRE(!Schedule_build_from_source(&skd, path));
+        REQUIRE(skd.image.addr != NULL);
+    }
+    char* text = strdup(plain);
+    REQUIRE(text != NULL && !Schedule_build_from_memory(&prev, "test/no_such_file.skd", strdup(plain)));
+    char* line;
+    char* next;
+    // edit a single scan
+    line = switched_line(text, 100);
+    next = splice_sked(text, 100, 1, line);
+    free(line);
+    reload("edit", &skd, &prev, path, strdup(next), 0);
+    free(text);
+    text = next;
+    // insert a scan ahead of another at the same time
+    line = switched_line(text, 200);
+    next = splice_sked(text, 200, 0, line);
+    free(line);
+    reload("insert", &skd, &prev, path, strdup(next), 0);
+    free(text);
+    text = next;
+    // delete a few scans
+    next = splice_sked(text, 300, 5, "");
+    reload("delete", &skd, &prev, path, strdup(next), 0);
+    free(text);
+    text = next;
+    // a line which doesn't parse moves the skipped lines after it
+    next = splice_sked(text, 50, 0, "not a scan\n");
+    reload("skipped", &skd, &prev, path, strdup(next), 0);
+    free(text);
+    text = next;
+    // reorder the stations, every kept scan is remapped
+    next = swap_stations(text);
+    reload("stations", &skd, &prev, path, strdup(next), 1);
+    free(text);
+    text = next;
+    // and back, together with another edit
+    next = swap_stations(text);
+    free(text);
+    line = switched_line(next, 400);
+    text = splice_sked(next, 400, 1, line);
+    free(line);
+    free(next);
+    reload("stations and edit", &skd, &prev, path, strdup(text), 1);
+    free(text);
+    Schedule_free(skd);
+    Schedule_free(prev);
+    remove(image);
+    remove(path);
+}
+
+int main(void) {
+    char* plain = (char*) read_file_contents(EXAMPLE);
+    REQUIRE(plain != NULL);
+    test_edits(plain, 0);
+    test_edits(plain, 1);
+    free(plain);
+    return test_result("reload");
+}
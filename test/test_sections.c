@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "skd.h"
+#include "util/fio.h"
+#include "test.h"
+
+#define EXAMPLE "examples/r41192.skd"
+
+// copy of src with text inserted right after the first occurrence of at
+static char* insert_after(const char* src, const char* at, const char* text) {
+    const char* pos = strstr(src, at);
+    REQUIRE(pos != NULL);
+    size_t head = (size_t) (pos - src) + strlen(at), len = strlen(src), text_len = strlen(text);
+    char* out = (char*) malloc(len + text_len + 1);
+    REQUIRE(out != NULL);
+    memcpy(out, src, head);
+    memcpy(out + head, text, text_len);
+    memcpy(out + head + text_len, src + head, len - head + 1);
+    return out;
+}
+
+static size_t station_index(Schedule skd, const char* name) {
+    const Station* station = Schedule_find_station(skd, name);
+    REQUIRE(station != NULL);
+    return (size_t) (station - skd.stations);
+}
+
+static TimeMs ms_at(uint16_t yrs, uint16_t day, uint8_t hrs, uint8_t min) {
+    return Datetime_to_ms((Datetime) { .yrs = yrs, .day = day, .hrs = hrs, .min = min, .sec = 0 });
+}
+
+// the example's two stations are down from 2025-030-23:20 until 2025-031-00:40
+static void check_example_downtime(Schedule skd, const StationDowntime* down) {
+    size_t kk = station_index(skd, "Kk"), wz = station_index(skd, "Wz");
+    for(size_t i = 0; i < skd.station_count; ++i) {
+        CHECK(down->beg[i + 1] - down->beg[i] == ((i == kk || i == wz) ? 1u : 0u));
+    }
+    CHECK(down->from[down->beg[kk]] == ms_at(2025, 30, 23, 20));
+    CHECK(down->until[down->beg[kk]] == ms_at(2025, 31, 0, 40));
+    CHECK(down->from[down->beg[wz]] == ms_at(2025, 30, 23, 20));
+}
+
+// $DOWNTIME is left alone until something asks for it, then it's parsed exactly once for every copy of the Schedule
+static void test_lazy_downtime(const char* src) {
+    Schedule skd;
+    REQUIRE(!Schedule_build_from_memory(&skd, "test/no_such_file.skd", strdup(src)));
+    const Section* section = Schedule_get_section(skd, "$DOWNTIME");
+    REQUIRE(section != NULL);
+    CHECK(!section->parsed && section->data == NULL);
+    CHECK(Schedule_get_section(skd, "$SKED")->parsed);
+    Schedule copy = skd;
+    const StationDowntime* down = Schedule_get_downtime(copy);
+    REQUIRE(down != NULL);
+    CHECK(section->parsed && section->data == down);
+    CHECK(Schedule_get_downtime(skd) == down);
+    check_example_downtime(skd, down);
+    // sections without a parser are only indexed
+    CHECK(Schedule_get_section_data(skd, "$FLUX") == NULL);
+    CHECK(Schedule_get_section(skd, "$FLUX")->parsed);
+    Schedule_free(skd);
+}
+
+static void test_missing_downtime(const char* src) {
+    char* text = strdup(src);
+    REQUIRE(text != NULL);
+    memcpy(strstr(text, "$DOWNTIME"), "$DOWNXXXX", 9);
+    Schedule skd;
+    REQUIRE(!Schedule_build_from_memory(&skd, "test/no_such_file.skd", text));
+    CHECK(Schedule_get_section(skd, "$DOWNTIME") == NULL);
+    CHECK(Schedule_get_downtime(skd) == NULL);
+    Schedule_free(skd);
+}
+
+// overlapping windows of a station are merged, empty ones and unknown stations are dropped
+static void test_merged_downtime(const char* src) {
+    Schedule skd;
+    char* text = insert_after(src, "$DOWNTIME\n",
+        "Kk 2025-031-00:30:00 2025-031-01:00:00\n"
+        "Ft 2025-030-10:00:00 2025-030-09:00:00\n"
+        "Xx 2025-030-10:00:00 2025-030-11:00:00\n"
+        "Ft 2025-030-12:00:00 2025-030-13:00:00\n");
+    REQUIRE(!Schedule_build_from_memory(&skd, "test/no_such_file.skd", text));
+    const StationDowntime* down = Schedule_get_downtime(skd);
+    REQUIRE(down != NULL);
+    size_t kk = station_index(skd, "Kk"), ft = station_index(skd, "Ft");
+    CHECK(down->beg[kk + 1] - down->beg[kk] == 1);
+    CHECK(down->from[down->beg[kk]] == ms_at(2025, 30, 23, 20));
+    CHECK(down->until[down->beg[kk]] == ms_at(2025, 31, 1, 0));
+    CHECK(down->beg[ft + 1] - down->beg[ft] == 1);
+    CHECK(down->from[down->beg[ft]] == ms_at(2025, 30, 12, 0));
+    CHECK(down->beg[skd.station_count] == 3);
+    Schedule_free(skd);
+}
+
+// lines which aren't <station> <yyyy-ddd-hh:mm:ss> <yyyy-ddd-hh:mm:ss> are skipped, stations can also be named by their key
+static void test_malformed_downtime(const char* src) {
+    Schedule skd;
+    char* text = insert_after(src, "$DOWNTIME\n",
+        "\n"
+        "Ft garbage\n"
+        "Ft 2025-30-12:00:00 2025-030-13:00:00\n"
+        "Ft 2025-030-12:00:00\n"
+        "Ft 2025-030-12:00:00 2025/030/13:00:00\n"
+        "FORTLEZA_ 2025-030-12:00:00 2025-030-13:00:00\n"
+        "\tB\t2025-030-12:00:00   2025-030-13:00:00\r\n");
+    REQUIRE(!Schedule_build_from_memory(&skd, "test/no_such_file.skd", text));
+    const StationDowntime* down = Schedule_get_downtime(skd);
+    REQUIRE(down != NULL);
+    size_t ft = station_index(skd, "Ft"), bd = station_index(skd, "Bd");
+    CHECK(down->beg[ft + 1] == down->beg[ft]);
+    CHECK(down->beg[bd + 1] - down->beg[bd] == 1);
+    CHECK(down->until[down->beg[bd]] == ms_at(2025, 30, 13, 0));
+    CHECK(down->beg[skd.station_count] == 3);
+    Schedule_free(skd);
+}
+
+// a compiled image holds the eager sections only, a lazy one is parsed again from the source
+static void test_cached_downtime(const char* src) {
+    char path[] = "/tmp/vis_test_XXXXXX", image[64];
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    FILE* stream = fdopen(fd, "wb");
+    REQUIRE(stream != NULL);
+    fputs(src, stream);
+    fclose(stream);
+    snprintf(image, sizeof(image), "%s.skdb", path);
+    Schedule skd;
+    for(int pass = 0; pass < 2; ++pass) {
+        REQUIRE(!Schedule_build_from_source(&skd, path));
+        // the first build writes the image, the second maps it
+        CHECK((skd.image.addr != NULL) == (pass == 1));
+        const Section* section = Schedule_get_section(skd, "$DOWNTIME");
+        REQUIRE(section != NULL);
+        CHECK(!section->parsed && section->data == NULL);
+        const StationDowntime* down = Schedule_get_downtime(skd);
+        REQUIRE(down != NULL);
+        check_example_downtime(skd, down);
+        Schedule_free(skd);
+    }
+    remove(image);
+    remove(path);
+}
+
+int main(void) {
+    const char* src = read_file_contents(EXAMPLE);
+    REQUIRE(src != NULL);
+    test_lazy_downtime(src);
+    test_missing_downtime(src);
+    test_merged_downtime(src);
+    test_malformed_downtime(src);
+    test_cached_downtime(src);
+    free((char*) src);
+    return test_result("sections");
+}
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "skd.h"
+#include "skd_pass.h"
+#include "skd_snapshot.h"
+#include "util/arena.h"
+#include "util/fio.h"
+#include "headless.h"
+#include "synth.h"
+#include "test.h"
+
+#define EXAMPLE "examples/r41192.skd"
+// every source swap lands on one of these scans
+#define SWAP_FIRST 200
+#define SWAP_EVERY 97
+
+// copies of a Schedule's scan tables, to tell that snapshots left it alone
+typedef struct {
+    size_t scan_count, member_count;
+    TimeMs* timestamp;
+    uint32_t* source;
+    uint32_t* station_beg;
+    uint16_t* stations;
+    uint32_t* offsets;
+    uint64_t* station_sets;
+} SavedScans;
+
+static void* save_table(const void* table, size_t bytes) {
+    void* copy = malloc(bytes + 1);
+    REQUIRE(copy != NULL);
+    memcpy(copy, table, bytes);
+    return copy;
+}
+
+static SavedScans save_scans(Schedule skd) {
+    SavedScans saved = { .scan_count = skd.scan_count, .member_count = skd.scans.station_beg[skd.scan_count] };
+    saved.timestamp = (TimeMs*) save_table(skd.scans.timestamp, skd.scan_count * sizeof(TimeMs));
+    saved.source = (uint32_t*) save_table(skd.scans.source, skd.scan_count * sizeof(uint32_t));
+    saved.station_beg = (uint32_t*) save_table(skd.scans.station_beg, (skd.scan_count + 1) * sizeof(uint32_t));
+    saved.stations = (uint16_t*) save_table(skd.scans.stations, saved.member_count * sizeof(uint16_t));
+    saved.offsets = (uint32_t*) save_table(skd.scans.offsets, saved.member_count * sizeof(uint32_t));
+    saved.station_sets = (uint64_t*) save_table(skd.scans.station_sets, skd.scan_count * skd.scans.set_words * sizeof(uint64_t));
+    return saved;
+}
+
+static unsigned int same_scans(SavedScans saved, Schedule skd) {
+    return saved.scan_count == skd.scan_count && saved.member_count == skd.scans.station_beg[skd.scan_count] &&
+        memcmp(saved.timestamp, skd.scans.timestamp, skd.scan_count * sizeof(TimeMs)) == 0 &&
+        memcmp(saved.source, skd.scans.source, skd.scan_count * sizeof(uint32_t)) == 0 &&
+        memcmp(saved.station_beg, skd.scans.station_beg, (skd.scan_count + 1) * sizeof(uint32_t)) == 0 &&
+        memcmp(saved.stations, skd.scans.stations, saved.member_count * sizeof(uint16_t)) == 0 &&
+        memcmp(saved.offsets, skd.scans.offsets, saved.member_count * sizeof(uint32_t)) == 0 &&
+        memcmp(saved.station_sets, skd.scans.station_sets, skd.scan_count * skd.scans.set_words * sizeof(uint64_t)) == 0;
+}
+
+static void SavedScans_free(SavedScans saved) {
+    free(saved.timestamp);
+    free(saved.source);
+    free(saved.station_beg);
+    free(saved.stations);
+    free(saved.offsets);
+    free(saved.station_sets);
+}
+
+// the edits made to a variant, replayed on the base's scans to get what it should hold
+typedef struct {
+    size_t dropped;
+    size_t shift_beg, shift_end;
+    TimeMs shift_ms;
+    unsigned int swap;
+} Edits;
+
+static uint32_t swapped_source(Schedule skd, size_t scan) {
+    return (uint32_t) ((skd.scans.source[scan] + 1 + scan * 7) % skd.source_count);
+}
+
+static unsigned int is_swapped(Edits edits, size_t scan) {
+    return edits.swap && scan >= SWAP_FIRST && (scan - SWAP_FIRST) % SWAP_EVERY == 0;
+}
+
+static unsigned int apply_edits(ScheduleSnapshot* snap, Schedule skd, Edits edits) {
+    unsigned int failure = 0;
+    if(edits.dropped < skd.station_count) failure |= ScheduleSnapshot_drop_station(snap, edits.dropped);
+    failure |= ScheduleSnapshot_shift_scans(snap, edits.shift_beg, edits.shift_end, edits.shift_ms);
+    for(size_t i = SWAP_FIRST; edits.swap && i < skd.scan_count; i += SWAP_EVERY) failure |= ScheduleSnapshot_set_source(snap, i, swapped_source(skd, i));
+    return failure;
+}
+
+// every scan of the variant is the base's with the edits applied, and scans outside diff weren't touched
+static void check_variant(Schedule skd, Schedule var, Edits edits, ScheduleDiff diff) {
+    size_t i, j, t, wrong = 0;
+    uint64_t set[STATION_SET_WORDS_MAX];
+    REQUIRE(var.scan_count == skd.scan_count && var.scans.set_words == skd.scans.set_words);
+    for(i = 0; i < skd.scan_count; ++i) {
+        unsigned int bad = 0, changed = 0;
+        memset(set, 0, sizeof(set));
+        for(j = skd.scans.station_beg[i], t = var.scans.station_beg[i]; j < skd.scans.station_beg[i + 1]; ++j) {
+            if(skd.scans.stations[j] == edits.dropped) {
+                changed = 1;
+                continue;
+            }
+            bad |= t >= var.scans.station_beg[i + 1] || var.scans.stations[t] != skd.scans.stations[j] || var.scans.offsets[t] != skd.scans.offsets[j];
+            if(skd.scans.stations[j] < skd.station_count) set[skd.scans.stations[j] / STATION_SET_WORD_BITS] |= (uint64_t) 1 << (skd.scans.stations[j] % STATION_SET_WORD_BITS);
+            t++;
+        }
+        bad |= t != var.scans.station_beg[i + 1];
+        bad |= memcmp(set, &(var.scans.station_sets[i * var.scans.set_words]), var.scans.set_words * sizeof(uint64_t)) != 0;
+        TimeMs timestamp = skd.scans.timestamp[i];
+        if(i >= edits.shift_beg && i < edits.shift_end && edits.shift_ms != 0) {
+            timestamp += edits.shift_ms;
+            changed = 1;
+        }
+        bad |= var.scans.timestamp[i] != timestamp;
+        bad |= var.scans.source[i] != (is_swapped(edits, i) ? swapped_source(skd, i) : skd.scans.source[i]);
+        changed |= is_swapped(edits, i);
+        bad |= changed && (i < diff.first || i >= diff.first + diff.added);
+        bad |= i > 0 && var.scans.timestamp[i] < var.scans.timestamp[i - 1];
+        if(bad && wrong++ < 3) fprintf(stderr, "scan %zu of the variant doesn't match its edits\n", i);
+    }
+    CHECK(wrong == 0);
+    CHECK(diff.removed == diff.added && diff.first + diff.added <= skd.scan_count);
+    CHECK(var.scans.obs_duration == skd.scans.obs_duration && var.stations == skd.stations && var.sources == skd.sources);
+}
+
+// the variant's scan index matches one built from scratch over its tables
+static void check_index(Schedule var) {
+    Schedule full = var;
+    full.arena = Arena_create(SCHEDULE_ARENA_BYTES);
+    REQUIRE(full.arena != NULL);
+    REQUIRE(!Schedule_index_scans(&full));
+    size_t member_count = var.scans.station_beg[var.scan_count];
+    CHECK(memcmp(full.scan_index.station_beg, var.scan_index.station_beg, (var.station_count + 1) * sizeof(uint32_t)) == 0);
+    CHECK(memcmp(full.scan_index.station_scans, var.scan_index.station_scans, member_count * sizeof(uint32_t)) == 0);
+    CHECK(memcmp(full.scan_index.station_offsets, var.scan_index.station_offsets, member_count * sizeof(uint32_t)) == 0);
+    CHECK(memcmp(full.scan_index.source_beg, var.scan_index.source_beg, (var.source_count + 1) * sizeof(uint32_t)) == 0);
+    CHECK(memcmp(full.scan_index.source_scans, var.scan_index.source_scans, var.scan_count * sizeof(uint32_t)) == 0);
+    Arena_release(full.arena);
+}
+
+// a pass reloaded from the base into the variant draws what a pass built for the variant does
+// the fresh pass's downtime is parsed into view's arena, so the reloaded pass is given a view of its own
+static void check_pass(Schedule skd, ScheduleView* view, const ScheduleSnapshot* snap) {
+    Shader frag;
+    ScheduleView other;
+    ScheduleDiff diff;
+    SchedulePass* fresh = SchedulePass_init_from_schedule(headless_pass_desc(&frag), view->skd);
+    SchedulePass* reloaded = SchedulePass_init_from_schedule(headless_pass_desc(&frag), skd);
+    REQUIRE(fresh != NULL && reloaded != NULL);
+    ScheduleView_init(&other, skd);
+    REQUIRE(!ScheduleView_show(&other, snap, &diff));
+    REQUIRE(!SchedulePass_reload(reloaded, other.skd, diff));
+    TimeMs first = skd.scans.timestamp[0], span = skd.scans.timestamp[skd.scan_count - 1] - first;
+    GLsizei lines;
+    OverlayControls controls;
+    for(size_t i = 0; i <= 8; ++i) {
+        TimeMs ms = first + span * (TimeMs) i / 8 + 1234;
+        REQUIRE(!SchedulePass_seek(fresh, view->skd, ms) && !SchedulePass_seek(reloaded, other.skd, ms));
+        SchedulePass_update_and_draw(fresh, view->skd, NULL);
+        lines = Headless.lines;
+        controls = Headless.controls;
+        SchedulePass_update_and_draw(reloaded, other.skd, NULL);
+        CHECK(Headless.lines == lines);
+        CHECK(Headless.controls.scan_count == controls.scan_count);
+        CHECK(Headless.controls.observing == controls.observing && Headless.controls.slewing == controls.slewing);
+        CHECK(Headless.controls.down == controls.down);
+    }
+    SchedulePass_free(fresh);
+    SchedulePass_free(reloaded);
+    ScheduleView_free(other);
+}
+
+static void test_edits(const char* name, Schedule skd, unsigned int with_pass) {
+    SavedScans saved = save_scans(skd);
+    ScheduleSnapshot snap;
+    ScheduleView view;
+    ScheduleDiff diff;
+    REQUIRE(!ScheduleSnapshot_init(&snap, skd));
+    // the shifts only go as far as the gaps around the scans allow
+    size_t beg = skd.scan_count / 8, end = skd.scan_count / 3;
+    Edits edits = {
+        .dropped = 3 % skd.station_count,
+        .shift_beg = beg,
+        .shift_end = end,
+        .shift_ms = skd.scans.timestamp[end] - skd.scans.timestamp[end - 1],
+        .swap = 1,
+    };
+    REQUIRE(!apply_edits(&snap, skd, edits));
+    // a shift which would reorder the scans is refused and moves nothing
+    CHECK(ScheduleSnapshot_shift_scans(&snap, beg, end, edits.shift_ms + 1) == 1);
+    CHECK(ScheduleSnapshot_shift_scans(&snap, beg, end, skd.scans.timestamp[beg - 1] - skd.scans.timestamp[beg] - edits.shift_ms - 1) == 1);
+    // out of range edits fail too
+    CHECK(ScheduleSnapshot_drop_station(&snap, skd.station_count) == 1);
+    CHECK(ScheduleSnapshot_shift_scans(&snap, 5, skd.scan_count + 1, 1) == 1);
+    CHECK(ScheduleSnapshot_set_source(&snap, skd.scan_count, 0) == 1);
+    CHECK(ScheduleSnapshot_set_source(&snap, 0, skd.source_count) == 1);
+    ScheduleView_init(&view, skd);
+    REQUIRE(!ScheduleView_show(&view, &snap, &diff));
+    check_variant(skd, view.skd, edits, diff);
+    check_index(view.skd);
+    CHECK(view.skd.scan_index.station_scans != skd.scan_index.station_scans);
+    if(with_pass) check_pass(skd, &view, &snap);
+    // a fork sees its parent's edits and adds its own, without changing the parent
+    ScheduleSnapshot child;
+    REQUIRE(!ScheduleSnapshot_fork(&child, &snap));
+    uint32_t source = (skd.scans.source[0] + 1) % (uint32_t) skd.source_count;
+    REQUIRE(!ScheduleSnapshot_set_source(&child, 0, source));
+    REQUIRE(!ScheduleView_show(&view, &child, &diff));
+    CHECK(view.skd.scans.source[0] == source);
+    CHECK(diff.first == 0);
+    check_index(view.skd);
+    REQUIRE(!ScheduleView_show(&view, &snap, &diff));
+    check_variant(skd, view.skd, edits, diff);
+    CHECK(diff.first == 0);
+    ScheduleSnapshot_free(child);
+    // showing the base again shares every table
+    REQUIRE(!ScheduleView_show(&view, NULL, &diff));
+    CHECK(view.skd.scans.timestamp == skd.scans.timestamp && view.skd.scans.stations == skd.scans.stations);
+    CHECK(view.skd.scan_index.source_scans == skd.scan_index.source_scans);
+    CHECK(diff.first <= edits.shift_beg && diff.first + diff.removed >= edits.shift_end);
+    ScheduleView_free(view);
+    ScheduleSnapshot_free(snap);
+    if(!same_scans(saved, skd)) fprintf(stderr, "%s: the base changed\n", name);
+    CHECK(same_scans(saved, skd));
+    SavedScans_free(saved);
+}
+
+// an edit only copies the chunks it touches, every other chunk stays shared with the base
+static void test_chunks(Schedule skd) {
+    REQUIRE(skd.scan_count > SNAPSHOT_CHUNK_SCANS * 3);
+    ScheduleSnapshot snap;
+    ScheduleView view;
+    ScheduleDiff diff;
+    size_t c, scan = SNAPSHOT_CHUNK_SCANS * 2 + 10;
+    REQUIRE(!ScheduleSnapshot_init(&snap, skd));
+    CHECK(snap.chunk_count == (skd.scan_count + SNAPSHOT_CHUNK_SCANS - 1) / SNAPSHOT_CHUNK_SCANS);
+    REQUIRE(!ScheduleSnapshot_set_source(&snap, scan, (skd.scans.source[scan] + 1) % skd.source_count));
+    REQUIRE(!ScheduleSnapshot_shift_scans(&snap, scan, scan + 1, 1));
+    for(c = 0; c < snap.chunk_count; ++c) {
+        CHECK((snap.chunks[c].source == &(skd.scans.source[c * SNAPSHOT_CHUNK_SCANS])) == (c != 2));
+        CHECK((snap.chunks[c].timestamp == &(skd.scans.timestamp[c * SNAPSHOT_CHUNK_SCANS])) == (c != 2));
+        CHECK(snap.chunks[c].stations == skd.scans.stations);
+    }
+    ScheduleView_init(&view, skd);
+    REQUIRE(!ScheduleView_show(&view, &snap, &diff));
+    CHECK(diff.first == scan && diff.added == 1);
+    // members weren't touched, so the view shares them and the by-station half of the index
+    CHECK(view.skd.scans.stations == skd.scans.stations && view.skd.scan_index.station_scans == skd.scan_index.station_scans);
+    CHECK(view.skd.scans.source[scan] != skd.scans.source[scan] && view.skd.scans.timestamp[scan] == skd.scans.timestamp[scan] + 1);
+    check_index(view.skd);
+    ScheduleView_free(view);
+    ScheduleSnapshot_free(snap);
+}
+
+int main(void) {
+    Schedule skd;
+    char* src = (char*) read_file_contents(EXAMPLE);
+    REQUIRE(src != NULL);
+    REQUIRE(!Schedule_build_from_memory(&skd, "test/no_such_file.skd", src));
+    test_edits(EXAMPLE, skd, 1);
+    Schedule_free(skd);
+    // several chunks of 100 stations
+    REQUIRE(!synth_build(&skd, 100, 20));
+    test_edits("100 stations", skd, 1);
+    test_chunks(skd);
+    Schedule_free(skd);
+    Overlay_free();
+    return test_result("snapshot");
+}
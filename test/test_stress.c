@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "skd.h"
+#include "skd_pass.h"
+#include "ui.h"
+#include "headless.h"
+#include "synth.h"
+#include "test.h"
+
+// a week of 256 stations with more than a million scans, several times what any real network schedules
+static const SynthDesc STRESS = {
+    .station_count = 256,
+    .source_count = 512,
+    .scan_count = (1 << 20) + 1000,
+    .span = 7 * 86400,
+    .start = { .yrs = 2025, .day = 358, .hrs = 0, .min = 0, .sec = 0 },
+    .seed = 19,
+};
+
+static int compare_names(const void* fst, const void* snd) {
+    return strcmp((const char*) fst, (const char*) snd);
+}
+
+// every scan, station and offset is replayed from the generator and compared with what was parsed
+static void check_tables(Schedule skd) {
+    REQUIRE(skd.scan_count == STRESS.scan_count);
+    CHECK(skd.station_count == STRESS.station_count);
+    CHECK(skd.source_count == STRESS.source_count);
+    SynthGen gen = SynthGen_init(STRESS);
+    SynthScan scan;
+    char id[3], name[9];
+    size_t i, j, member_count = 0, long_scans = 0, bad_scans = 0;
+    for(i = 0; SynthGen_next(&gen, &scan); ++i) {
+        unsigned int bad = 0;
+        synth_source_name(scan.source, name);
+        bad |= skd.scans.source[i] >= skd.source_count || strcmp(skd.sources[skd.scans.source[i]].iau, name) != 0;
+        bad |= skd.scans.timestamp[i] != Datetime_to_ms(scan.start);
+        bad |= skd.scans.cal_duration[i] != SYNTH_CAL_DURATION;
+        bad |= skd.scans.obs_duration[i] != scan.obs_duration;
+        bad |= skd.scans.station_beg[i] != member_count;
+        bad |= skd.scans.station_beg[i + 1] - skd.scans.station_beg[i] != scan.id_count;
+        for(j = 0; !bad && j < scan.id_count; ++j) {
+            synth_station_id(scan.stations[j], id);
+            bad |= strcmp(skd.stations[skd.scans.stations[member_count + j]].id, id) != 0;
+            bad |= skd.scans.offsets[member_count + j] != scan.offsets[j];
+        }
+        if(scan.obs_duration > UINT16_MAX) long_scans++;
+        member_count += scan.id_count;
+        if(bad && bad_scans++ < 3) fprintf(stderr, "scan %zu doesn't match its line\n", i);
+    }
+    CHECK(bad_scans == 0);
+    CHECK(skd.scans.station_beg[skd.scan_count] == member_count);
+    CHECK(long_scans == STRESS.scan_count / SYNTH_LONG_EVERY);
+    // the last scan starts on the schedule's final day
+    CHECK(skd.scans.timestamp[skd.scan_count - 1] - skd.scans.timestamp[0] >= (TimeMs) (STRESS.span - 86400) * TIME_MS_PER_SEC);
+    CHECK(skd.skipped_count == 0);
+}
+
+// the Overlay lists after a paused frame at ms hold every scan observing at ms and its stations which haven't finished
+static void check_frame(SchedulePass* pass, Schedule skd, TimeMs ms) {
+    size_t i, j, scan_count = 0, station_count = 0, got_scans = 0, got_stations = 0;
+    const char* name;
+    for(i = 0; i < skd.scan_count; ++i) {
+        if(skd.scans.timestamp[i] > ms || ms >= skd.scans.timestamp[i] + (TimeMs) skd.scans.obs_duration[i] * TIME_MS_PER_SEC) continue;
+        scan_count++;
+        for(j = skd.scans.station_beg[i]; j < skd.scans.station_beg[i + 1]; ++j) {
+            if(ms < skd.scans.timestamp[i] + (TimeMs) skd.scans.offsets[j] * TIME_MS_PER_SEC) station_count++;
+        }
+    }
+    char (*want_scans)[9] = (char (*)[9]) calloc(scan_count + 1, 9);
+    char (*want_stations)[3] = (char (*)[3]) calloc(station_count + 1, 3);
+    REQUIRE(want_scans != NULL && want_stations != NULL);
+    for(i = 0, scan_count = 0, station_count = 0; i < skd.scan_count; ++i) {
+        if(skd.scans.timestamp[i] > ms || ms >= skd.scans.timestamp[i] + (TimeMs) skd.scans.obs_duration[i] * TIME_MS_PER_SEC) continue;
+        memcpy(want_scans[scan_count++], skd.sources[skd.scans.source[i]].iau, 9);
+        for(j = skd.scans.station_beg[i]; j < skd.scans.station_beg[i + 1]; ++j) {
+            if(ms < skd.scans.timestamp[i] + (TimeMs) skd.scans.offsets[j] * TIME_MS_PER_SEC) {
+                memcpy(want_stations[station_count++], skd.stations[skd.scans.stations[j]].id, 3);
+            }
+        }
+    }
+    qsort(want_scans, scan_count, 9, compare_names);
+    qsort(want_stations, station_count, 3, compare_names);
+    REQUIRE(!SchedulePass_seek(pass, skd, ms));
+    Headless.lines = 0;
+    SchedulePass_update_and_draw(pass, skd, NULL);
+    CHECK(Headless.controls.scan_count == skd.scan_count);
+    CHECK(Headless.lines == (GLsizei) (station_count * 2));
+    char (*scans)[9] = (char (*)[9]) calloc(scan_count + 1, 9);
+    char (*stations)[3] = (char (*)[3]) calloc(station_count + 1, 3);
+    REQUIRE(scans != NULL && stations != NULL);
+    for(; (name = Overlay_get_active_scan(got_scans)) != NULL && got_scans < scan_count; ++got_scans) memcpy(scans[got_scans], name, 9);
+    for(; (name = Overlay_get_station(got_stations)) != NULL && got_stations < station_count; ++got_stations) memcpy(stations[got_stations], name, 3);
+    CHECK(got_scans == scan_count && Overlay_get_active_scan(scan_count) == NULL);
+    CHECK(got_stations == station_count && Overlay_get_station(station_count) == NULL);
+    qsort(scans, got_scans, 9, compare_names);
+    qsort(stations, got_stations, 3, compare_names);
+    CHECK(memcmp(scans, want_scans, scan_count * 9) == 0);
+    CHECK(memcmp(stations, want_stations, station_count * 3) == 0);
+    free(want_scans);
+    free(want_stations);
+    free(scans);
+    free(stations);
+}
+
+int main(void) {
+    char* text = synth_schedule(STRESS);
+    REQUIRE(text != NULL);
+    Schedule skd;
+    // the text is handed to the Schedule, which frees it
+    REQUIRE(!Schedule_build_from_memory(&skd, "test/no_such_file.skd", text));
+    check_tables(skd);
+    Shader frag;
+    SchedulePass* pass = SchedulePass_init_from_schedule(headless_pass_desc(&frag), skd);
+    REQUIRE(pass != NULL);
+    TimeMs first = skd.scans.timestamp[0];
+    for(size_t i = 0; i <= 7; ++i) check_frame(pass, skd, first + (TimeMs) (i * (STRESS.span / 7) + 1234) * TIME_MS_PER_SEC);
+    // around the first scan longer than UINT16_MAX seconds
+    size_t idx = SYNTH_LONG_EVERY - 1;
+    TimeMs ms = skd.scans.timestamp[idx];
+    check_frame(pass, skd, ms);
+    check_frame(pass, skd, ms + (TimeMs) UINT16_MAX * TIME_MS_PER_SEC);
+    check_frame(pass, skd, ms + (TimeMs) skd.scans.obs_duration[idx] * TIME_MS_PER_SEC);
+    SchedulePass_free(pass);
+    Overlay_free();
+    Schedule_free(skd);
+    return test_result("stress");
+}